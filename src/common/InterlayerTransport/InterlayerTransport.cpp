@@ -0,0 +1,318 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+/**
+@Arquive name : InterlayerTransport.cpp
+@Classification : Interlayer Transport
+@
+@Version : v1.0
+
+Project : H2020 5G-Range
+
+@Description : This module implements the transports used by L1 and L2 to exchange
+    PDUs and control messages: UDP loopback sockets or rings in shared memory.
+*/
+
+#include "InterlayerTransport.h"
+
+#include <string.h>     //bzero(), memcpy()
+#include <unistd.h>     //close(), ftruncate()
+#include <fcntl.h>      //O_CREAT, O_RDWR
+#include <sys/mman.h>   //shm_open(), mmap()
+#include <sys/epoll.h>  //epoll_create1(), epoll_wait()
+
+InterlayerTransport::InterlayerTransport(
+    bool _l2Side,       //Flag indicating object is used by L2
+    bool _verbose)      //Verbosity flag
+{
+    l2Side = _l2Side;
+    verbose = _verbose;
+}
+
+InterlayerTransport::~InterlayerTransport() {}
+
+bool
+InterlayerTransport::sendBatch(
+    const InterlayerMessage* messages,  //Array of messages
+    int numberMessages)                 //Number of messages in array
+{
+    bool success = true;
+    for(int i=0;i<numberMessages;i++)
+        success = send(messages[i].channel, messages[i].buffer, messages[i].numberBytes) && success;
+    return success;
+}
+
+bool
+InterlayerTransport::isOutgoing(
+    InterlayerChannels channel)     //Channel
+{
+    return l2Side==(channel==L2_TO_L1_PDUS || channel==L2_TO_L1_CONTROL);
+}
+
+InterlayerTransport*
+InterlayerTransport::create(
+    InterlayerTransports transport,     //Transport to be created
+    bool _l2Side,                       //Flag indicating object is used by L2
+    bool _verbose)                      //Verbosity flag
+{
+    switch(transport){
+        case SHARED_MEMORY_TRANSPORT:
+            return new ShmInterlayerTransport(_l2Side, _verbose);
+        case UDP_TRANSPORT:
+        default:
+            return new UdpInterlayerTransport(_l2Side, _verbose);
+    }
+}
+
+UdpInterlayerTransport::UdpInterlayerTransport(
+    bool _l2Side,       //Flag indicating object is used by L2
+    bool _verbose)      //Verbosity flag
+    : InterlayerTransport(_l2Side, _verbose)
+{
+    //Clients send to the other layer; servers listen to it
+    for(int i=0;i<NUMBER_INTERLAYER_CHANNELS;i++){
+        receiveBatches[i] = NULL;
+        epollDescriptors[i] = -1;
+        if(isOutgoing((InterlayerChannels) i)){
+            sockets[i] = createClientSocketToSendMessages(INTERLAYER_UDP_BASE_PORT+i, &(serverAddresses[i]), INTERLAYER_UDP_ADDRESS);
+            continue;
+        }
+        sockets[i] = createServerSocketToReceiveMessages(INTERLAYER_UDP_BASE_PORT+i);
+
+        //Readiness of incoming socket is watched by its own epoll instance, so each channel is waited for alone
+        struct epoll_event event;
+        bzero(&event, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = sockets[i];
+        epollDescriptors[i] = epoll_create1(0);
+        if(epollDescriptors[i]==-1 || epoll_ctl(epollDescriptors[i], EPOLL_CTL_ADD, sockets[i], &event)==-1)
+            perror("[InterlayerTransport] Epoll creation failed.");
+
+        //Buffers of incoming channel are allocated once; each header points to its buffer
+        receiveBatches[i] = new UdpReceiveBatch;
+        receiveBatches[i]->buffers = new char[INTERLAYER_RECEIVE_BATCH_SIZE*INTERLAYER_MAXIMUM_DATAGRAM];
+        receiveBatches[i]->numberDatagrams = 0;
+        receiveBatches[i]->nextDatagram = 0;
+        bzero(receiveBatches[i]->headers, sizeof(receiveBatches[i]->headers));
+        for(int j=0;j<INTERLAYER_RECEIVE_BATCH_SIZE;j++){
+            receiveBatches[i]->vectors[j].iov_base = receiveBatches[i]->buffers+j*INTERLAYER_MAXIMUM_DATAGRAM;
+            receiveBatches[i]->vectors[j].iov_len = INTERLAYER_MAXIMUM_DATAGRAM;
+            receiveBatches[i]->headers[j].msg_hdr.msg_iov = &(receiveBatches[i]->vectors[j]);
+            receiveBatches[i]->headers[j].msg_hdr.msg_iovlen = 1;
+        }
+    }
+}
+
+UdpInterlayerTransport::~UdpInterlayerTransport() {
+    for(int i=0;i<NUMBER_INTERLAYER_CHANNELS;i++){
+        close(sockets[i]);
+        if(epollDescriptors[i]!=-1)
+            close(epollDescriptors[i]);
+        if(receiveBatches[i]!=NULL){
+            delete [] receiveBatches[i]->buffers;
+            delete receiveBatches[i];
+        }
+    }
+}
+
+int
+UdpInterlayerTransport::createClientSocketToSendMessages(
+    short port,                                     //Socket Port
+    struct sockaddr_in* serverReceiverOfMessage,    //Struct to store server address to which client will send messages
+    const char* serverIp)                           //Ip address of server
+{
+    int socketDescriptor;
+
+    //Client socket creation
+    socketDescriptor = socket(AF_INET, SOCK_DGRAM, 0);
+    if(socketDescriptor==-1) perror("[InterlayerTransport] Socket to send information creation failed.");
+    else if(verbose) cout<<"[InterlayerTransport] Client socket to send info created successfully."<<endl;
+    bzero(serverReceiverOfMessage, sizeof(*serverReceiverOfMessage));
+
+    serverReceiverOfMessage->sin_family = AF_INET;
+    serverReceiverOfMessage->sin_port = htons(port);
+    serverReceiverOfMessage->sin_addr.s_addr = inet_addr(serverIp);  //Localhost
+    return socketDescriptor;
+}
+
+int
+UdpInterlayerTransport::createServerSocketToReceiveMessages(
+    short port)         //Socket Port
+{
+    struct sockaddr_in sockname;        //Struct to configure which address server will bind to
+    int socketDescriptor;
+
+    socketDescriptor = socket(AF_INET, SOCK_DGRAM, 0);
+    if(socketDescriptor==-1) perror("[InterlayerTransport] Socket to receive information creation failed.");
+
+    bzero(&sockname, sizeof(sockname));
+
+    sockname.sin_family = AF_INET;
+    sockname.sin_port = htons(port);
+    sockname.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    //Serve bind to socket to listen to local messages in port
+    int bindSuccess = bind(socketDescriptor, (const sockaddr*)(&sockname), sizeof(sockname));
+    if(bindSuccess==-1)
+        perror("[InterlayerTransport] Bind error.\n");
+    else
+        if(verbose) cout<<"[InterlayerTransport] Bind successfully to listen to messages."<<endl;
+    return socketDescriptor;
+}
+
+bool
+UdpInterlayerTransport::send(
+    InterlayerChannels channel,     //Outgoing channel
+    const char* buffer,             //Buffer containing message
+    size_t numberBytes)             //Size of message in bytes
+{
+    return sendto(sockets[channel], buffer, numberBytes, MSG_CONFIRM, (const struct sockaddr*)(&(serverAddresses[channel])), sizeof(serverAddresses[channel]))!=-1;
+}
+
+bool
+UdpInterlayerTransport::sendBatch(
+    const InterlayerMessage* messages,  //Array of messages
+    int numberMessages)                 //Number of messages in array
+{
+    struct iovec vectors[INTERLAYER_SEND_BATCH_SIZE];       //Vector pointing to each message
+    struct mmsghdr headers[INTERLAYER_SEND_BATCH_SIZE];     //Header of each datagram
+    int socketDescriptor = sockets[messages[0].channel];    //Any outgoing socket: destination port is set per datagram
+
+    while(numberMessages>0){
+        int numberHeaders = numberMessages<INTERLAYER_SEND_BATCH_SIZE? numberMessages:INTERLAYER_SEND_BATCH_SIZE;
+
+        bzero(headers, numberHeaders*sizeof(struct mmsghdr));
+        for(int i=0;i<numberHeaders;i++){
+            vectors[i].iov_base = (void*) messages[i].buffer;
+            vectors[i].iov_len = messages[i].numberBytes;
+            headers[i].msg_hdr.msg_name = &(serverAddresses[messages[i].channel]);
+            headers[i].msg_hdr.msg_namelen = sizeof(serverAddresses[messages[i].channel]);
+            headers[i].msg_hdr.msg_iov = &(vectors[i]);
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        //Datagrams are sent in order; call may stop before last one, so remaining ones are sent again
+        int numberSent = sendmmsg(socketDescriptor, headers, numberHeaders, MSG_CONFIRM);
+        if(numberSent<=0){
+            if(verbose) cout<<"[InterlayerTransport] Batch of "<<numberMessages<<" messages could not be sent."<<endl;
+            return false;
+        }
+        messages+=numberSent;
+        numberMessages-=numberSent;
+    }
+    return true;
+}
+
+ssize_t
+UdpInterlayerTransport::receive(
+    InterlayerChannels channel,     //Incoming channel
+    char* buffer,                   //Buffer where message will be stored
+    size_t maximumLength,           //Maximum message length in bytes
+    bool blocking)                  //Wait for a message
+{
+    UdpReceiveBatch* batch = receiveBatches[channel];   //Datagrams pending of channel
+    lock_guard<mutex> lk(batch->receiveMutex);
+
+    //Take all datagrams already queued in socket; a blocking call waits only for the first one
+    if(batch->nextDatagram==batch->numberDatagrams){
+        int numberDatagrams = recvmmsg(sockets[channel], batch->headers, INTERLAYER_RECEIVE_BATCH_SIZE, blocking? MSG_WAITFORONE:MSG_DONTWAIT, NULL);
+        if(numberDatagrams<=0)
+            return -1;
+        batch->numberDatagrams = numberDatagrams;
+        batch->nextDatagram = 0;
+    }
+
+    int index = batch->nextDatagram++;
+    size_t numberBytes = batch->headers[index].msg_len;
+    if(numberBytes>maximumLength) numberBytes = maximumLength;
+    memcpy(buffer, batch->vectors[index].iov_base, numberBytes);
+    return numberBytes;
+}
+
+bool
+UdpInterlayerTransport::waitForMessage(
+    InterlayerChannels channel,     //Incoming channel
+    int timeout)                    //Maximum waiting time in milliseconds
+{
+    //Datagrams already taken from socket do not make it readable
+    {
+        UdpReceiveBatch* batch = receiveBatches[channel];   //Datagrams pending of channel
+        lock_guard<mutex> lk(batch->receiveMutex);
+        if(batch->nextDatagram<batch->numberDatagrams)
+            return true;
+    }
+
+    struct epoll_event event;       //Event of socket ready
+    return epoll_wait(epollDescriptors[channel], &event, 1, timeout)>0;
+}
+
+ShmInterlayerTransport::ShmInterlayerTransport(
+    bool _l2Side,       //Flag indicating object is used by L2
+    bool _verbose)      //Verbosity flag
+    : InterlayerTransport(_l2Side, _verbose)
+{
+    regionSize = NUMBER_INTERLAYER_CHANNELS*ShmRing::getRegionSize();
+    region = MAP_FAILED;
+
+    //Either layer may start first: region is created if it does not exist yet; a new region is zero-filled, i.e. all rings empty
+    int fileDescriptor = shm_open(INTERLAYER_SHM_NAME, O_CREAT|O_RDWR, 0600);
+    if(fileDescriptor==-1)
+        perror("[InterlayerTransport] Shared memory creation failed.");
+    else{
+        if(ftruncate(fileDescriptor, regionSize)==-1)
+            perror("[InterlayerTransport] Shared memory sizing failed.");
+        else
+            region = mmap(NULL, regionSize, PROT_READ|PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+        close(fileDescriptor);      //Mapping stays valid
+    }
+
+    if(region==MAP_FAILED){
+        perror("[InterlayerTransport] Shared memory mapping failed.");
+        exit(1);
+    }
+
+    for(int i=0;i<NUMBER_INTERLAYER_CHANNELS;i++){
+        rings[i] = new ShmRing((char*) region+i*ShmRing::getRegionSize());
+
+        //Messages left by a previous execution are not delivered
+        if(!isOutgoing((InterlayerChannels) i))
+            rings[i]->discard();
+    }
+
+    if(verbose) cout<<"[InterlayerTransport] Shared memory "<<INTERLAYER_SHM_NAME<<" mapped: "<<regionSize<<" bytes."<<endl;
+}
+
+ShmInterlayerTransport::~ShmInterlayerTransport() {
+    for(int i=0;i<NUMBER_INTERLAYER_CHANNELS;i++)
+        delete rings[i];
+    munmap(region, regionSize);
+}
+
+bool
+ShmInterlayerTransport::send(
+    InterlayerChannels channel,     //Outgoing channel
+    const char* buffer,             //Buffer containing message
+    size_t numberBytes)             //Size of message in bytes
+{
+    return rings[channel]->push(buffer, numberBytes);
+}
+
+ssize_t
+ShmInterlayerTransport::receive(
+    InterlayerChannels channel,     //Incoming channel
+    char* buffer,                   //Buffer where message will be stored
+    size_t maximumLength,           //Maximum message length in bytes
+    bool blocking)                  //Wait for a message
+{
+    return rings[channel]->pop(buffer, maximumLength, blocking);
+}
+
+bool
+ShmInterlayerTransport::waitForMessage(
+    InterlayerChannels channel,     //Incoming channel
+    int timeout)                    //Maximum waiting time in milliseconds
+{
+    return rings[channel]->wait(timeout);
+}
@@ -0,0 +1,190 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+
+#ifndef INCLUDED_INTERLAYER_TRANSPORT_H
+#define INCLUDED_INTERLAYER_TRANSPORT_H
+
+#include <iostream>     //cout
+#include <stddef.h>     //size_t
+#include <sys/types.h>  //ssize_t
+#include <sys/socket.h> //socket(), AF_INET, SOCK_DGRAM
+#include <arpa/inet.h>  //struct sockaddr_in
+#include <sys/uio.h>    //struct iovec
+#include <mutex>        //std::mutex
+
+#include "ShmRing.h"
+
+using namespace std;
+
+#define NUMBER_INTERLAYER_CHANNELS 4            //Number of channels between L1 and L2
+#define INTERLAYER_UDP_BASE_PORT 8090           //UDP port of first channel; each channel uses port of its index after it
+#define INTERLAYER_UDP_ADDRESS "127.0.0.1"      //Address where the other layer listens
+#define INTERLAYER_SHM_NAME "/5g-range-l1l2"    //Name of shared memory region (in /dev/shm) holding rings of all channels
+#define INTERLAYER_SEND_BATCH_SIZE 64           //Maximum number of messages given to each sendmmsg() call
+#define INTERLAYER_RECEIVE_BATCH_SIZE 8         //Maximum number of datagrams taken by each recvmmsg() call
+#define INTERLAYER_MAXIMUM_DATAGRAM 65536       //Size of each receive buffer: a UDP datagram is never truncated
+
+/**
+ * @brief Mechanisms available to exchange PDUs and control messages between L1 and L2
+ */
+enum InterlayerTransports {UDP_TRANSPORT, SHARED_MEMORY_TRANSPORT};
+
+/**
+ * @brief Channels between L1 and L2, in the order of their UDP ports (8090 to 8093) and of their rings in shared memory
+ */
+enum InterlayerChannels {L2_TO_L1_PDUS, L1_TO_L2_PDUS, L2_TO_L1_CONTROL, L1_TO_L2_CONTROL};
+
+/**
+ * @brief Message to be sent in a batch; buffer must stay valid until batch is sent
+ */
+typedef struct{
+    InterlayerChannels channel;     //Outgoing channel
+    const char* buffer;             //Buffer containing message
+    size_t numberBytes;             //Size of message in bytes
+}InterlayerMessage;
+
+/**
+ * @brief Message transport between L1 and L2 processes of the same equipment
+ * Each channel carries messages in one direction; messages keep their boundaries, as UDP datagrams.
+ */
+class InterlayerTransport{
+protected:
+    bool l2Side;        //Flag indicating object is used by L2 (true) or by L1 (false)
+    bool verbose;       //Verbosity flag
+
+    /**
+     * @brief Verifies if this side sends messages through a channel
+     * @param channel Channel
+     * @returns True if channel goes out of this side; false if it comes in
+     */
+    bool isOutgoing(InterlayerChannels channel);
+
+public:
+    /**
+     * @brief Constructs an InterlayerTransport
+     * @param _l2Side Flag indicating object is used by L2 (true) or by L1 (false)
+     * @param _verbose Verbosity flag
+     */
+    InterlayerTransport(bool _l2Side, bool _verbose);
+
+    /**
+     * @brief Destroys an InterlayerTransport
+     */
+    virtual ~InterlayerTransport();
+
+    /**
+     * @brief Sends a message through an outgoing channel
+     * @param channel Channel
+     * @param buffer Buffer containing message
+     * @param numberBytes Size of message in bytes
+     * @returns True if message was sent; false otherwise
+     */
+    virtual bool send(InterlayerChannels channel, const char* buffer, size_t numberBytes) = 0;
+
+    /**
+     * @brief Sends a group of messages, possibly of different channels, keeping their order
+     * Default implementation sends them one by one.
+     * @param messages Array of messages
+     * @param numberMessages Number of messages in array
+     * @returns True if all messages were sent; false otherwise
+     */
+    virtual bool sendBatch(const InterlayerMessage* messages, int numberMessages);
+
+    /**
+     * @brief Receives a message from an incoming channel
+     * @param channel Channel
+     * @param buffer Buffer where message will be stored
+     * @param maximumLength Maximum message length in bytes
+     * @param blocking If true, waits until a message arrives
+     * @returns Size of message received in bytes; -1 if there is no message and call is not blocking
+     */
+    virtual ssize_t receive(InterlayerChannels channel, char* buffer, size_t maximumLength, bool blocking) = 0;
+
+    /**
+     * @brief Blocks until a message can be received from an incoming channel, without receiving it
+     * @param channel Channel
+     * @param timeout Maximum waiting time in milliseconds
+     * @returns True if a message is available; false if timeout expired
+     */
+    virtual bool waitForMessage(InterlayerChannels channel, int timeout) = 0;
+
+    /**
+     * @brief Creates a transport object
+     * @param transport Transport to be created
+     * @param _l2Side Flag indicating object is used by L2 (true) or by L1 (false)
+     * @param _verbose Verbosity flag
+     * @returns New InterlayerTransport; it must be deleted by caller
+     */
+    static InterlayerTransport* create(InterlayerTransports transport, bool _l2Side, bool _verbose);
+};
+
+/**
+ * @brief Datagrams taken from an incoming socket by a single recvmmsg() call and not yet delivered
+ */
+typedef struct{
+    char* buffers;                                          //INTERLAYER_RECEIVE_BATCH_SIZE buffers of INTERLAYER_MAXIMUM_DATAGRAM bytes
+    struct iovec vectors[INTERLAYER_RECEIVE_BATCH_SIZE];    //Vector pointing to each buffer
+    struct mmsghdr headers[INTERLAYER_RECEIVE_BATCH_SIZE];  //Header of each datagram; msg_len is its size
+    int numberDatagrams;                                    //Number of datagrams taken by last call
+    int nextDatagram;                                       //Index of next datagram to be delivered
+    mutex receiveMutex;                                     //Mutex to control access to batch
+}UdpReceiveBatch;
+
+/**
+ * @brief Transport over UDP loopback sockets: one socket per channel, bound on the side that receives from it
+ * Batches are sent by a single sendmmsg() call, each datagram addressed to port of its channel; incoming
+ * datagrams are taken by recvmmsg(), so a burst of messages costs one system call.
+ */
+class UdpInterlayerTransport : public InterlayerTransport{
+private:
+    int sockets[NUMBER_INTERLAYER_CHANNELS];                            //File descriptor of socket of each channel
+    struct sockaddr_in serverAddresses[NUMBER_INTERLAYER_CHANNELS];     //Address to which messages of outgoing channels are sent
+    UdpReceiveBatch* receiveBatches[NUMBER_INTERLAYER_CHANNELS];        //Datagrams pending of each incoming channel; NULL for outgoing ones
+    int epollDescriptors[NUMBER_INTERLAYER_CHANNELS];                   //Epoll instance watching socket of each incoming channel; -1 for outgoing ones
+
+    /**
+     * @brief Creates a new socket to serve as sender of messages
+     * @param port Socket port
+     * @param serverReceiverOfMessage Struct used to send message later
+     * @param serverIp Ip address of server
+     * @returns Socket file descriptor used to send message later
+     */
+    int createClientSocketToSendMessages(short port, struct sockaddr_in *serverReceiverOfMessage, const char* serverIp);
+
+    /**
+     * @brief Creates a new socket to serve as receiver of messages
+     * @param port Socket port
+     * @returns Socket file descriptor
+     */
+    int createServerSocketToReceiveMessages(short port);
+
+public:
+    UdpInterlayerTransport(bool _l2Side, bool _verbose);
+    ~UdpInterlayerTransport();
+    bool send(InterlayerChannels channel, const char* buffer, size_t numberBytes);
+    bool sendBatch(const InterlayerMessage* messages, int numberMessages);
+    ssize_t receive(InterlayerChannels channel, char* buffer, size_t maximumLength, bool blocking);
+    bool waitForMessage(InterlayerChannels channel, int timeout);
+};
+
+/**
+ * @brief Transport over rings in a shared memory region mapped by both L1 and L2: messages cost two copies and no
+ * system call while the receiver is busy
+ */
+class ShmInterlayerTransport : public InterlayerTransport{
+private:
+    void* region;                                   //Shared memory region mapped
+    size_t regionSize;                              //Size of region in bytes
+    ShmRing* rings[NUMBER_INTERLAYER_CHANNELS];     //Ring of each channel
+
+public:
+    ShmInterlayerTransport(bool _l2Side, bool _verbose);
+    ~ShmInterlayerTransport();
+    bool send(InterlayerChannels channel, const char* buffer, size_t numberBytes);
+    ssize_t receive(InterlayerChannels channel, char* buffer, size_t maximumLength, bool blocking);
+    bool waitForMessage(InterlayerChannels channel, int timeout);
+};
+#endif  //INCLUDED_INTERLAYER_TRANSPORT_H
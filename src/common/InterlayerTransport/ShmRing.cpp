@@ -0,0 +1,136 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+/**
+@Arquive name : ShmRing.cpp
+@Classification : Interlayer Transport
+@
+@Version : v1.0
+
+Project : H2020 5G-Range
+
+@Description : This module implements a single-producer single-consumer ring of
+    messages in shared memory, used to exchange PDUs and control messages
+    between L1 and L2 without sockets.
+*/
+
+#include "ShmRing.h"
+
+#include <string.h>         //memcpy()
+#include <limits.h>         //INT_MAX
+#include <time.h>           //struct timespec
+#include <unistd.h>         //syscall()
+#include <sys/syscall.h>    //SYS_futex
+#include <linux/futex.h>    //FUTEX_WAIT, FUTEX_WAKE
+
+ShmRing::ShmRing(
+    void* memory)   //Start of ring in shared memory
+{
+    header = (ShmRingHeader*) memory;
+    area = (char*) memory+sizeof(ShmRingHeader);
+}
+
+size_t
+ShmRing::getRegionSize(){
+    return sizeof(ShmRingHeader)+SHM_RING_CAPACITY;
+}
+
+void
+ShmRing::wakeConsumer(){
+    //Futex is shared between processes, so it is not private
+    if(header->consumerWaiting.load()){
+        header->wakeups.fetch_add(1);
+        syscall(SYS_futex, &(header->wakeups), FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+bool
+ShmRing::push(
+    const char* buffer,     //Buffer containing message
+    size_t numberBytes)     //Size of message in bytes
+{
+    uint32_t head = header->head.load(memory_order_relaxed);
+    uint32_t tail = header->tail.load(memory_order_acquire);
+    uint32_t offset = head&(SHM_RING_CAPACITY-1);   //Offset of message in area
+    uint32_t recordLength = (4+numberBytes+SHM_RING_ALIGNMENT-1)&~(SHM_RING_ALIGNMENT-1);   //Length plus message, aligned
+    uint32_t skipLength = 0;                        //Bytes left unused at end of area
+
+    //Message is never split: if it does not fit before end of area, it starts at beginning
+    if(offset+recordLength>SHM_RING_CAPACITY)
+        skipLength = SHM_RING_CAPACITY-offset;
+    if(recordLength>SHM_RING_CAPACITY || (head-tail)+skipLength+recordLength>SHM_RING_CAPACITY)
+        return false;
+
+    if(skipLength){
+        *((uint32_t*)(area+offset)) = SHM_RING_WRAP;
+        head += skipLength;
+        offset = 0;
+    }
+    *((uint32_t*)(area+offset)) = numberBytes;
+    memcpy(area+offset+4, buffer, numberBytes);
+
+    //Publish message; consumer flag is read after head is stored, so consumer cannot miss it and sleep
+    header->head.store(head+recordLength);
+    wakeConsumer();
+    return true;
+}
+
+ssize_t
+ShmRing::pop(
+    char* buffer,           //Buffer where message will be copied
+    size_t maximumLength,   //Maximum message length in bytes
+    bool blocking)          //Wait for a message if ring is empty
+{
+    uint32_t tail = header->tail.load(memory_order_relaxed);
+
+    //Wait until head moves: flag is set before head is read again, so producer sees it if it publishes meanwhile
+    while(header->head.load(memory_order_acquire)==tail){
+        if(!blocking)
+            return -1;
+        uint32_t wakeups = header->wakeups.load();
+        header->consumerWaiting.store(1);
+        if(header->head.load()==tail)
+            syscall(SYS_futex, &(header->wakeups), FUTEX_WAIT, wakeups, NULL, NULL, 0);
+        header->consumerWaiting.store(0);
+    }
+
+    uint32_t offset = tail&(SHM_RING_CAPACITY-1);   //Offset of message in area
+    uint32_t numberBytes = *((uint32_t*)(area+offset));
+    if(numberBytes==SHM_RING_WRAP){
+        tail += SHM_RING_CAPACITY-offset;
+        offset = 0;
+        numberBytes = *((uint32_t*)area);
+    }
+
+    size_t numberCopied = numberBytes>maximumLength? maximumLength:numberBytes;
+    memcpy(buffer, area+offset+4, numberCopied);
+
+    //Give room back to producer
+    header->tail.store(tail+((4+numberBytes+SHM_RING_ALIGNMENT-1)&~(SHM_RING_ALIGNMENT-1)), memory_order_release);
+    return numberCopied;
+}
+
+bool
+ShmRing::wait(
+    int timeout)            //Maximum waiting time in milliseconds
+{
+    uint32_t tail = header->tail.load(memory_order_relaxed);
+    if(header->head.load(memory_order_acquire)!=tail)
+        return true;
+
+    //Same protocol as a blocking pop, but futex wait gives up after timeout (it is relative)
+    struct timespec timeoutSpec = {timeout/1000, (timeout%1000)*1000000L};
+    uint32_t wakeups = header->wakeups.load();
+    header->consumerWaiting.store(1);
+    if(header->head.load()==tail)
+        syscall(SYS_futex, &(header->wakeups), FUTEX_WAIT, wakeups, &timeoutSpec, NULL, 0);
+    header->consumerWaiting.store(0);
+    return header->head.load(memory_order_acquire)!=tail;
+}
+
+void
+ShmRing::discard(){
+    header->tail.store(header->head.load(memory_order_acquire), memory_order_release);
+}
@@ -0,0 +1,90 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+
+#ifndef INCLUDED_SHM_RING_H
+#define INCLUDED_SHM_RING_H
+
+#include <atomic>       //std::atomic
+#include <stdint.h>     //uint32_t
+#include <stddef.h>     //size_t
+#include <sys/types.h>  //ssize_t
+
+using namespace std;
+
+#define SHM_RING_CAPACITY (1<<20)       //Bytes of message area of each ring; power of 2
+#define SHM_RING_ALIGNMENT 4            //Messages start at multiples of 4 bytes, after a 4-byte length
+#define SHM_RING_WRAP 0xFFFFFFFF        //Length written where a message did not fit before end of area: next one starts at beginning
+#define CACHE_LINE_LENGTH 64            //Bytes of a cache line; producer and consumer indexes are kept in separate lines
+
+/**
+ * @brief Control block of a ring, placed in shared memory before its message area
+ * Positions grow forever (modulo 2^32); position modulo SHM_RING_CAPACITY is the offset in message area.
+ */
+typedef struct{
+    alignas(CACHE_LINE_LENGTH) atomic<uint32_t> head;   //Position after last message published; written only by producer
+    alignas(CACHE_LINE_LENGTH) atomic<uint32_t> tail;   //Position of next message to be read; written only by consumer
+    alignas(CACHE_LINE_LENGTH) atomic<uint32_t> wakeups;            //Futex word: incremented by producer to wake consumer
+    atomic<uint32_t> consumerWaiting;                   //Flag set by consumer before it sleeps on futex word
+}ShmRingHeader;
+
+/**
+ * @brief Lock-free single-producer single-consumer ring of variable-length messages over a shared memory region
+ * Each side of the ring may be in a different process. Consumer sleeps on a futex when ring is empty; producer
+ * calls futex only if consumer announced it is sleeping, so a busy ring costs no system calls.
+ */
+class ShmRing{
+private:
+    ShmRingHeader* header;  //Control block in shared memory
+    char* area;             //Message area in shared memory, right after control block
+
+    /**
+     * @brief Wakes consumer if it is sleeping on futex
+     */
+    void wakeConsumer();
+
+public:
+    /**
+     * @brief Constructs a view of a ring placed in shared memory
+     * @param memory Start of ring: control block followed by SHM_RING_CAPACITY bytes
+     */
+    ShmRing(void* memory);
+
+    /**
+     * @brief Gets number of bytes of shared memory a ring takes
+     * @returns Size of control block plus message area
+     */
+    static size_t getRegionSize();
+
+    /**
+     * @brief [Producer] Publishes a message
+     * @param buffer Buffer containing message
+     * @param numberBytes Size of message in bytes
+     * @returns True if message was published; false if ring has no room for it (it is dropped, as a full socket would)
+     */
+    bool push(const char* buffer, size_t numberBytes);
+
+    /**
+     * @brief [Consumer] Takes next message
+     * @param buffer Buffer where message will be copied
+     * @param maximumLength Maximum message length in bytes; longer messages are truncated
+     * @param blocking If true, waits until a message is published
+     * @returns Size of message copied in bytes; -1 if ring is empty and call is not blocking
+     */
+    ssize_t pop(char* buffer, size_t maximumLength, bool blocking);
+
+    /**
+     * @brief [Consumer] Waits until a message is published, without taking it
+     * @param timeout Maximum waiting time in milliseconds
+     * @returns True if a message can be taken; false if timeout expired
+     */
+    bool wait(int timeout);
+
+    /**
+     * @brief [Consumer] Discards all messages published, e.g. those left in shared memory by a previous execution
+     */
+    void discard();
+};
+#endif  //INCLUDED_SHM_RING_H
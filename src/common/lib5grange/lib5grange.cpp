@@ -1,4 +1,5 @@
 #include "lib5grange.h"
+#include <cstring>
 
 namespace lib5grange{
 	size_t
@@ -95,7 +96,20 @@ namespace lib5grange{
 
 
 	void
-	MacPDU::serialize(vector<uint8_t> & bytes)
+	MacPDU::serialize(
+		vector<uint8_t> & bytes,        // Vector where bytes are appended
+		macpdu_wire_format_t format)    // Wire format
+	{
+		if (format==MACPDU_WIRE_LEGACY){
+			serialize_legacy(bytes);
+		}
+		else{
+			serialize_flat(bytes);
+		}
+	}
+
+	void
+	MacPDU::serialize_legacy(vector<uint8_t> & bytes)
 	{
 		push_bytes(bytes, numID_);
 		macphy_ctl_.serialize(bytes);
@@ -113,8 +127,82 @@ namespace lib5grange{
 		serialize_vector(bytes, mimo_symbols_[3]);
 	}
 
+	void
+	MacPDU::serialize_flat(vector<uint8_t> & bytes)
+	{
+		const uint8_t * data[NUM_MACPDU_SECTIONS] = {
+			mac_data_.data(),
+			coded_data_.data(),
+			(const uint8_t*) symbols_.data(),
+			control_data_.data(),
+			(const uint8_t*) control_symbols_.data(),
+			(const uint8_t*) mimo_symbols_[0].data(),
+			(const uint8_t*) mimo_symbols_[1].data(),
+			(const uint8_t*) mimo_symbols_[2].data(),
+			(const uint8_t*) mimo_symbols_[3].data()};
+		size_t length[NUM_MACPDU_SECTIONS] = {
+			mac_data_.size(),
+			coded_data_.size(),
+			symbols_.size()*sizeof(complex<float>),
+			control_data_.size(),
+			control_symbols_.size()*sizeof(complex<float>),
+			mimo_symbols_[0].size()*sizeof(complex<float>),
+			mimo_symbols_[1].size()*sizeof(complex<float>),
+			mimo_symbols_[2].size()*sizeof(complex<float>),
+			mimo_symbols_[3].size()*sizeof(complex<float>)};
+
+		// Header, in little-endian
+		macpdu_wire_header_t header {};
+		header.magic = htole16(MACPDU_WIRE_MAGIC);
+		header.version = MACPDU_WIRE_VERSION;
+		header.num_id = htole32(numID_);
+		header.subframe_number = htole32(macphy_ctl_.subframe_number);
+		header.sequence_number = macphy_ctl_.sequence_number;
+		header.last_tb_in_subframe = macphy_ctl_.last_tb_in_subframe;
+		header.first_tb_in_subframe = macphy_ctl_.first_tb_in_subframe;
+		header.target_ue_id = allocation_.target_ue_id;
+		header.first_rb = allocation_.first_rb;
+		header.number_of_rb = allocation_.number_of_rb;
+		header.mimo_scheme = htole32(mimo_.scheme);
+		header.num_tx_antenas = htole32(mimo_.num_tx_antenas);
+		header.precoding_mtx = htole32(mimo_.precoding_mtx);
+		header.modulation = htole32(mcs_.modulation);
+		header.power_offset = htole32(mcs_.power_offset);
+		header.num_info_bytes = htole32(mcs_.num_info_bytes);
+		header.num_coded_bytes = htole32(mcs_.num_coded_bytes);
+
+		// Sections follow the header, each one aligned
+		size_t offset = sizeof(macpdu_wire_header_t);
+		for (int i=0; i<NUM_MACPDU_SECTIONS; i++){
+			header.section_offset[i] = htole32(offset);
+			header.section_length[i] = htole32(length[i]);
+			offset += (length[i]+MACPDU_WIRE_ALIGNMENT-1) & ~(size_t)(MACPDU_WIRE_ALIGNMENT-1);
+		}
+		header.total_length = htole32(offset);
+
+		// One reservation, then bulk copies
+		const uint8_t padding[MACPDU_WIRE_ALIGNMENT] = {};
+		bytes.reserve(bytes.size()+offset);
+		bytes.insert(bytes.end(), (const uint8_t*) &header, (const uint8_t*) &header + sizeof(header));
+		for (int i=0; i<NUM_MACPDU_SECTIONS; i++){
+			if (length[i]){
+				bytes.insert(bytes.end(), data[i], data[i]+length[i]);
+			}
+			size_t pad = (MACPDU_WIRE_ALIGNMENT - length[i]%MACPDU_WIRE_ALIGNMENT) % MACPDU_WIRE_ALIGNMENT;
+			bytes.insert(bytes.end(), padding, padding+pad);
+		}
+	}
+
 	MacPDU::MacPDU(vector<uint8_t> & bytes)
 	{
+		// Flat format is recognized by its header and leaves bytes untouched
+		MacPDUView view;
+		if (view.parse(bytes.data(), bytes.size())){
+			view.to_macpdu(*this);
+			return;
+		}
+
+		// Legacy format is parsed from the back, consuming bytes
 		deserialize_vector(mimo_symbols_[3], bytes);
 		deserialize_vector(mimo_symbols_[2], bytes);
 		deserialize_vector(mimo_symbols_[1], bytes);
@@ -130,4 +218,87 @@ namespace lib5grange{
 		macphy_ctl_.deserialize(bytes);
 		pop_bytes(numID_, bytes);
 	}
+
+	bool
+	MacPDUView::parse(
+		const uint8_t * buffer,     // Serialized PDU
+		size_t size)                // Size of buffer in bytes
+	{
+		if (size<sizeof(macpdu_wire_header_t)){
+			return false;
+		}
+		memcpy(&header_, buffer, sizeof(header_));
+		if (le16toh(header_.magic)!=MACPDU_WIRE_MAGIC || header_.version!=MACPDU_WIRE_VERSION){
+			return false;
+		}
+
+		header_.magic = MACPDU_WIRE_MAGIC;
+		header_.total_length = le32toh(header_.total_length);
+		header_.num_id = le32toh(header_.num_id);
+		header_.subframe_number = le32toh(header_.subframe_number);
+		header_.mimo_scheme = le32toh(header_.mimo_scheme);
+		header_.num_tx_antenas = le32toh(header_.num_tx_antenas);
+		header_.precoding_mtx = le32toh(header_.precoding_mtx);
+		header_.modulation = le32toh(header_.modulation);
+		header_.power_offset = le32toh(header_.power_offset);
+		header_.num_info_bytes = le32toh(header_.num_info_bytes);
+		header_.num_coded_bytes = le32toh(header_.num_coded_bytes);
+		if (header_.total_length>size){
+			return false;
+		}
+		for (int i=0; i<NUM_MACPDU_SECTIONS; i++){
+			header_.section_offset[i] = le32toh(header_.section_offset[i]);
+			header_.section_length[i] = le32toh(header_.section_length[i]);
+			if (header_.section_offset[i]<sizeof(macpdu_wire_header_t) ||
+				(uint64_t) header_.section_offset[i]+header_.section_length[i]>header_.total_length){
+				return false;
+			}
+		}
+		buffer_ = buffer;
+		return true;
+	}
+
+	void
+	MacPDUView::get_configuration(MacPDU & pdu) const
+	{
+		pdu.numID_ = header_.num_id;
+		pdu.macphy_ctl_.sequence_number = header_.sequence_number;
+		pdu.macphy_ctl_.subframe_number = header_.subframe_number;
+		pdu.macphy_ctl_.last_tb_in_subframe = header_.last_tb_in_subframe;
+		pdu.macphy_ctl_.first_tb_in_subframe = header_.first_tb_in_subframe;
+		pdu.allocation_.target_ue_id = header_.target_ue_id;
+		pdu.allocation_.first_rb = header_.first_rb;
+		pdu.allocation_.number_of_rb = header_.number_of_rb;
+		pdu.mimo_.scheme = (mimo_scheme_t) header_.mimo_scheme;
+		pdu.mimo_.num_tx_antenas = header_.num_tx_antenas;
+		pdu.mimo_.precoding_mtx = header_.precoding_mtx;
+		pdu.mcs_.modulation = (qammod_t) header_.modulation;
+		pdu.mcs_.power_offset = header_.power_offset;
+		pdu.mcs_.num_info_bytes = header_.num_info_bytes;
+		pdu.mcs_.num_coded_bytes = header_.num_coded_bytes;
+	}
+
+	/** Copies a section of the view into a vector **/
+	template <typename T>
+	static void copy_section(vector<T> & v, const uint8_t * data, size_t length)
+	{
+		v.resize(length/sizeof(T));
+		if (length){
+			memcpy((void*) v.data(), data, v.size()*sizeof(T));
+		}
+	}
+
+	void
+	MacPDUView::to_macpdu(MacPDU & pdu) const
+	{
+		get_configuration(pdu);
+		copy_section(pdu.mac_data_, section(SECTION_MAC_DATA), section_length(SECTION_MAC_DATA));
+		copy_section(pdu.coded_data_, section(SECTION_CODED_DATA), section_length(SECTION_CODED_DATA));
+		copy_section(pdu.symbols_, section(SECTION_SYMBOLS), section_length(SECTION_SYMBOLS));
+		copy_section(pdu.control_data_, section(SECTION_CONTROL_DATA), section_length(SECTION_CONTROL_DATA));
+		copy_section(pdu.control_symbols_, section(SECTION_CONTROL_SYMBOLS), section_length(SECTION_CONTROL_SYMBOLS));
+		for (int i=0; i<4; i++){
+			copy_section(pdu.mimo_symbols_[i], section((macpdu_section_t)(SECTION_MIMO_SYMBOLS_0+i)), section_length((macpdu_section_t)(SECTION_MIMO_SYMBOLS_0+i)));
+		}
+	}
 }//namespace lib5grange
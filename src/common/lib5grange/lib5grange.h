@@ -12,6 +12,7 @@
 #include <complex.h>
 #include <vector>
 #include <array>
+#include <endian.h>
 
 #define ALL_TERMINAL (0xF)
 #define BS_TERMINAL  (0x0)
@@ -23,6 +24,11 @@
 #define POLAR_MAX_CW_LEN (2048)
 #define POLAR_CRC_LEN (16)
 
+/** MacPDU flat wire format **/
+#define MACPDU_WIRE_MAGIC (0x4735)      /**< "5G", first two bytes of a flat serialized MacPDU **/
+#define MACPDU_WIRE_VERSION (1)         /**< Version of the flat layout **/
+#define MACPDU_WIRE_ALIGNMENT (8)       /**< Every section starts at a multiple of 8 bytes from the start of the PDU **/
+
 /** DCI Size in QAM symbols **/
 #define DCI_SIZE (256)
 #define NUM_TB_PER_DCI (8)
@@ -332,6 +338,61 @@ namespace lib5grange {
         }
     } macphyctl_t;
 
+    /** Wire formats of a serialized MacPDU **/
+    typedef enum {
+        MACPDU_WIRE_LEGACY = 0, /**< Members pushed byte by byte, vector lengths after their data; parsed from the back **/
+        MACPDU_WIRE_FLAT = 1    /**< Fixed little-endian header with offsets and lengths, followed by the sections **/
+    } macpdu_wire_format_t;
+
+    /** Data sections of a MacPDU, in the order they follow the flat header **/
+    typedef enum {
+        SECTION_MAC_DATA = 0,
+        SECTION_CODED_DATA,
+        SECTION_SYMBOLS,
+        SECTION_CONTROL_DATA,
+        SECTION_CONTROL_SYMBOLS,
+        SECTION_MIMO_SYMBOLS_0,
+        SECTION_MIMO_SYMBOLS_1,
+        SECTION_MIMO_SYMBOLS_2,
+        SECTION_MIMO_SYMBOLS_3,
+        NUM_MACPDU_SECTIONS
+    } macpdu_section_t;
+
+    /**
+     * @brief Header of a MacPDU in flat wire format
+     *
+     * All fields are little-endian and naturally aligned, so the layout is the same on every compiler.
+     * Offsets are counted from the start of the header and lengths are in bytes. Sizes kept as size_t
+     * in the configuration structs are carried in 32 bits.
+     */
+    typedef struct {
+        uint16_t magic;                 /**< MACPDU_WIRE_MAGIC **/
+        uint8_t  version;               /**< MACPDU_WIRE_VERSION **/
+        uint8_t  reserved0;
+        uint32_t total_length;          /**< Header plus sections, padding included **/
+        uint32_t num_id;                /**< Numerology ID **/
+        uint32_t subframe_number;
+        uint8_t  sequence_number;
+        uint8_t  last_tb_in_subframe;
+        uint8_t  first_tb_in_subframe;
+        uint8_t  target_ue_id;
+        uint8_t  first_rb;
+        uint8_t  number_of_rb;
+        uint16_t reserved1;
+        uint32_t mimo_scheme;
+        uint32_t num_tx_antenas;
+        uint32_t precoding_mtx;
+        uint32_t modulation;
+        uint32_t power_offset;
+        uint32_t num_info_bytes;
+        uint32_t num_coded_bytes;
+        uint32_t reserved2;             /**< Keeps the first section aligned **/
+        uint32_t section_offset[NUM_MACPDU_SECTIONS];
+        uint32_t section_length[NUM_MACPDU_SECTIONS];
+    } macpdu_wire_header_t;
+
+    static_assert(sizeof(macpdu_wire_header_t)==128, "Flat MacPDU header layout changed");
+
     /**
     * Calculates the  amout of bytes available for transmission using the given configuration
     * @param numID: (0 - 5) Number identifying the 5G Range numerology according to D3.2.
@@ -433,9 +494,62 @@ namespace lib5grange {
             /** @brief Destroy the MacPDU object **/
             ~MacPDU(){};
 
-            /** Serializes the MacPDU object to a sequance of bytes **/
-            void serialize(vector<uint8_t> & bytes);
+            /**
+             * @brief Serializes the MacPDU object to a sequance of bytes, appended to the vector given
+             * @param bytes: vector where the bytes will be appended
+             * @param format: wire format; MACPDU_WIRE_LEGACY is kept for peers that do not parse the flat one
+             */
+            void serialize(vector<uint8_t> & bytes, macpdu_wire_format_t format = MACPDU_WIRE_FLAT);
+
+        private:
+            /** @brief Appends the flat format: one reserve, then header and sections copied in bulk **/
+            void serialize_flat(vector<uint8_t> & bytes);
+
+            /** @brief Appends the legacy format **/
+            void serialize_legacy(vector<uint8_t> & bytes);
 
     }; /* class MacPDU */
+
+    /**
+     * @brief Read-only view of a MacPDU in flat wire format, over the buffer where it was received
+     *
+     * Nothing is copied: sections are pointers into the buffer, which must outlive the view.
+     * Sections of complex<float> are only aligned if the buffer is aligned to MACPDU_WIRE_ALIGNMENT.
+     */
+    class MacPDUView {
+        private:
+            const uint8_t * buffer_ = nullptr;  /**< Start of serialized PDU **/
+            macpdu_wire_header_t header_ {};    /**< Header converted to host byte order **/
+
+        public:
+            /**
+             * @brief Parses the header of a flat serialized MacPDU and checks every section lies inside the buffer
+             * @param buffer: serialized PDU
+             * @param size: size of buffer in bytes
+             * @returns true if buffer holds a valid flat PDU; false if it is legacy or malformed
+             */
+            bool parse(const uint8_t * buffer, size_t size);
+
+            /** @brief Fills the configuration members of a MacPDU from the header **/
+            void get_configuration(MacPDU & pdu) const;
+
+            /** @brief Start of a section in the buffer **/
+            const uint8_t * section(macpdu_section_t s) const { return buffer_ + header_.section_offset[s]; }
+
+            /** @brief Length of a section in bytes **/
+            size_t section_length(macpdu_section_t s) const { return header_.section_length[s]; }
+
+            /** @brief Uncoded information bytes from MAC **/
+            const uint8_t * mac_data() const { return section(SECTION_MAC_DATA); }
+
+            /** @brief Number of uncoded information bytes from MAC **/
+            size_t mac_data_size() const { return section_length(SECTION_MAC_DATA); }
+
+            /** @brief Total length of the serialized PDU in bytes **/
+            size_t total_length() const { return header_.total_length; }
+
+            /** @brief Copies the view into a MacPDU object **/
+            void to_macpdu(MacPDU & pdu) const;
+    }; /* class MacPDUView */
 } /* namespace lib5grange */
 #endif /* INCLUDED_LIB5GRANGE_H */
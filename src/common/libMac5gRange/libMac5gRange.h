@@ -20,6 +20,9 @@ enum MacTxModes {ACTIVE_MODE_TX, DISABLED_MODE_TX};
 enum MacRxModes {ACTIVE_MODE_RX, DISABLED_MODE_RX};
 enum MacTunModes {TUN_ENABLED, TUN_DISABLED};
 
+#define HARQ_PROCESS_NONE 127           //macphyctl_t::sequence_number of transport blocks sent without HARQ (its 7 LSBs carry HARQ process ID)
+#define HARQ_NEW_DATA_INDICATOR 128     //macphyctl_t::sequence_number bit carrying new data indicator
+
 
 /**
  * @brief Struct for BSSubframeTx.Start, as defined in L1-L2_InterfaceDefinition.xlsx
@@ -122,7 +125,9 @@ typedef struct{
  * @brief Struct for BSSubframeRx.Start, as defined in L1-L2_InterfaceDefinition.xlsx
  */
 typedef struct{
-    float sinr;         //Signal to Interference plus Noise Ratio //#TODO: define range. Is float enough?
+    float sinr;             //Signal to Interference plus Noise Ratio //#TODO: define range. Is float enough?
+    uint8_t ueId;           //MAC Address of UE that transmitted in the reservation, known even if transport block has CRC error
+    uint8_t harqProcess;    //macphyctl_t::sequence_number of transport block received (HARQ process ID and new data indicator)
     
     /**
      * @brief Serialization method for the struct
@@ -134,11 +139,15 @@ typedef struct{
     void serialize(vector<uint8_t> & bytes)
     {
         push_bytes(bytes, sinr);
+        push_bytes(bytes, ueId);
+        push_bytes(bytes, harqProcess);
     }
 
     /** deserializatyion method for the struct (inverse order)**/
     void deserialize(vector<uint8_t> & bytes)
     {
+        pop_bytes(harqProcess, bytes);
+        pop_bytes(ueId, bytes);
         pop_bytes(sinr, bytes);
     }
 }BSSubframeRx_Start;
@@ -151,6 +160,7 @@ typedef struct{
     uint8_t ri;         //RI (Rank Indicator), part of RxMetrics.               //#TODO: define range
     uint8_t pmi;        //PMI: Pre-Coding Matrix Indicator, part of RxMetrics.  //#TODO: define range
     uint8_t ssm[17];    //SSM: Spectrum Sensing Measurement. Array of 132 bits
+    uint8_t harqProcess;//macphyctl_t::sequence_number of transport block received (HARQ process ID and new data indicator)
     
     /**
      * @brief Serialization method for the struct
@@ -168,12 +178,14 @@ typedef struct{
             push_bytes(bytes, ssm[i]);
         auxiliary = (ri<<4)|ssm[16];
         push_bytes(bytes, auxiliary);
+        push_bytes(bytes, harqProcess);
     }
 
     /** deserializatyion method for the struct (inverse order)**/
     void deserialize(vector<uint8_t> & bytes)
     {
         uint8_t auxiliary;
+        pop_bytes(harqProcess, bytes);
         pop_bytes(auxiliary, bytes);
         ri = (auxiliary>>4)&15;
         ssm[16] = auxiliary&15;
@@ -233,4 +245,36 @@ typedef struct{
         pop_bytes(cqiReport, bytes);
     }
 }RxMetrics;
+
+/**
+ * @brief Struct for HarqFeedback message: ACK/NACK of a transport block. L2 sends it to L1 for transport blocks received; 
+ * L1 sends it to L2 for transport blocks L2 transmitted
+ */
+typedef struct{
+    uint8_t ueId;           //MAC Address of UE that transmitted (from L2) or received (from L1) the transport block
+    uint8_t harqProcess;    //HARQ process ID
+    uint8_t ack;            //1 for ACK; 0 for NACK
+
+    /**
+     * @brief Serialization method for the struct
+     * This method convert all menbers of the struct to a sequance of bytes and appends at the end
+     * of the vector given as argument
+     *
+     * @param bytes: vector of bytes where the struct will be serialized
+     **/
+    void serialize(vector<uint8_t> & bytes)
+    {
+        push_bytes(bytes, ueId);
+        push_bytes(bytes, harqProcess);
+        push_bytes(bytes, ack);
+    }
+
+    /** deserializatyion method for the struct (inverse order)**/
+    void deserialize(vector<uint8_t> & bytes)
+    {
+        pop_bytes(ack, bytes);
+        pop_bytes(harqProcess, bytes);
+        pop_bytes(ueId, bytes);
+    }
+}HarqFeedback;
 #endif  //INCLUDED_LIB_MAC_5G_RANGE_H
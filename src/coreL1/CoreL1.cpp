@@ -26,24 +26,26 @@ UA : 1230 - Centro de Competencia - Sistemas Embarcados
 #include <thread>
 using namespace std;
 
-#define PORT_TO_L2 8091
-#define PORT_FROM_L2 8090
-
 #include "StubPHYLayer.h"
 
 int main(int argc, char** argv){
     int numberEquipments;           //Number of attached equipments
     int counter = 0;                //Counter to help assigning threads
     bool verbose = false;
+    InterlayerTransports interlayerTransport = UDP_TRANSPORT;   //Transport used to exchange messages with L2
     if(argc<4){
-        cout<<"Usage: ./a.out numberEquipments ip1 port1 mac1 ... ipN portN macN --v"<<endl;
+        cout<<"Usage: ./a.out numberEquipments ip1 port1 mac1 ... ipN portN macN [--shm] [--v]"<<endl;
         exit(1);
     }
 
     numberEquipments = argv[1][0]-48;
 
-    verbose = (argc==2+numberEquipments*3+1);
-    CoreL1* l1 = new CoreL1(verbose);   //Create object CoreL1 with no verbose
+    //Options after equipments: --shm selects shared memory transport to L2 (L2 must be started with --transport shm)
+    for(int i=2+numberEquipments*3;i<argc;i++){
+        if(strcmp(argv[i],"--shm")==0) interlayerTransport = SHARED_MEMORY_TRANSPORT;
+        else verbose = true;
+    }
+    CoreL1* l1 = new CoreL1(interlayerTransport, verbose);
 
     for(int i=0;i<numberEquipments;i++)
         l1->addSocket(argv[2+3*i], strtol(argv[2+3*i+1], NULL, 10), argv[2+3*i+2][0]-48);
@@ -20,28 +20,21 @@ Direction : Diretoria de Operações (DO)
 UA : 1230 - Centro de Competencia - Sistemas Embarcados
 
 @Description : This is a stub module that simulates the physical layer transmission and reception.
-    UDP sockets are used on transmitter and receiver sides to exchange packets.
+    UDP sockets are used on transmitter and receiver sides to exchange packets; L2 is reached
+    through UDP sockets or shared memory rings.
 */
 
 #include "StubPHYLayer.h"
 
 CoreL1::CoreL1(
-    bool _verbose)  //Verbosity flag
+    InterlayerTransports transportType,     //Transport used to exchange messages with L2
+    bool _verbose)                          //Verbosity flag
 {
     verbose = _verbose;
     numberSockets = 0;
 
-    //PDUs Client socket creation
-    socketToL2 = createClientSocketToSendMessages(PORT_TO_L2, &serverPdusSocketAddress, "127.0.0.1");
-
-    //PDUs Server socket creation
-    socketFromL2 = createServerSocketToReceiveMessages(PORT_FROM_L2);
-    
-    //Control Client socket creation
-    socketControlMessagesToL2 = createClientSocketToSendMessages(CONTROL_MESSAGES_PORT_TO_L2, &serverControlMessagesSocketAddress, "127.0.0.1");
-
-    //ControlServer socket creation
-    socketControlMessagesFromL2 = createServerSocketToReceiveMessages(CONTROL_MESSAGES_PORT_FROM_L2);
+    //Transport creation: sockets or rings to send and receive PDUs and Control Messages
+    transport = InterlayerTransport::create(transportType, false, verbose);
 }
 
 CoreL1::~CoreL1()
@@ -50,8 +43,7 @@ CoreL1::~CoreL1()
         close(socketsIn[i]);
         close(socketsOut[i]);
     }
-    close(socketFromL2);
-    close(socketToL2);
+    delete transport;
     if(numberSockets){
         delete[] socketsIn;
         delete[] socketsOut;
@@ -224,6 +216,40 @@ CoreL1::receivePdu(
     return recv(socketsIn[getSocketIndex((uint16_t)port)], (void*) buffer, maxSiz, MSG_WAITALL);
 }
 
+int
+CoreL1::receivePdus(
+    char* buffers,          //Array of information buffers
+    size_t maxSiz,          //Maximum size of each buffer
+    ssize_t* sizes,         //Array of PDU sizes
+    int maximumPdus,        //Maximum number of PDUs
+    uint16_t port)          //Port of receiving socket
+{
+    struct iovec vectors[DECODING_BATCH_SIZE];      //Vector pointing to each buffer
+    struct mmsghdr headers[DECODING_BATCH_SIZE];    //Header of each datagram
+
+    //Verify if socket exists
+    int socketIn = getSocketIndex((uint16_t)port);
+    if(socketIn==-1){
+        if(verbose) cout<<"[CoreL1] Socket not found."<<endl;
+        return -1;
+    }
+
+    if(maximumPdus>DECODING_BATCH_SIZE) maximumPdus = DECODING_BATCH_SIZE;
+    bzero(headers, maximumPdus*sizeof(struct mmsghdr));
+    for(int i=0;i<maximumPdus;i++){
+        vectors[i].iov_base = buffers+i*maxSiz;
+        vectors[i].iov_len = maxSiz;
+        headers[i].msg_hdr.msg_iov = &(vectors[i]);
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    //Waits for first PDU only; the others are taken if they already arrived
+    int numberPdus = recvmmsg(socketsIn[socketIn], headers, maximumPdus, MSG_WAITFORONE, NULL);
+    for(int i=0;i<numberPdus;i++)
+        sizes[i] = headers[i].msg_len;
+    return numberPdus;
+}
+
 int 
 CoreL1::getSocketIndex(
     uint16_t port)  //Socket port
@@ -254,11 +280,25 @@ CoreL1::encoding(){
     bzero(buffer, MAXIMUMSIZE);
 
     //Receive from L2
-    size = recv(socketFromL2, buffer, MAXIMUMSIZE, MSG_WAITALL);
+    size = transport->receive(L2_TO_L1_PDUS, buffer, MAXIMUMSIZE, true);
+    if(size<=0){
+        if(verbose) cout<<"[CoreL1] Could not receive PDU from L2."<<endl;
+        return;
+    }
+
+    //Flat PDUs are read in place; legacy ones are deserialized
+    MacPDUView macPduView;
+    if(macPduView.parse((const uint8_t*) buffer, size)){
+        //#TODO: Remove this part of code because PHY will not send MAC PDUs via sockets
+        macAddress = (macPduView.mac_data()[0])&15;
+
+        //Send PDU through correct port
+        sendPdu((const char*) macPduView.mac_data(), macPduView.mac_data_size(), ports[getSocketIndex(macAddress)]);
+        return;
+    }
 
-    //Deserialize MAC PDU received
+    //Deserialize MAC PDU received in legacy format
 	vector<uint8_t> serializedMacPdu;
-	serializedMacPdu.resize(size);
 	serializedMacPdu.assign(buffer, buffer+size);
 	MacPDU macPdu(serializedMacPdu);
 
@@ -273,8 +313,9 @@ void
 CoreL1::decoding(
     uint8_t macAddress)
 { 
-    char buffer[MAXIMUMSIZE];       //Buffer to store packet incoming
-    ssize_t size;                   //Size of packet received
+    char* buffers = new char[DECODING_BATCH_SIZE*MAXIMUMSIZE];     //Buffers to store packets incoming
+    ssize_t sizes[DECODING_BATCH_SIZE];                             //Size of each packet received
+    int numberPdus;                                                 //Number of packets received at once
     bool flagBS = (macAddress!=0);  //Flag to indicate if it is BaseStation (true) or UserEquipment (false)   
 
     //Create SubframeRx.Start message
@@ -284,6 +325,8 @@ CoreL1::decoding(
     if(flagBS){     //Create BSSubframeRx.Start message
     	BSSubframeRx_Start messageBS;	//Message parameters structure
     	messageBS.sinr = 10;    
+        messageBS.ueId = macAddress;
+        messageBS.harqProcess = HARQ_PROCESS_NONE;  //Stub does not decode MAC/PHY control, so HARQ is not fed back
     	messageBS.serialize(messageParametersBytes);
     	for(uint i=0;i<messageParametersBytes.size();i++)
     		messageParameters+=messageParametersBytes[i];
@@ -293,6 +336,7 @@ CoreL1::decoding(
         messageUE.sinr = 11;
         messageUE.pmi = 1;
         messageUE.ri = 2;
+        messageUE.harqProcess = HARQ_PROCESS_NONE;
         for(int i=0;i<17;i++)
             messageUE.ssm[i]=0;
         messageUE.serialize(messageParametersBytes);
@@ -309,24 +353,42 @@ CoreL1::decoding(
     //Add parameters
     subFrameStartMessage+=messageParameters;
 
-    //Clear buffer
-    bzero(buffer, MAXIMUMSIZE);
+    //Under load, several PDUs are taken from air at once and forwarded with a single batch
+    vector<InterlayerMessage> messages(3*DECODING_BATCH_SIZE);      //SubframeRx.Start, PDU and SubframeRx.End of each PDU
+    for(int i=0;i<DECODING_BATCH_SIZE;i++){
+        messages[3*i].channel = L1_TO_L2_CONTROL;
+        messages[3*i].buffer = &(subFrameStartMessage[0]);
+        messages[3*i].numberBytes = subFrameStartMessage.size();
+        messages[3*i+1].channel = L1_TO_L2_PDUS;
+        messages[3*i+1].buffer = buffers+i*MAXIMUMSIZE;
+        messages[3*i+2].channel = L1_TO_L2_CONTROL;
+        messages[3*i+2].buffer = &(subFrameEndMessage[0]);
+        messages[3*i+2].numberBytes = subFrameEndMessage.size();
+    }
 
-    size = receivePdu(buffer, MAXIMUMSIZE, ports[getSocketIndex(macAddress)]);
+    numberPdus = receivePdus(buffers, MAXIMUMSIZE, sizes, DECODING_BATCH_SIZE, ports[getSocketIndex(macAddress)]);
 
     //Communication Stream
-    while(size>0){
-        if(verbose) cout<<"[CoreL1] PDU with size "<<(int)size<<" received."<<endl;
+    while(numberPdus>0){
+        int numberMessages = 0;     //Number of messages of PDUs received before an empty one
+        for(int i=0;i<numberPdus && sizes[i]>0;i++){
+            if(verbose) cout<<"[CoreL1] PDU with size "<<(int)sizes[i]<<" received."<<endl;
+            messages[3*i+1].numberBytes = sizes[i];
+            numberMessages+=3;
+        }
 
-        //Send control messages and PDU to L2
-        sendto(socketControlMessagesToL2, &(subFrameStartMessage[0]), subFrameStartMessage.size(), MSG_CONFIRM, (const struct sockaddr*)(&serverControlMessagesSocketAddress), sizeof(serverControlMessagesSocketAddress));
-        sendto(socketToL2, buffer, size, MSG_CONFIRM, (const struct sockaddr*)(&serverPdusSocketAddress), sizeof(serverPdusSocketAddress));
-        sendto(socketControlMessagesToL2, &(subFrameEndMessage[0]), subFrameEndMessage.size(), MSG_CONFIRM, (const struct sockaddr*)(&serverControlMessagesSocketAddress), sizeof(serverControlMessagesSocketAddress));
+        //Send control messages and PDUs to L2; other decoding threads must not interleave their messages
+        if(numberMessages>0){
+            lock_guard<mutex> lk(l2SendMutex);
+            transport->sendBatch(&(messages[0]), numberMessages);
+        }
+        if(numberMessages<3*numberPdus)
+            break;
 
-        //Receive next PDU
-        bzero(buffer, MAXIMUMSIZE);
-        size = receivePdu(buffer, MAXIMUMSIZE, ports[getSocketIndex(macAddress)]);
+        //Receive next PDUs
+        numberPdus = receivePdus(buffers, MAXIMUMSIZE, sizes, DECODING_BATCH_SIZE, ports[getSocketIndex(macAddress)]);
     }
+    delete [] buffers;
 }
 
 void
@@ -334,7 +396,8 @@ CoreL1::sendInterlayerMessage(
     char* buffer,           //Buffer containing message
     size_t numberBytes)     //Size of message in Bytes
 {
-    if(sendto(socketControlMessagesToL2, buffer, numberBytes, MSG_CONFIRM, (const struct sockaddr*)(&serverControlMessagesSocketAddress), sizeof(serverControlMessagesSocketAddress))==-1){
+    lock_guard<mutex> lk(l2SendMutex);
+    if(!transport->send(L1_TO_L2_CONTROL, buffer, numberBytes)){
         if(verbose) cout<<"[CoreL1] Error sending control message."<<endl;
     }
 }
@@ -343,7 +406,7 @@ void
 CoreL1::receiveInterlayerMessage(){
     char buffer[MAXIMUMSIZE];       //Buffer where message will be stored
     string message;                 //String containing message converted from char*
-    ssize_t messageSize = recv(socketControlMessagesFromL2, buffer, MAXIMUMSIZE, MSG_WAITALL);
+    ssize_t messageSize = transport->receive(L2_TO_L1_CONTROL, buffer, MAXIMUMSIZE, true);
 
     //Control message stream
     while(messageSize>0){
@@ -361,10 +424,13 @@ CoreL1::receiveInterlayerMessage(){
             //Treat BSSubframeTx.Start parameters and trigger encoding MAC PDU to UE procedure
         	BSSubframeTx_Start messageParametersBS;
         	for(int i=subFrameStartSize;i<messageSize;i++)
-        		messageParametersBytes.push_back(message[i]);
+        		messageParametersBytes.push_back(buffer[i]);
         	messageParametersBS.deserialize(messageParametersBytes);
-        	if(verbose) cout<<"[CoreL1] Received BSSubframeTx.Start message. Receiving PDU from L2..."<<endl;
-			encoding();
+        	if(verbose) cout<<"[CoreL1] Received BSSubframeTx.Start message. Receiving "<<(int)messageParametersBS.numPDUs<<" PDUs from L2..."<<endl;
+
+            //BS subframe may carry PDUs to several UEs
+            for(int i=0;i<messageParametersBS.numPDUs;i++)
+			    encoding();
         }
         if(message=="UESubframeTx.Start"){
             //Treat UESubframeTx.Start parameters and trigger encoding MAC PDU to BS procedure
@@ -383,7 +449,7 @@ CoreL1::receiveInterlayerMessage(){
         //Clear buffer and message and receive next control message
         bzero(buffer, MAXIMUMSIZE);
         message.clear();
-        messageSize = recv(socketControlMessagesFromL2, buffer, MAXIMUMSIZE, MSG_WAITALL);
+        messageSize = transport->receive(L2_TO_L1_CONTROL, buffer, MAXIMUMSIZE, true);
     }
 }
 
@@ -7,12 +7,8 @@
 #ifndef INCLUDED_CORE_L1_H
 #define INCLUDED_CORE_L1_H
 
-#define PORT_TO_L2 8091
-#define PORT_FROM_L2 8090
-#define CONTROL_MESSAGES_PORT_TO_L2 8093
-#define CONTROL_MESSAGES_PORT_FROM_L2 8092
-
-#define MAXIMUMSIZE 2048
+#define MAXIMUMSIZE 32768     //Large enough for a serialized PDU of maximum transport block size
+#define DECODING_BATCH_SIZE 8   //Maximum number of PDUs taken from air at once and forwarded to L2 in a single batch
 
 #include <iostream>     //cout
 #include <stdint.h>     //uint16_t
@@ -22,8 +18,10 @@
 #include <vector>
 #include <unistd.h>     //close()
 #include <thread>       //thread
+#include <mutex>        //mutex
 #include "../common/lib5grange/lib5grange.h"
 #include "../common/libMac5gRange/libMac5gRange.h"
+#include "../common/InterlayerTransport/InterlayerTransport.h"
 
 using namespace std;
 using namespace lib5grange;
@@ -40,12 +38,8 @@ private:
     uint16_t *ports;                        //Array of ports used to define IN and OUT sockets 
     uint8_t *macAddresses;                  //Array of MAC addresses of each destination
     int numberSockets;                      //Number of actual sockets stored
-    int socketFromL2;                       //File descriptor of socket used to RECEIVE from L2
-    int socketToL2;                         //File descriptor of socket used to SEND to L2
-    int socketControlMessagesFromL2;        //File descriptor of socket used to RECEIVE Control Messages from L2
-    int socketControlMessagesToL2;          //File descriptor of socket used to SEND Control Messages to L2
-    struct sockaddr_in serverPdusSocketAddress; //Address of server to which client will send PDUs
-    struct sockaddr_in serverControlMessagesSocketAddress;  //Address of server to which client will send control messages
+    InterlayerTransport* transport;         //Transport (UDP sockets or shared memory) of PDUs and Control Messages to/from L2
+    mutex l2SendMutex;                      //Mutex to keep SubframeRx.Start, PDU and SubframeRx.End messages of each decoding thread together
     bool verbose;                           //Verbosity flag
 
     /**
@@ -68,9 +62,10 @@ public:
 
     /**
      * @brief Initializes a new instance of CoreL1 with 0 sockets
+     * @param transportType Transport used to exchange messages with L2
      * @param _verbose Verbosity flag
      */
-    CoreL1(bool _verbose);
+    CoreL1(InterlayerTransports transportType, bool _verbose);
 
     /**
      * @brief Destructor of CoreL1 object
@@ -112,6 +107,17 @@ public:
      */
     ssize_t receivePdu(const char* buffer, size_t maxSiz, uint16_t port);
 
+    /**
+     * @brief Receive all PDUs queued in socket identified by port, waiting for the first one
+     * @param buffers Array of maximumPdus buffers of maxSiz bytes, one after the other
+     * @param maxSiz Maximum size of each buffer
+     * @param sizes Array where length in bytes of each PDU received is stored
+     * @param maximumPdus Maximum number of PDUs received
+     * @param port Socket port to identify which socket to receive information
+     * @returns Number of PDUs received; -1 on error
+     */
+    int receivePdus(char* buffers, size_t maxSiz, ssize_t* sizes, int maximumPdus, uint16_t port);
+
     /**
      * @brief Get index of socket to send/receive information
      * @param port Socket port
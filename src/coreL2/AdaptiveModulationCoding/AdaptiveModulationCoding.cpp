@@ -24,6 +24,10 @@ UA : 1230 - Centro de Competencia - Sistemas Embarcados
 
 #include "AdaptiveModulationCoding.h"
 
+//Modulation and code rate of each MCS, in increasing order of spectral efficiency
+static const qammod_t mcsModulations[NUMBER_MCS] = {QPSK, QPSK, QPSK, QPSK, QPSK, QPSK, QPSK, QAM16, QAM16, QAM16, QAM64, QAM64, QAM64, QAM64, QAM64, QAM64};
+static const float mcsCodeRates[NUMBER_MCS] = {0.076, 0.076, 0.117, 0.188, 0.300, 0.438, 0.588, 0.369, 0.479, 0.602, 0.455, 0.554, 0.650, 0.754, 0.853, 0.926};
+
 AdaptiveModulationCoding::AdaptiveModulationCoding() {}
 
 AdaptiveModulationCoding::~AdaptiveModulationCoding() {}
@@ -32,9 +36,20 @@ uint8_t
 AdaptiveModulationCoding::getCqiConvertToMcs(
     uint8_t cqi)      //Channel Quality Information
 {
-    uint8_t mcs;  //Modulation and Coding Scheme
-    
-    //#TODO: do some calculations here with cqi and returns
-    mcs = 9;
-    return mcs;
+    //CQI indexes MCSs in increasing order of spectral efficiency; higher CQIs saturate at the highest MCS
+    return cqi<NUMBER_MCS? cqi:NUMBER_MCS-1;
+}
+
+qammod_t
+AdaptiveModulationCoding::getMcsConvertToModulation(
+    uint8_t mcs)      //Modulation and Coding Scheme
+{
+    return mcsModulations[mcs&(NUMBER_MCS-1)];
+}
+
+float
+AdaptiveModulationCoding::getMcsConvertToCodeRate(
+    uint8_t mcs)      //Modulation and Coding Scheme
+{
+    return mcsCodeRates[mcs&(NUMBER_MCS-1)];
 }
@@ -8,6 +8,11 @@
 #define INCLUDED_ADAPTIVE_MODULATION_CODING_H
 
 #include <stdint.h>     //uint8_t
+#include "../../common/lib5grange/lib5grange.h"
+
+using namespace lib5grange;
+
+#define NUMBER_MCS 16       //Number of Modulation and Coding Schemes (4 bits)
 
 /**
  * @brief Class to perform Adaptive Modulation and Coding calculations such as converting CQI-UL to Uplink-MCS
@@ -27,9 +32,24 @@ public:
 
     /**
      * @brief Based on CQI, performs calculation of MCS
+     * @param cqi Channel Quality Information reported by UE
      * @returns Modulation and Coding Scheme
      */
     static uint8_t getCqiConvertToMcs(uint8_t cqi);
+
+    /**
+     * @brief Gets modulation used by a Modulation and Coding Scheme
+     * @param mcs Modulation and Coding Scheme
+     * @returns QAM modulation
+     */
+    static qammod_t getMcsConvertToModulation(uint8_t mcs);
+
+    /**
+     * @brief Gets code rate used by a Modulation and Coding Scheme
+     * @param mcs Modulation and Coding Scheme
+     * @returns Code rate, between 0 and 1
+     */
+    static float getMcsConvertToCodeRate(uint8_t mcs);
 };
 
 #endif  //INCLUDED_ADAPTIVE_MODULATION_CODING_H
@@ -0,0 +1,450 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+/**
+@Arquive name : ArqEntity.cpp
+@Classification : ARQ
+@
+@Version : v1.0
+
+Project : H2020 5G-Range
+
+@Description : This module numbers MAC PDUs of each destination, resends those
+    reported missing by the receiver and, on reception, reorders PDUs so they
+    are decoded once and in sequence.
+*/
+
+#include "ArqEntity.h"
+
+ArqEntity::ArqEntity(
+    int _numberDestinations,                        //Number of destinations
+    TimerWheel* _timerWheel,                        //Timer wheel where poll and reordering timers are armed
+    function<void(int, vector<uint8_t> &)> _deliverPdu, //Procedure that decodes PDUs delivered in sequence
+    bool _verbose)                                  //Verbosity flag
+{
+    numberDestinations = _numberDestinations;
+    timerWheel = _timerWheel;
+    deliverPdu = _deliverPdu;
+    verbose = _verbose;
+
+    //Transmission side
+    txSlots = new ArqTxSlot*[numberDestinations];
+    for(int i=0;i<numberDestinations;i++){
+        txSlots[i] = new ArqTxSlot[ARQ_WINDOW_SIZE];
+        for(int j=0;j<ARQ_WINDOW_SIZE;j++){
+            txSlots[i][j].stored = false;
+            txSlots[i][j].pendingRetransmission = false;
+            txSlots[i][j].numberRetransmissions = 0;
+        }
+    }
+    txNext = new uint16_t[numberDestinations]();
+    txBase = new uint16_t[numberDestinations]();
+    pollTimers = new TimerHandle[numberDestinations]();
+
+    //Reception side
+    rxPdus = new vector<uint8_t>*[numberDestinations];
+    rxReceived = new bool*[numberDestinations];
+    for(int i=0;i<numberDestinations;i++){
+        rxPdus[i] = new vector<uint8_t>[ARQ_WINDOW_SIZE];
+        rxReceived[i] = new bool[ARQ_WINDOW_SIZE]();
+    }
+    rxNext = new uint16_t[numberDestinations]();
+    rxHighest = new uint16_t[numberDestinations]();
+    reorderingTargets = new uint16_t[numberDestinations]();
+    reorderingTimers = new TimerHandle[numberDestinations]();
+    reorderingIds = new uint32_t[numberDestinations]();
+    reorderingAttempts = new int[numberDestinations]();
+    pdusSinceStatus = new int[numberDestinations]();
+    statusRequired = new bool[numberDestinations]();
+    statusAllowedTicks = new uint64_t[numberDestinations]();
+}
+
+ArqEntity::~ArqEntity(){
+    for(int i=0;i<numberDestinations;i++){
+        timerWheel->cancel(pollTimers[i]);
+        timerWheel->cancel(reorderingTimers[i]);
+        delete [] txSlots[i];
+        delete [] rxPdus[i];
+        delete [] rxReceived[i];
+    }
+    delete [] txSlots;
+    delete [] txNext;
+    delete [] txBase;
+    delete [] pollTimers;
+    delete [] rxPdus;
+    delete [] rxReceived;
+    delete [] rxNext;
+    delete [] rxHighest;
+    delete [] reorderingTargets;
+    delete [] reorderingTimers;
+    delete [] reorderingIds;
+    delete [] reorderingAttempts;
+    delete [] pdusSinceStatus;
+    delete [] statusRequired;
+    delete [] statusAllowedTicks;
+}
+
+uint16_t
+ArqEntity::distance(
+    uint16_t from,  //First sequence number
+    uint16_t to)    //Second sequence number
+{
+    return (to-from)&(ARQ_SEQUENCE_MODULUS-1);
+}
+
+bool
+ArqEntity::isWindowOpen(
+    int index)      //Index of destination
+{
+    lock_guard<mutex> lk(txMutex);
+    return distance(txBase[index], txNext[index])<ARQ_WINDOW_SIZE;
+}
+
+void
+ArqEntity::startTransmission(
+    int index,                      //Index of destination
+    const PooledMacPdu & macPdu)    //Handle of PDU to be sent
+{
+    size_t crcLength = CrcCalculator::getCrcLength(CRC16_5GRANGE);   //Bytes of CRC at the end of PDU data
+    size_t numberBytes = macPdu->mac_data_.size();                     //Bytes of PDU data, CRC included
+    if(numberBytes<MAC_HEADER_LENGTH+crcLength)
+        return;
+
+    lock_guard<mutex> lk(txMutex);
+    uint16_t sequenceNumber = txNext[index];
+    uint16_t header = ARQ_SEQUENCE_FLAG|sequenceNumber;
+
+    //Sequence number goes in MAC header, after addresses and number of SDUs; it was zero when CRC was calculated
+    macPdu->mac_data_[SEQUENCE_NUMBER_OFFSET] = header>>8;
+    macPdu->mac_data_[SEQUENCE_NUMBER_OFFSET+1] = header&255;
+
+    //CRC is corrected for sequence number without reading the whole PDU again
+    char difference[2] = {(char)(header>>8), (char)(header&255)};
+    uint8_t* crcBytes = &(macPdu->mac_data_[numberBytes-crcLength]);
+    uint16_t crc = CrcCalculator::patch(CRC16_5GRANGE, (crcBytes[0]<<8)|crcBytes[1], difference, 2,
+                                        numberBytes-crcLength-SEQUENCE_NUMBER_OFFSET-2);
+    crcBytes[0] = crc>>8;
+    crcBytes[1] = crc&255;
+
+    ArqTxSlot & slot = txSlots[index][sequenceNumber%ARQ_WINDOW_SIZE];
+    slot.macPdu = macPdu;
+    slot.stored = true;
+    slot.pendingRetransmission = false;
+    slot.numberRetransmissions = 0;
+    txNext[index] = (sequenceNumber+1)%ARQ_SEQUENCE_MODULUS;
+
+    armPollTimer(index);
+}
+
+int
+ArqEntity::getRetransmission(
+    int index,                  //Index of destination
+    PooledMacPdu & macPdu)      //Variable where handle of PDU will be stored
+{
+    lock_guard<mutex> lk(txMutex);
+    uint16_t numberOutstanding = distance(txBase[index], txNext[index]);
+
+    for(uint16_t i=0;i<numberOutstanding;i++){
+        uint16_t sequenceNumber = (txBase[index]+i)%ARQ_SEQUENCE_MODULUS;
+        ArqTxSlot & slot = txSlots[index][sequenceNumber%ARQ_WINDOW_SIZE];
+        if(slot.stored && slot.pendingRetransmission){
+            macPdu = slot.macPdu;
+            return sequenceNumber;
+        }
+    }
+    return -1;
+}
+
+void
+ArqEntity::confirmRetransmission(
+    int index,              //Index of destination
+    int sequenceNumber)     //Sequence number of PDU
+{
+    lock_guard<mutex> lk(txMutex);
+    ArqTxSlot & slot = txSlots[index][sequenceNumber%ARQ_WINDOW_SIZE];
+
+    slot.pendingRetransmission = false;
+    slot.numberRetransmissions++;
+    armPollTimer(index);
+    if(verbose) cout<<"[ArqEntity] PDU "<<sequenceNumber<<" sent again ("<<slot.numberRetransmissions<<" retransmissions)."<<endl;
+}
+
+void
+ArqEntity::receiveStatus(
+    int index,                          //Index of destination
+    uint16_t ackSequenceNumber,         //Sequence number of first PDU not received in sequence
+    const vector<uint16_t> & nacks)     //Sequence numbers of PDUs missing after it
+{
+    if(index<0 || index>=numberDestinations)
+        return;
+
+    lock_guard<mutex> lk(txMutex);
+    uint16_t numberOutstanding = distance(txBase[index], txNext[index]);
+
+    //Status reports older than last one, or acknowledging PDUs never sent, are ignored
+    if(distance(txBase[index], ackSequenceNumber)>numberOutstanding)
+        return;
+
+    //Release PDUs acknowledged
+    while(txBase[index]!=ackSequenceNumber){
+        ArqTxSlot & slot = txSlots[index][txBase[index]%ARQ_WINDOW_SIZE];
+        slot.stored = false;
+        slot.macPdu.reset();
+        txBase[index] = (txBase[index]+1)%ARQ_SEQUENCE_MODULUS;
+    }
+
+    //Mark PDUs NACKed for retransmission, unless they were already resent too many times; these are left to upper layers
+    numberOutstanding = distance(txBase[index], txNext[index]);
+    for(size_t i=0;i<nacks.size();i++){
+        if(distance(txBase[index], nacks[i])>=numberOutstanding)
+            continue;
+        ArqTxSlot & slot = txSlots[index][nacks[i]%ARQ_WINDOW_SIZE];
+        if(!slot.stored || slot.pendingRetransmission)
+            continue;
+        if(slot.numberRetransmissions==MAXIMUM_ARQ_RETRANSMISSIONS){
+            if(verbose) cout<<"[ArqEntity] PDU "<<nacks[i]<<" given up after "<<MAXIMUM_ARQ_RETRANSMISSIONS<<" retransmissions."<<endl;
+            slot.stored = false;
+            slot.macPdu.reset();
+            continue;
+        }
+        slot.pendingRetransmission = true;
+    }
+
+    //Window starts at oldest PDU still stored
+    while(txBase[index]!=txNext[index] && !txSlots[index][txBase[index]%ARQ_WINDOW_SIZE].stored)
+        txBase[index] = (txBase[index]+1)%ARQ_SEQUENCE_MODULUS;
+
+    //Status report arrived: poll timer restarts if PDUs are still outstanding
+    timerWheel->cancel(pollTimers[index]);
+    armPollTimer(index);
+}
+
+void
+ArqEntity::armPollTimer(
+    int index)      //Index of destination
+{
+    if(pollTimers[index]!=INVALID_TIMER || txBase[index]==txNext[index])
+        return;
+    pollTimers[index] = timerWheel->arm(ARQ_POLL_TIMEOUT, [this, index](){ pollTimeout(index); });
+}
+
+void
+ArqEntity::pollTimeout(
+    int index)      //Index of destination
+{
+    lock_guard<mutex> lk(txMutex);
+    pollTimers[index] = INVALID_TIMER;
+
+    //Oldest PDU is sent again: either it was lost, or receiver answers the duplicate with a status report
+    if(txBase[index]!=txNext[index]){
+        ArqTxSlot & slot = txSlots[index][txBase[index]%ARQ_WINDOW_SIZE];
+        if(!slot.pendingRetransmission){
+            if(slot.numberRetransmissions==MAXIMUM_ARQ_RETRANSMISSIONS){
+                if(verbose) cout<<"[ArqEntity] PDU "<<txBase[index]<<" given up after "<<MAXIMUM_ARQ_RETRANSMISSIONS<<" retransmissions."<<endl;
+                slot.stored = false;
+                slot.macPdu.reset();
+                while(txBase[index]!=txNext[index] && !txSlots[index][txBase[index]%ARQ_WINDOW_SIZE].stored)
+                    txBase[index] = (txBase[index]+1)%ARQ_SEQUENCE_MODULUS;
+            }
+            else
+                slot.pendingRetransmission = true;
+        }
+    }
+    armPollTimer(index);
+}
+
+void
+ArqEntity::receivePdu(
+    int index,              //Index of source
+    char* pdu,              //PDU received
+    size_t numberBytes)     //Size of PDU in bytes
+{
+    vector<vector<uint8_t>> pdus;   //PDUs to be delivered, in sequence
+    uint16_t header = 0;            //Sequence number field of MAC header
+
+    if(numberBytes>=MAC_HEADER_LENGTH)
+        header = (((uint8_t)pdu[SEQUENCE_NUMBER_OFFSET])<<8)|((uint8_t)pdu[SEQUENCE_NUMBER_OFFSET+1]);
+
+    lock_guard<mutex> deliveryLock(deliveryMutex);
+
+    if(index<0 || index>=numberDestinations || !(header&ARQ_SEQUENCE_FLAG))
+        pdus.emplace_back(pdu, pdu+numberBytes);
+    else{
+        lock_guard<mutex> lk(rxMutex);
+        uint16_t sequenceNumber = header&(ARQ_SEQUENCE_MODULUS-1);
+        uint16_t slot = sequenceNumber%ARQ_WINDOW_SIZE;
+
+        if(++pdusSinceStatus[index]>=ARQ_STATUS_PERIOD)
+            statusRequired[index] = true;
+
+        //PDU already delivered, or waiting in window: receiver's status report was lost, so it is repeated
+        if(distance(rxNext[index], sequenceNumber)>=ARQ_WINDOW_SIZE || rxReceived[index][slot]){
+            if(verbose) cout<<"[ArqEntity] Duplicate PDU "<<sequenceNumber<<" dropped."<<endl;
+            statusRequired[index] = true;
+        }
+        else{
+            rxPdus[index][slot].assign(pdu, pdu+numberBytes);
+            rxReceived[index][slot] = true;
+            if(distance(rxNext[index], sequenceNumber)>=distance(rxNext[index], rxHighest[index]))
+                rxHighest[index] = (sequenceNumber+1)%ARQ_SEQUENCE_MODULUS;
+
+            //A gap before this PDU is reported right away
+            if(sequenceNumber!=rxNext[index])
+                statusRequired[index] = true;
+
+            takeInSequencePdus(index, pdus);
+
+            //Reordering timer stops once PDUs it waited for were received
+            uint16_t distanceTarget = distance(rxNext[index], reorderingTargets[index]);
+            if(reorderingTimers[index]!=INVALID_TIMER && (distanceTarget==0 || distanceTarget>distance(rxNext[index], rxHighest[index]))){
+                timerWheel->cancel(reorderingTimers[index]);
+                reorderingIds[index]++;
+                reorderingAttempts[index] = 0;
+            }
+            armReorderingTimer(index);
+        }
+    }
+
+    for(size_t i=0;i<pdus.size();i++)
+        deliverPdu(index, pdus[i]);
+}
+
+void
+ArqEntity::takeInSequencePdus(
+    int index,                          //Index of source
+    vector<vector<uint8_t>> & pdus)     //List where PDUs are appended
+{
+    while(rxReceived[index][rxNext[index]%ARQ_WINDOW_SIZE]){
+        uint16_t slot = rxNext[index]%ARQ_WINDOW_SIZE;
+        pdus.push_back(move(rxPdus[index][slot]));
+        rxPdus[index][slot].clear();
+        rxReceived[index][slot] = false;
+        rxNext[index] = (rxNext[index]+1)%ARQ_SEQUENCE_MODULUS;
+    }
+}
+
+void
+ArqEntity::armReorderingTimer(
+    int index)      //Index of source
+{
+    if(reorderingTimers[index]!=INVALID_TIMER || rxNext[index]==rxHighest[index])
+        return;
+
+    uint32_t reorderingId = ++reorderingIds[index];
+    reorderingTargets[index] = rxHighest[index];
+    reorderingTimers[index] = timerWheel->arm(ARQ_REORDERING_TIMEOUT, [this, index, reorderingId](){ reorderingTimeout(index, reorderingId); });
+}
+
+void
+ArqEntity::reorderingTimeout(
+    int index,                  //Index of source
+    uint32_t reorderingId)      //Reordering that armed the timer
+{
+    vector<vector<uint8_t>> pdus;   //PDUs to be delivered, in sequence
+    int numberSkipped = 0;          //Number of PDUs given up
+
+    lock_guard<mutex> deliveryLock(deliveryMutex);
+    {
+        lock_guard<mutex> lk(rxMutex);
+        if(reorderingIds[index]!=reorderingId)
+            return;
+        reorderingTimers[index] = INVALID_TIMER;
+        statusRequired[index] = true;
+
+        //Missing PDUs are NACKed again while transmitter may still be resending them
+        if(++reorderingAttempts[index]<ARQ_REORDERING_ATTEMPTS){
+            uint32_t nextReorderingId = ++reorderingIds[index];
+            reorderingTimers[index] = timerWheel->arm(ARQ_REORDERING_TIMEOUT, [this, index, nextReorderingId](){ reorderingTimeout(index, nextReorderingId); });
+            return;
+        }
+        reorderingAttempts[index] = 0;
+
+        //PDUs missing before target are skipped; PDUs received among them are delivered
+        while(rxNext[index]!=reorderingTargets[index]){
+            uint16_t slot = rxNext[index]%ARQ_WINDOW_SIZE;
+            if(rxReceived[index][slot]){
+                pdus.push_back(move(rxPdus[index][slot]));
+                rxPdus[index][slot].clear();
+                rxReceived[index][slot] = false;
+            }
+            else{
+                //Empty PDU tells decoder that segments following it do not continue SDUs before it
+                if(pdus.empty() || !pdus.back().empty())
+                    pdus.emplace_back();
+                numberSkipped++;
+            }
+            rxNext[index] = (rxNext[index]+1)%ARQ_SEQUENCE_MODULUS;
+        }
+        takeInSequencePdus(index, pdus);
+        armReorderingTimer(index);
+    }
+
+    if(verbose) cout<<"[ArqEntity] Reordering timeout: "<<numberSkipped<<" PDUs skipped."<<endl;
+    for(size_t i=0;i<pdus.size();i++)
+        deliverPdu(index, pdus[i]);
+}
+
+bool
+ArqEntity::getStatusReport(
+    int index,                  //Index of source
+    vector<uint8_t> & bytes)    //Status report MACC SDU
+{
+    uint64_t currentTick = timerWheel->getCurrentTick();
+    vector<uint16_t> nacks;     //Sequence numbers of PDUs missing
+
+    lock_guard<mutex> lk(rxMutex);
+    if(!statusRequired[index] || currentTick<statusAllowedTicks[index])
+        return false;
+
+    uint16_t numberPending = distance(rxNext[index], rxHighest[index]);
+    for(uint16_t i=0;i<numberPending && nacks.size()<MAXIMUM_ARQ_NACKS;i++){
+        uint16_t sequenceNumber = (rxNext[index]+i)%ARQ_SEQUENCE_MODULUS;
+        if(!rxReceived[index][sequenceNumber%ARQ_WINDOW_SIZE])
+            nacks.push_back(sequenceNumber);
+    }
+    serializeStatusReport(rxNext[index], nacks, bytes);
+    return true;
+}
+
+void
+ArqEntity::confirmStatusReport(
+    int index)      //Index of source
+{
+    lock_guard<mutex> lk(rxMutex);
+    statusRequired[index] = false;
+    pdusSinceStatus[index] = 0;
+    statusAllowedTicks[index] = timerWheel->getCurrentTick()+ARQ_STATUS_PROHIBIT;
+}
+
+void
+ArqEntity::serializeStatusReport(
+    uint16_t ackSequenceNumber,         //Sequence number of first PDU not received in sequence
+    const vector<uint16_t> & nacks,     //Sequence numbers of PDUs missing after it
+    vector<uint8_t> & bytes)            //Serialized status report
+{
+    bytes = {'A', 'R', 'Q', (uint8_t)(ackSequenceNumber>>8), (uint8_t)(ackSequenceNumber&255), (uint8_t)nacks.size()};
+    for(size_t i=0;i<nacks.size();i++){
+        bytes.push_back(nacks[i]>>8);
+        bytes.push_back(nacks[i]&255);
+    }
+}
+
+bool
+ArqEntity::deserializeStatusReport(
+    char* buffer,                   //Buffer containing Control SDU
+    size_t numberBytes,             //Size of Control SDU in bytes
+    uint16_t & ackSequenceNumber,   //Sequence number of first PDU not received in sequence
+    vector<uint16_t> & nacks)       //Sequence numbers of PDUs missing after it
+{
+    if(numberBytes<ARQ_STATUS_HEADER_LENGTH || buffer[0]!='A' || buffer[1]!='R' || buffer[2]!='Q' ||
+       numberBytes!=(size_t)(ARQ_STATUS_HEADER_LENGTH+2*(uint8_t)buffer[5]))
+        return false;
+
+    ackSequenceNumber = (((uint8_t)buffer[3])<<8)|((uint8_t)buffer[4]);
+    nacks.clear();
+    for(size_t i=ARQ_STATUS_HEADER_LENGTH;i<numberBytes;i+=2)
+        nacks.push_back((((uint8_t)buffer[i])<<8)|((uint8_t)buffer[i+1]));
+    return true;
+}
@@ -0,0 +1,218 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+
+#ifndef INCLUDED_ARQ_ENTITY_H
+#define INCLUDED_ARQ_ENTITY_H
+
+#include <iostream>     //cout
+#include <vector>       //std::vector
+#include <functional>   //std::function
+#include <mutex>        //std::mutex
+#include <stdint.h>     //uint16_t
+
+#include "../TimerWheel/TimerWheel.h"
+#include "../MacPduPool/MacPduPool.h"
+#include "../Multiplexer/TransmissionQueue.h"
+#include "../Crc/CrcCalculator.h"
+#include "../../common/lib5grange/lib5grange.h"
+
+using namespace std;
+using namespace lib5grange;
+
+#define ARQ_SEQUENCE_FLAG 0x8000            //Bit of MAC header sequence number field set on PDUs sent with ARQ
+#define ARQ_SEQUENCE_MODULUS 0x8000         //Sequence numbers are 15 bits
+#define ARQ_WINDOW_SIZE 256                 //PDUs of each destination sent and not acknowledged yet; divides ARQ_SEQUENCE_MODULUS
+#define MAXIMUM_ARQ_RETRANSMISSIONS 8       //Retransmissions of a PDU before it is given up to upper layers
+#define ARQ_POLL_TIMEOUT 40                 //Subframes without status report after which oldest PDU not acknowledged is sent again
+#define ARQ_REORDERING_TIMEOUT 20           //Subframes PDUs received out of order wait for missing ones before a status report NACKs them again
+#define ARQ_REORDERING_ATTEMPTS 8           //Reordering timeouts after which missing PDUs are skipped, as transmitter gave them up
+#define ARQ_STATUS_PERIOD 16                //PDUs received after which a status report is sent even without losses
+#define ARQ_STATUS_PROHIBIT 4               //Minimum subframes between status reports to the same destination
+#define ARQ_STATUS_HEADER_LENGTH 6          //Bytes of status report MACC SDU before NACKs: "ARQ" tag, ACK sequence number and number of NACKs
+#define MAXIMUM_ARQ_NACKS 32                //Maximum number of NACKs in a status report
+
+/**
+ * @brief [Transmission] PDU kept in retransmission buffer until it is acknowledged
+ */
+typedef struct{
+    PooledMacPdu macPdu;            //Handle of PDU sent, with its sequence number; shared with HARQ
+    bool stored;                    //Flag indicating slot holds a PDU not acknowledged
+    bool pendingRetransmission;     //Flag indicating PDU was NACKed (or polled) and must be sent again
+    int numberRetransmissions;      //Number of retransmissions of PDU
+}ArqTxSlot;
+
+/**
+ * @brief Selective-repeat ARQ of MAC PDUs, above HARQ: each destination has its own 15-bit sequence numbers
+ * Transmitter keeps every PDU until receiver acknowledges it in a status report MACC SDU, resending only those NACKed.
+ * Receiver reorders PDUs in a window, delivering them once, in sequence; missing PDUs are skipped only after ARQ_REORDERING_ATTEMPTS
+ * reordering timeouts, when transmitter must have given them up.
+ * PDUs without ARQ_SEQUENCE_FLAG are delivered as soon as they arrive.
+ */
+class ArqEntity{
+private:
+    int numberDestinations;                 //Number of destinations (same indexes of Transmission Queues)
+    TimerWheel* timerWheel;                 //Timer wheel where poll and reordering timers are armed
+    function<void(int, vector<uint8_t> &)> deliverPdu;  //Procedure that decodes PDUs delivered in sequence; an empty PDU marks PDUs skipped
+    bool verbose;                           //Verbosity flag
+
+    //Transmission side
+    ArqTxSlot** txSlots;                    //Retransmission buffer of each destination, indexed by sequence number modulo window
+    uint16_t* txNext;                       //Sequence number of next new PDU of each destination
+    uint16_t* txBase;                       //Oldest sequence number not acknowledged of each destination
+    TimerHandle* pollTimers;                //Timer waiting for status report of each destination
+    mutex txMutex;                          //Mutex to control access to transmission side
+
+    //Reception side
+    vector<uint8_t>** rxPdus;               //PDUs received out of order from each source, indexed by sequence number modulo window
+    bool** rxReceived;                      //Flags indicating which slots hold a PDU
+    uint16_t* rxNext;                       //Next sequence number to be delivered from each source
+    uint16_t* rxHighest;                    //Sequence number following the highest received from each source
+    uint16_t* reorderingTargets;            //Sequence number up to which PDUs are skipped when reordering timer expires
+    TimerHandle* reorderingTimers;          //Timer waiting for missing PDUs of each source
+    uint32_t* reorderingIds;                //Incremented each time reordering timer is armed, so stale timeouts are ignored
+    int* reorderingAttempts;                //Reordering timeouts of each source without missing PDUs arriving
+    int* pdusSinceStatus;                   //PDUs received from each source since last status report
+    bool* statusRequired;                   //Flags indicating a status report must be sent to each source
+    uint64_t* statusAllowedTicks;           //Tick from which next status report to each source may be sent
+    mutex rxMutex;                          //Mutex to control access to reception side
+    mutex deliveryMutex;                    //Mutex held while PDUs are delivered, so threads never deliver out of sequence
+
+    /**
+     * @brief Distance from a sequence number to another, in sequence number space
+     * @param from First sequence number
+     * @param to Second sequence number
+     * @returns Number of sequence numbers from first to second
+     */
+    static uint16_t distance(uint16_t from, uint16_t to);
+
+    /**
+     * @brief Arms poll timer of a destination if it is not armed; txMutex must be locked
+     * @param index Index of destination
+     */
+    void armPollTimer(int index);
+
+    /**
+     * @brief Called when no status report arrives in time: oldest PDU not acknowledged is sent again
+     * @param index Index of destination
+     */
+    void pollTimeout(int index);
+
+    /**
+     * @brief Moves PDUs received in sequence from reception window to list of PDUs to be delivered; rxMutex must be locked
+     * @param index Index of source
+     * @param pdus List where PDUs are appended
+     */
+    void takeInSequencePdus(int index, vector<vector<uint8_t>> & pdus);
+
+    /**
+     * @brief Arms reordering timer of a source if there are PDUs missing and it is not armed; rxMutex must be locked
+     * @param index Index of source
+     */
+    void armReorderingTimer(int index);
+
+    /**
+     * @brief Called when missing PDUs did not arrive in time: they are NACKed again; after ARQ_REORDERING_ATTEMPTS timeouts,
+     * they are skipped and PDUs received after them are delivered
+     * @param index Index of source
+     * @param reorderingId Reordering that armed the timer
+     */
+    void reorderingTimeout(int index, uint32_t reorderingId);
+
+public:
+    /**
+     * @brief Constructs ArqEntity with empty windows
+     * @param _numberDestinations Number of destinations
+     * @param _timerWheel Timer wheel where poll and reordering timers are armed
+     * @param _deliverPdu Procedure that decodes PDUs delivered in sequence, given index of source; an empty PDU marks PDUs skipped
+     * @param _verbose Verbosity flag
+     */
+    ArqEntity(int _numberDestinations, TimerWheel* _timerWheel, function<void(int, vector<uint8_t> &)> _deliverPdu, bool _verbose);
+
+    /**
+     * @brief Destroys ArqEntity
+     */
+    ~ArqEntity();
+
+    /**
+     * @brief [Transmission] Verifies if a destination may receive a new PDU, i.e. its window is not full of PDUs not acknowledged
+     * @param index Index of destination
+     * @returns True if a new PDU may be sent
+     */
+    bool isWindowOpen(int index);
+
+    /**
+     * @brief [Transmission] Writes next sequence number in MAC header of a new PDU, correcting its CRC, and keeps a handle of it
+     * for retransmission
+     * @param index Index of destination
+     * @param macPdu Handle of PDU to be sent, MAC header and CRC included
+     */
+    void startTransmission(int index, const PooledMacPdu & macPdu);
+
+    /**
+     * @brief [Transmission] Gets oldest PDU of a destination that must be sent again
+     * @param index Index of destination
+     * @param macPdu Variable where handle of PDU will be stored
+     * @returns Sequence number of PDU; -1 if there is no retransmission pending
+     */
+    int getRetransmission(int index, PooledMacPdu & macPdu);
+
+    /**
+     * @brief [Transmission] Marks retransmission got with getRetransmission() as sent
+     * @param index Index of destination
+     * @param sequenceNumber Sequence number of PDU
+     */
+    void confirmRetransmission(int index, int sequenceNumber);
+
+    /**
+     * @brief [Transmission] Treats status report of a destination: PDUs acknowledged are released and PDUs NACKed are sent again
+     * @param index Index of destination
+     * @param ackSequenceNumber Sequence number of first PDU not received in sequence by destination
+     * @param nacks Sequence numbers of PDUs missing after it
+     */
+    void receiveStatus(int index, uint16_t ackSequenceNumber, const vector<uint16_t> & nacks);
+
+    /**
+     * @brief [Reception] Receives a PDU from L1, delivering it and PDUs waiting for it in sequence
+     * @param index Index of source; -1 if unknown, in which case PDU is delivered immediately
+     * @param pdu PDU received, MAC header included
+     * @param numberBytes Size of PDU in bytes
+     */
+    void receivePdu(int index, char* pdu, size_t numberBytes);
+
+    /**
+     * @brief [Reception] Gets status report to be sent to a source, if one is required and allowed now
+     * Report stays required until confirmStatusReport() is called, so a report that could not be enqueued is retried
+     * @param index Index of source
+     * @param bytes Status report MACC SDU
+     * @returns True if status report must be sent
+     */
+    bool getStatusReport(int index, vector<uint8_t> & bytes);
+
+    /**
+     * @brief [Reception] Marks status report got with getStatusReport() as enqueued
+     * @param index Index of source
+     */
+    void confirmStatusReport(int index);
+
+    /**
+     * @brief Serializes status report MACC SDU: "ARQ" tag, ACK sequence number, number of NACKs and NACKs
+     * @param ackSequenceNumber Sequence number of first PDU not received in sequence
+     * @param nacks Sequence numbers of PDUs missing after it
+     * @param bytes Serialized status report
+     */
+    static void serializeStatusReport(uint16_t ackSequenceNumber, const vector<uint16_t> & nacks, vector<uint8_t> & bytes);
+
+    /**
+     * @brief Deserializes status report MACC SDU
+     * @param buffer Buffer containing Control SDU
+     * @param numberBytes Size of Control SDU in bytes
+     * @param ackSequenceNumber Sequence number of first PDU not received in sequence
+     * @param nacks Sequence numbers of PDUs missing after it
+     * @returns True if Control SDU is a status report
+     */
+    static bool deserializeStatusReport(char* buffer, size_t numberBytes, uint16_t & ackSequenceNumber, vector<uint16_t> & nacks);
+};
+#endif  //INCLUDED_ARQ_ENTITY_H
@@ -24,6 +24,9 @@ UA : 1230 - Centro de Competencia - Sistemas Embarcados
 */
 
 #include <iostream>
+#include <vector>       //std::vector
+#include <stdlib.h>     //atoi()
+#include <string.h>     //strcmp(), strtok()
 using namespace std;
 
 //Custom headers implemented
@@ -70,19 +73,39 @@ int main(int argc, char** argv){
     bool verbose = false;           //Verbosity flag
     char *devname = NULL;           //Tun interface name
     bool flagBS;                    //Base Station flag: true if BS, false if UE
+    int numberTunQueues = 1;        //Number of TUN queues (and TUN reading threads)
+    vector<int> tunCores;           //CPU cores where TUN reading threads are pinned
+    SchedulingPolicies schedulingPolicy = PROPORTIONAL_FAIR;    //Policy used to split RBs among destinations
+    InterlayerTransports interlayerTransport = UDP_TRANSPORT;   //Transport used to exchange messages with L1
+    macpdu_wire_format_t pduWireFormat = MACPDU_WIRE_FLAT;      //Format in which PDUs are serialized to L1
 
-	//Verify verbose
-    if(argc==2){
-        if(argv[1][0]=='-') verbose = true;
-        else devname = argv[1];
-    }
-    if(argc==3){
-        verbose = true;
-        devname = argv[2];
+	//Verify arguments: [--queues N] [--cores c0,c1,...] [--scheduler rr|maxci|pf] [--transport udp|shm] [--wire flat|legacy] [-v] [devname]
+    for(int i=1;i<argc;i++){
+        if(strcmp(argv[i],"--queues")==0 && i+1<argc)
+            numberTunQueues = atoi(argv[++i]);
+        else if(strcmp(argv[i],"--scheduler")==0 && i+1<argc){
+            i++;
+            if(strcmp(argv[i],"rr")==0) schedulingPolicy = ROUND_ROBIN;
+            else if(strcmp(argv[i],"maxci")==0) schedulingPolicy = MAXIMUM_CI;
+            else schedulingPolicy = PROPORTIONAL_FAIR;
+        }
+        else if(strcmp(argv[i],"--transport")==0 && i+1<argc)
+            interlayerTransport = strcmp(argv[++i],"shm")==0? SHARED_MEMORY_TRANSPORT:UDP_TRANSPORT;
+        else if(strcmp(argv[i],"--wire")==0 && i+1<argc)
+            pduWireFormat = strcmp(argv[++i],"legacy")==0? MACPDU_WIRE_LEGACY:MACPDU_WIRE_FLAT;
+        else if(strcmp(argv[i],"--cores")==0 && i+1<argc){
+            for(char* core = strtok(argv[++i],",");core!=NULL;core = strtok(NULL,","))
+                tunCores.push_back(atoi(core));
+        }
+        else if(argv[i][0]=='-') verbose = true;
+        else devname = argv[i];
     }
 
     //Create a new MacController (main module) object
-    MacController equipment(devname, verbose);
+    MacController equipment(devname, numberTunQueues, tunCores, verbose);
+    equipment.setSchedulingPolicy(schedulingPolicy);
+    equipment.setInterlayerTransport(interlayerTransport);
+    equipment.setPduWireFormat(pduWireFormat);
 
     //Start stub to replace CLI
     thread t1(stubCLI, ref(equipment));
@@ -25,35 +25,47 @@ UA : 1230 - Centro de Competencia - Sistemas Embarcados
 #include "TunInterface.h"
 using namespace std;    
 
-TunInterface::TunInterface(){
-    TunInterface("tun0", false);
-}
+TunInterface::TunInterface() : TunInterface("tun0", 1, false) { }
 
 TunInterface::TunInterface(
     bool _verbose)      //Verbosity flag
-{
-    TunInterface("tun0", _verbose);
-}
+    : TunInterface("tun0", 1, _verbose) { }
 
 TunInterface::TunInterface(
     const char* _deviceName)        //Interface name
-{
-    TunInterface(_deviceName,false);
-}
+    : TunInterface(_deviceName, 1, false) { }
 
 TunInterface::TunInterface(
     const char* _deviceName,        //Interface name
     bool _verbose)              //Verbosity flag
+    : TunInterface(_deviceName, 1, _verbose) { }
+
+TunInterface::TunInterface(
+    const char* _deviceName,        //Interface name
+    int _numberQueues,          //Number of queues
+    bool _verbose)              //Verbosity flag
 {
     verbose = _verbose;
+    numberQueues = _numberQueues<1? 1:(_numberQueues>MAXIMUM_TUN_QUEUES? MAXIMUM_TUN_QUEUES:_numberQueues);
+    fileDescriptors = new int[numberQueues];
+    epollDescriptors = new int[numberQueues];
+    for(int i=0;i<numberQueues;i++){
+        fileDescriptors[i] = -1;
+        epollDescriptors[i] = -1;
+    }
     deviceName = new char[IFNAMSIZ+1];
     memset(deviceName,0,IFNAMSIZ+1);
-    if(_deviceName!=NULL) strncpy(deviceName,_deviceName,sizeof(deviceName)-1);
+    if(_deviceName!=NULL) strncpy(deviceName,_deviceName,IFNAMSIZ);
 }
 
 TunInterface::~TunInterface(){
     delete[] deviceName;
-    close(fileDescriptor);
+    for(int i=0;i<numberQueues;i++){
+        if(epollDescriptors[i]!=-1) close(epollDescriptors[i]);
+        if(fileDescriptors[i]!=-1) close(fileDescriptors[i]);
+    }
+    delete[] epollDescriptors;
+    delete[] fileDescriptors;
 }
 
 bool 
@@ -64,36 +76,79 @@ TunInterface::allocTunInterface(){
         return false;
     }
 
-    //Open file descriptor
-    fileDescriptor = open("/dev/net/tun", O_RDWR);
-
     //Creates and sets interface requirement struct
     struct ifreq interfaceRequirement;
     memset(&interfaceRequirement, 0, sizeof(interfaceRequirement));
-    interfaceRequirement.ifr_flags = IFF_TUN | IFF_NO_PI;
-    strncpy(interfaceRequirement.ifr_name, deviceName, IFNAMSIZ);
-
-    //Calls system in/out control to set interface active
-    ioctl(fileDescriptor, TUNSETIFF, (void *) &interfaceRequirement);
-    strncpy(deviceName,interfaceRequirement.ifr_name, IFNAMSIZ);
-
-    //Set interface to be inblockable for reading
-    fcntl(fileDescriptor, F_SETFL, O_NONBLOCK);
+    interfaceRequirement.ifr_flags = IFF_TUN | IFF_NO_PI | (numberQueues>1? IFF_MULTI_QUEUE:0);
+
+    //Each queue is attached to the same interface through its own file descriptor
+    for(int i=0;i<numberQueues;i++){
+        //Open file descriptor
+        fileDescriptors[i] = open("/dev/net/tun", O_RDWR);
+
+        //Calls system in/out control to attach queue to interface
+        strncpy(interfaceRequirement.ifr_name, deviceName, IFNAMSIZ);
+        if(ioctl(fileDescriptors[i], TUNSETIFF, (void *) &interfaceRequirement)==-1){
+            if(verbose) cout << "[TunInterface] Error attaching queue "<<i<<" to interface." << endl;
+            return false;
+        }
+        strncpy(deviceName,interfaceRequirement.ifr_name, IFNAMSIZ);
+
+        //Set queue to be inblockable for reading, so all packets available can be drained after each wait
+        fcntl(fileDescriptors[i], F_SETFL, O_NONBLOCK);
+
+        //Create epoll instance to block waiting for packets in this queue
+        epollDescriptors[i] = epoll_create1(0);
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = fileDescriptors[i];
+        if(epollDescriptors[i]==-1 || epoll_ctl(epollDescriptors[i], EPOLL_CTL_ADD, fileDescriptors[i], &event)==-1){
+            if(verbose) cout << "[TunInterface] Error creating epoll instance." << endl;
+            return false;
+        }
+    }
 
     //Forces interface to me initialized as "UP"
     char cmd[100];
     sprintf(cmd, "ifconfig %s up", interfaceRequirement.ifr_ifrn.ifrn_name);
     system(cmd);
-    if(verbose) cout << "[TunInterface] Tun interface allocated successfully." << endl;
+    if(verbose) cout << "[TunInterface] Tun interface allocated successfully with "<<numberQueues<<" queue(s)." << endl;
     return true;
 }
 
+bool
+TunInterface::waitTunInterface(
+    int timeout)            //Maximum waiting time in milliseconds
+{
+    return waitTunInterface(timeout, 0);
+}
+
+bool
+TunInterface::waitTunInterface(
+    int timeout,            //Maximum waiting time in milliseconds
+    int queue)              //Index of the queue
+{
+    struct epoll_event event;   //Event returned by epoll
+
+    return epoll_wait(epollDescriptors[queue], &event, 1, timeout)>0;
+}
+
 ssize_t 
 TunInterface::readTunInterface(
     char* buffer,           //Buffer to store packet read
     size_t numberBytes)     //Number of bytes read
 {
-    return read(fileDescriptor, buffer, numberBytes);
+    return readTunInterface(buffer, numberBytes, 0);
+}
+
+ssize_t 
+TunInterface::readTunInterface(
+    char* buffer,           //Buffer to store packet read
+    size_t numberBytes,     //Number of bytes read
+    int queue)              //Index of the queue
+{
+    return read(fileDescriptors[queue], buffer, numberBytes);
 }
 
 bool 
@@ -101,10 +156,16 @@ TunInterface::writeTunInterface(
     char* buffer,           //Buffer containing L3 packet
     size_t numberBytes)     //Number of bytes to write
 {
-    ssize_t returnValue = write(fileDescriptor, buffer, numberBytes);
+    //Packets are taken back to Linux through first queue; kernel does not require writes to match reading queue
+    ssize_t returnValue = write(fileDescriptors[0], buffer, numberBytes);
     if(returnValue==-1){
         if(verbose) cout<<"[TunInterface] Could not write to Tun Interface."<<endl;
         return false;
     }
     return true;
 }
+
+int
+TunInterface::getNumberQueues(){
+    return numberQueues;
+}
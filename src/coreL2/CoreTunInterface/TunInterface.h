@@ -15,13 +15,18 @@
 #include <sys/types.h>  //size_t
 #include <fcntl.h>      //open(), O_RDWR
 #include <sys/ioctl.h>  //ioctl()
+#include <sys/epoll.h>  //epoll_create1(), epoll_ctl(), epoll_wait()
+
+#define MAXIMUM_TUN_QUEUES 16   //Maximum number of queues of a multi-queue TUN interface
 
 /**
  * @brief Class to alloc, save the descriptor and manage operations of TUN interface
  */
 class TunInterface{
 private:
-    int fileDescriptor;     //File descriptor of the interface
+    int numberQueues;       //Number of queues of the interface (IFF_MULTI_QUEUE if greater than 1)
+    int* fileDescriptors;   //File descriptor of each queue of the interface
+    int* epollDescriptors;  //Epoll instance used to wait for packets in each queue of the interface
     char* deviceName;       //[optional] Name of the interface
     bool verbose;           //Verbosity flag
 
@@ -49,6 +54,14 @@ public:
      * @param _verbose Verbosity flag
      */
     TunInterface(const char* deviceName, bool _verbose);
+
+    /**
+     * @brief Creates multi-queue interface
+     * @param deviceName Interface name
+     * @param _numberQueues Number of queues, from 1 to MAXIMUM_TUN_QUEUES
+     * @param _verbose Verbosity flag
+     */
+    TunInterface(const char* deviceName, int _numberQueues, bool _verbose);
     
     /**
      * @brief Destroys TUN interface
@@ -61,13 +74,43 @@ public:
      */
     bool allocTunInterface();
     
-/**
- * @brief Performs reading of packets in the interface; Blocks if there is no packet to read
- * @param buffer Buffer to store packet read
- * @param numberBytes Maximum number of bytes to read
- * @returns Number of bytes read; 0 for EOF; -1 for errors
- */
+    /**
+     * @brief Blocks until there are packets to read in the interface or timeout expires
+     * @param timeout Maximum waiting time in milliseconds
+     * @returns true if there are packets to read, false otherwise
+     */
+    bool waitTunInterface(int timeout);
+
+    /**
+     * @brief Blocks until there are packets to read in one queue of the interface or timeout expires
+     * @param timeout Maximum waiting time in milliseconds
+     * @param queue Index of the queue
+     * @returns true if there are packets to read, false otherwise
+     */
+    bool waitTunInterface(int timeout, int queue);
+
+    /**
+     * @brief Performs reading of packets in the interface; Does not block if there is no packet to read
+     * @param buffer Buffer to store packet read
+     * @param numberBytes Maximum number of bytes to read
+     * @returns Number of bytes read; 0 for EOF; -1 for errors or if there is no packet to read
+     */
     ssize_t readTunInterface(char* buffer, size_t numberBytes);
+
+    /**
+     * @brief Performs reading of packets in one queue of the interface; Does not block if there is no packet to read
+     * @param buffer Buffer to store packet read
+     * @param numberBytes Maximum number of bytes to read
+     * @param queue Index of the queue
+     * @returns Number of bytes read; 0 for EOF; -1 for errors or if there is no packet to read
+     */
+    ssize_t readTunInterface(char* buffer, size_t numberBytes, int queue);
+
+    /**
+     * @brief Gets number of queues of the interface
+     * @returns Number of queues
+     */
+    int getNumberQueues();
  
     /**
      * @brief Performs writing in TUN interface to take packet back to Linux system
@@ -42,6 +42,10 @@ uint16_t
 Cosora::spectrumSensingConvertToRBIdle(
     uint8_t* spectrumSensingReport)     //Spectrum Sensing Report calculated on UE
 {
-    //#TODO: Implement Conversion of SS to RBIdle
-    return 130;
+    //Each bit set flags an RB where an incumbent was detected; 17th byte has only 4 RBs, in its least significant bits
+    uint16_t numberBusyRbs = 0;
+    for(int i=0;i<16;i++)
+        numberBusyRbs += __builtin_popcount(spectrumSensingReport[i]);
+    numberBusyRbs += __builtin_popcount(spectrumSensingReport[16]&15);
+    return 132-numberBusyRbs;
 }
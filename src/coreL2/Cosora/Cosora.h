@@ -34,7 +34,7 @@ public:
 
     /**
      * @brief Calculates number of RBs in idle
-     * @param spectrumSensingReport from UE
+     * @param spectrumSensingReport from UE, 132 bits where a set bit flags an occupied RB
      * @returns Number of RBs in idle
      */
     static uint16_t spectrumSensingConvertToRBIdle(uint8_t* spectrumSensingReport);
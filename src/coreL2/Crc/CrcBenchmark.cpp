@@ -0,0 +1,92 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+/**
+@Arquive name : CrcBenchmark.cpp
+@Classification : CRC [BENCHMARK]
+@
+@Version : v1.0
+
+Project : H2020 5G-Range
+
+@Description : Standalone program that checks table-driven CRC-16 against the bitwise
+    one and measures bytes per cycle of each CRC variant over PDU-sized buffers.
+    Build: g++ -O2 -std=c++14 CrcBenchmark.cpp CrcCalculator.cpp -o crcBenchmark
+*/
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <stdlib.h>     //rand(), atoi()
+#if defined(__x86_64__)
+#include <x86intrin.h>  //__rdtsc()
+#endif
+
+#include "CrcCalculator.h"
+
+using namespace std;
+
+#define BENCHMARK_PDU_LENGTH 16384      //Bytes of each PDU, as MAXIMUM_PDU_LENGTH
+#define BENCHMARK_ITERATIONS 2000       //PDUs processed by each variant
+
+/**
+ * @brief Reads a cycle counter; nanoseconds where there is no time stamp counter
+ * @returns Cycles
+ */
+static uint64_t readCycles(){
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+ * @brief Measures a CRC variant
+ * @param name Variant name
+ * @param buffer PDU
+ * @param size Size of PDU in bytes
+ * @param iterations Number of PDUs
+ * @param variant Procedure calculating CRC of PDU
+ */
+template <typename Variant>
+static void measure(const char* name, const char* buffer, size_t size, int iterations, Variant variant){
+    volatile uint32_t sink = 0;     //Keeps calculations from being optimized out
+    uint64_t start = readCycles();
+    for(int i=0;i<iterations;i++)
+        sink = sink^variant(buffer, size);
+    uint64_t cycles = readCycles()-start;
+    cout<<name<<": "<<(double)size*iterations/cycles<<" bytes/cycle"<<endl;
+}
+
+int main(int argc, char** argv){
+    int iterations = argc>1? atoi(argv[1]):BENCHMARK_ITERATIONS;
+    vector<char> pdu(BENCHMARK_PDU_LENGTH);
+    for(size_t i=0;i<pdu.size();i++)
+        pdu[i] = rand();
+
+    //Table-driven CRC-16 must match bitwise one for every length and split, as it goes on the wire
+    for(size_t size=0;size<=64;size++){
+        CrcCalculator crc(CRC16_5GRANGE);
+        crc.update(&pdu[0], size/3);
+        crc.update(&pdu[size/3], size-size/3);
+        if(crc.getCrc()!=CrcCalculator::calculateCrc16Bitwise(&pdu[0], size)){
+            cout<<"CRC-16 mismatch with "<<size<<" bytes."<<endl;
+            return 1;
+        }
+    }
+
+    //CRC-32C check value
+    if(CrcCalculator::calculate(CRC32C, "123456789", 9)!=0xE3069283){
+        cout<<"CRC-32C mismatch."<<endl;
+        return 1;
+    }
+
+    cout<<"CRC-32C hardware accelerated: "<<(CrcCalculator::isHardwareAccelerated(CRC32C)? "yes":"no")<<endl;
+    measure("CRC-16 bitwise", &pdu[0], pdu.size(), iterations/10+1, [](const char* buffer, size_t size){ return (uint32_t) CrcCalculator::calculateCrc16Bitwise(buffer, size); });
+    measure("CRC-16 slicing-by-8", &pdu[0], pdu.size(), iterations, [](const char* buffer, size_t size){ return CrcCalculator::calculate(CRC16_5GRANGE, buffer, size); });
+    measure("CRC-32C", &pdu[0], pdu.size(), iterations, [](const char* buffer, size_t size){ return CrcCalculator::calculate(CRC32C, buffer, size); });
+    return 0;
+}
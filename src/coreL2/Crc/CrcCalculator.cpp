@@ -0,0 +1,264 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+/**
+@Arquive name : CrcCalculator.cpp
+@Classification : CRC
+@
+@Version : v1.0
+
+Project : H2020 5G-Range
+
+@Description : This module calculates the CRCs of PDUs exchanged with L1, 8 bytes
+    per step with lookup tables or with the SSE4.2 crc32 instruction.
+*/
+
+#include "CrcCalculator.h"
+
+#include <string.h>     //memcpy()
+#include <endian.h>     //le64toh()
+#if defined(__x86_64__)
+#include <nmmintrin.h>  //_mm_crc32_u64(), _mm_crc32_u8()
+#endif
+
+uint16_t CrcCalculator::crc16Tables[CRC_SLICES][256];
+uint32_t CrcCalculator::crc32cTables[CRC_SLICES][256];
+uint32_t CrcCalculator::crc16Powers[CRC_POWERS];
+uint32_t CrcCalculator::crc32cPowers[CRC_POWERS];
+bool CrcCalculator::hardwareCrc32c = false;
+once_flag CrcCalculator::tablesFlag;
+
+CrcCalculator::CrcCalculator(
+    CrcTypes _type)     //CRC to be calculated
+{
+    call_once(tablesFlag, initializeTables);
+    type = _type;
+    reset();
+}
+
+void
+CrcCalculator::initializeTables(){
+    //First table: CRC of each byte, 8 bit steps; register starts with the byte, as it is XORed in before each step
+    for(int i=0;i<256;i++){
+        uint16_t crc16 = i;
+        uint32_t crc32c = i;
+        for(int j=0;j<8;j++){
+            crc16 = (crc16&1)? (crc16>>1)^CRC16_POLYNOMIAL:crc16>>1;
+            crc32c = (crc32c&1)? (crc32c>>1)^CRC32C_POLYNOMIAL:crc32c>>1;
+        }
+        crc16Tables[0][i] = crc16;
+        crc32cTables[0][i] = crc32c;
+    }
+
+    //Next tables: same byte followed by one more zero byte each
+    for(int k=1;k<CRC_SLICES;k++){
+        for(int i=0;i<256;i++){
+            crc16Tables[k][i] = (crc16Tables[k-1][i]>>8)^crc16Tables[0][crc16Tables[k-1][i]&0xFF];
+            crc32cTables[k][i] = (crc32cTables[k-1][i]>>8)^crc32cTables[0][crc32cTables[k-1][i]&0xFF];
+        }
+    }
+
+    //Powers of x used to shift registers over zero bytes: x^1, then each one squared
+    crc16Powers[0] = 1<<14;
+    crc32cPowers[0] = 1u<<30;
+    for(int k=1;k<CRC_POWERS;k++){
+        crc16Powers[k] = multiplyModulo(crc16Powers[k-1], crc16Powers[k-1], CRC16_POLYNOMIAL, 16);
+        crc32cPowers[k] = multiplyModulo(crc32cPowers[k-1], crc32cPowers[k-1], CRC32C_POLYNOMIAL, 32);
+    }
+
+#if defined(__x86_64__)
+    hardwareCrc32c = __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+uint16_t
+CrcCalculator::updateCrc16(
+    uint16_t crc,               //CRC register
+    const uint8_t* buffer,      //Bytes
+    size_t size)                //Number of bytes
+{
+    //8 bytes per step: register is XORed into the first ones, then each byte is looked up in the table of its distance to the end
+    while(size>=CRC_SLICES){
+        uint64_t word;
+        memcpy(&word, buffer, CRC_SLICES);
+        word = le64toh(word)^crc;
+        crc = crc16Tables[7][word&0xFF]^crc16Tables[6][(word>>8)&0xFF]^crc16Tables[5][(word>>16)&0xFF]^
+              crc16Tables[4][(word>>24)&0xFF]^crc16Tables[3][(word>>32)&0xFF]^crc16Tables[2][(word>>40)&0xFF]^
+              crc16Tables[1][(word>>48)&0xFF]^crc16Tables[0][word>>56];
+        buffer += CRC_SLICES;
+        size -= CRC_SLICES;
+    }
+
+    //Remaining bytes, one at a time
+    while(size--)
+        crc = (crc>>8)^crc16Tables[0][(crc^*(buffer++))&0xFF];
+    return crc;
+}
+
+uint32_t
+CrcCalculator::updateCrc32cSoftware(
+    uint32_t crc,               //CRC register
+    const uint8_t* buffer,      //Bytes
+    size_t size)                //Number of bytes
+{
+    while(size>=CRC_SLICES){
+        uint64_t word;
+        memcpy(&word, buffer, CRC_SLICES);
+        word = le64toh(word)^crc;
+        crc = crc32cTables[7][word&0xFF]^crc32cTables[6][(word>>8)&0xFF]^crc32cTables[5][(word>>16)&0xFF]^
+              crc32cTables[4][(word>>24)&0xFF]^crc32cTables[3][(word>>32)&0xFF]^crc32cTables[2][(word>>40)&0xFF]^
+              crc32cTables[1][(word>>48)&0xFF]^crc32cTables[0][word>>56];
+        buffer += CRC_SLICES;
+        size -= CRC_SLICES;
+    }
+    while(size--)
+        crc = (crc>>8)^crc32cTables[0][(crc^*(buffer++))&0xFF];
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+uint32_t
+CrcCalculator::updateCrc32cHardware(
+    uint32_t crc,               //CRC register
+    const uint8_t* buffer,      //Bytes
+    size_t size)                //Number of bytes
+{
+    uint64_t crc64 = crc;
+    while(size>=CRC_SLICES){
+        uint64_t word;
+        memcpy(&word, buffer, CRC_SLICES);
+        crc64 = _mm_crc32_u64(crc64, word);
+        buffer += CRC_SLICES;
+        size -= CRC_SLICES;
+    }
+    crc = crc64;
+    while(size--)
+        crc = _mm_crc32_u8(crc, *(buffer++));
+    return crc;
+}
+#else
+uint32_t
+CrcCalculator::updateCrc32cHardware(
+    uint32_t crc,               //CRC register
+    const uint8_t* buffer,      //Bytes
+    size_t size)                //Number of bytes
+{
+    return updateCrc32cSoftware(crc, buffer, size);
+}
+#endif
+
+uint32_t
+CrcCalculator::multiplyModulo(
+    uint32_t a,             //First polynomial
+    uint32_t b,             //Second polynomial
+    uint32_t polynomial,    //Reflected CRC polynomial
+    int width)              //Number of bits of CRC
+{
+    //Reflected: most significant bit is x^0; b is multiplied by x at each bit of a
+    uint32_t mask = 1u<<(width-1);
+    uint32_t product = 0;
+    while(mask){
+        if(a&mask){
+            product ^= b;
+            if((a&(mask-1))==0)
+                break;
+        }
+        mask >>= 1;
+        b = (b&1)? (b>>1)^polynomial:b>>1;
+    }
+    return product;
+}
+
+void
+CrcCalculator::reset(){
+    //CRC-16 starts from zero; CRC-32C starts from all ones and is inverted at the end
+    crc = type==CRC32C? 0xFFFFFFFF:0;
+}
+
+void
+CrcCalculator::update(
+    const char* buffer,     //Bytes
+    size_t size)            //Number of bytes
+{
+    if(type==CRC32C)
+        crc = hardwareCrc32c? updateCrc32cHardware(crc, (const uint8_t*) buffer, size):updateCrc32cSoftware(crc, (const uint8_t*) buffer, size);
+    else
+        crc = updateCrc16(crc, (const uint8_t*) buffer, size);
+}
+
+uint32_t
+CrcCalculator::getCrc(){
+    return type==CRC32C? crc^0xFFFFFFFF:crc;
+}
+
+uint32_t
+CrcCalculator::calculate(
+    CrcTypes type,          //CRC to be calculated
+    const char* buffer,     //Message
+    size_t size)            //Size of message in bytes
+{
+    CrcCalculator crcCalculator(type);
+    crcCalculator.update(buffer, size);
+    return crcCalculator.getCrc();
+}
+
+uint32_t
+CrcCalculator::patch(
+    CrcTypes type,              //CRC
+    uint32_t crc,               //CRC of message before change
+    const char* difference,     //Old bytes XORed with new bytes
+    size_t size,                //Number of bytes changed
+    size_t numberBytesAfter)    //Number of bytes of message after those changed
+{
+    call_once(tablesFlag, initializeTables);
+
+    //Register of difference alone, without initial value nor final inversion, which cancel out
+    uint32_t change = type==CRC32C? updateCrc32cSoftware(0, (const uint8_t*) difference, size):
+                                    updateCrc16(0, (const uint8_t*) difference, size);
+    if(change==0)
+        return crc;
+
+    //Shift change over following bytes: multiply it by x^(8n), one power of x for each bit of 8n set
+    uint32_t* powers = type==CRC32C? crc32cPowers:crc16Powers;
+    uint32_t polynomial = type==CRC32C? CRC32C_POLYNOMIAL:CRC16_POLYNOMIAL;
+    int width = type==CRC32C? 32:16;
+    for(int k=3;numberBytesAfter!=0 && k<CRC_POWERS;k++,numberBytesAfter>>=1){
+        if(numberBytesAfter&1)
+            change = multiplyModulo(powers[k], change, polynomial, width);
+    }
+    return crc^change;
+}
+
+uint16_t
+CrcCalculator::calculateCrc16Bitwise(
+    const char* buffer,     //Message
+    size_t size)            //Size of message in bytes
+{
+    uint16_t crc = 0;
+    for(size_t i=0;i<size;i++){
+        for(int j=0;j<8;j++){
+            bool bit = (crc&1)^((buffer[i]>>j)&1);
+            crc>>=1;
+            if(bit) crc^=CRC16_POLYNOMIAL;
+        }
+    }
+    return crc;
+}
+
+bool
+CrcCalculator::isHardwareAccelerated(
+    CrcTypes type)      //CRC
+{
+    call_once(tablesFlag, initializeTables);
+    return type==CRC32C && hardwareCrc32c;
+}
+
+size_t
+CrcCalculator::getCrcLength(
+    CrcTypes type)      //CRC
+{
+    return type==CRC32C? 4:2;
+}
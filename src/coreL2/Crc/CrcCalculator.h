@@ -0,0 +1,154 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+
+#ifndef INCLUDED_CRC_CALCULATOR_H
+#define INCLUDED_CRC_CALCULATOR_H
+
+#include <stdint.h>     //uint16_t, uint32_t
+#include <stddef.h>     //size_t
+#include <mutex>        //std::once_flag
+
+using namespace std;
+
+#define CRC16_POLYNOMIAL 0x9299         //Reflected polynomial of the CRC appended to PDUs sent to L1
+#define CRC32C_POLYNOMIAL 0x82F63B78    //Reflected Castagnoli polynomial, the one computed by SSE4.2 crc32 instruction
+#define CRC_SLICES 8                    //Bytes processed per step by table-driven implementations (slicing-by-8)
+#define CRC_POWERS 64                   //Powers x^(2^k) kept to shift a CRC register over runs of zero bytes
+
+/**
+ * @brief CRCs available
+ */
+enum CrcTypes {CRC16_5GRANGE, CRC32C};
+
+/**
+ * @brief CRC engine: table-driven (slicing-by-8) CRC-16 bit-exact with the original bitwise one, and CRC-32C using
+ * SSE4.2 crc32 instruction when CPU has it, or tables otherwise
+ * CRC may be calculated at once or incrementally, calling update() on consecutive pieces of the message; CRC of a message
+ * whose bytes changed after it was calculated is corrected with patch(), without going through the message again.
+ */
+class CrcCalculator{
+private:
+    CrcTypes type;          //CRC calculated
+    uint32_t crc;           //CRC register after the bytes given so far
+
+    static uint16_t crc16Tables[CRC_SLICES][256];   //Slicing tables of CRC-16: [k][i] is CRC of byte i followed by k zero bytes
+    static uint32_t crc32cTables[CRC_SLICES][256];  //Slicing tables of CRC-32C
+    static uint32_t crc16Powers[CRC_POWERS];        //x^(2^k) modulo CRC-16 polynomial, reflected
+    static uint32_t crc32cPowers[CRC_POWERS];       //x^(2^k) modulo CRC-32C polynomial, reflected
+    static bool hardwareCrc32c;                     //Flag indicating CPU has SSE4.2 crc32 instruction
+    static once_flag tablesFlag;                    //Flag to build tables once, in any thread
+
+    /**
+     * @brief Builds slicing tables and detects CPU features
+     */
+    static void initializeTables();
+
+    /**
+     * @brief Updates CRC-16 register with slicing-by-8
+     * @param crc CRC register
+     * @param buffer Bytes
+     * @param size Number of bytes
+     * @returns Updated CRC register
+     */
+    static uint16_t updateCrc16(uint16_t crc, const uint8_t* buffer, size_t size);
+
+    /**
+     * @brief Updates CRC-32C register with slicing-by-8
+     * @param crc CRC register
+     * @param buffer Bytes
+     * @param size Number of bytes
+     * @returns Updated CRC register
+     */
+    static uint32_t updateCrc32cSoftware(uint32_t crc, const uint8_t* buffer, size_t size);
+
+    /**
+     * @brief Updates CRC-32C register with SSE4.2 crc32 instruction, 8 bytes at a time; CPU must support it
+     * @param crc CRC register
+     * @param buffer Bytes
+     * @param size Number of bytes
+     * @returns Updated CRC register
+     */
+    static uint32_t updateCrc32cHardware(uint32_t crc, const uint8_t* buffer, size_t size);
+
+    /**
+     * @brief Multiplies two polynomials modulo CRC polynomial, all reflected as CRC registers are
+     * @param a First polynomial; must not be zero
+     * @param b Second polynomial
+     * @param polynomial Reflected CRC polynomial
+     * @param width Number of bits of CRC
+     * @returns Product modulo CRC polynomial
+     */
+    static uint32_t multiplyModulo(uint32_t a, uint32_t b, uint32_t polynomial, int width);
+
+public:
+    /**
+     * @brief Constructs a CrcCalculator ready for a new message
+     * @param _type CRC to be calculated
+     */
+    CrcCalculator(CrcTypes _type);
+
+    /**
+     * @brief Restarts calculation for a new message
+     */
+    void reset();
+
+    /**
+     * @brief Adds bytes following those already given to the CRC
+     * @param buffer Bytes
+     * @param size Number of bytes
+     */
+    void update(const char* buffer, size_t size);
+
+    /**
+     * @brief Gets CRC of bytes given since construction or last reset()
+     * @returns CRC value (16 or 32 bits)
+     */
+    uint32_t getCrc();
+
+    /**
+     * @brief Calculates CRC of a message at once
+     * @param type CRC to be calculated
+     * @param buffer Message
+     * @param size Size of message in bytes
+     * @returns CRC value
+     */
+    static uint32_t calculate(CrcTypes type, const char* buffer, size_t size);
+
+    /**
+     * @brief Corrects CRC of a message after some of its bytes changed, in O(log n) steps: as CRC is linear, change of CRC is
+     * CRC register of bytes XORed into message, shifted over the bytes that follow them
+     * @param type CRC
+     * @param crc CRC of message before change
+     * @param difference Old bytes XORed with new bytes
+     * @param size Number of bytes changed
+     * @param numberBytesAfter Number of bytes of message after those changed
+     * @returns CRC of changed message
+     */
+    static uint32_t patch(CrcTypes type, uint32_t crc, const char* difference, size_t size, size_t numberBytesAfter);
+
+    /**
+     * @brief Calculates CRC-16 one bit at a time, as originally done; kept as reference of table-driven implementation
+     * @param buffer Message
+     * @param size Size of message in bytes
+     * @returns CRC value
+     */
+    static uint16_t calculateCrc16Bitwise(const char* buffer, size_t size);
+
+    /**
+     * @brief Verifies if a CRC is calculated with a dedicated CPU instruction
+     * @param type CRC
+     * @returns True if hardware accelerated
+     */
+    static bool isHardwareAccelerated(CrcTypes type);
+
+    /**
+     * @brief Gets number of bytes of a CRC
+     * @param type CRC
+     * @returns 2 for CRC-16, 4 for CRC-32C
+     */
+    static size_t getCrcLength(CrcTypes type);
+};
+#endif  //INCLUDED_CRC_CALCULATOR_H
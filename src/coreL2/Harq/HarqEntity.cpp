@@ -0,0 +1,201 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+/**
+@Arquive name : HarqEntity.cpp
+@Classification : HARQ
+@
+@Version : v1.0
+
+Project : H2020 5G-Range
+
+@Description : This module keeps transport blocks sent to L1 in parallel 
+    stop-and-wait HARQ processes and retransmits those NACKed.
+*/
+
+#include "HarqEntity.h"
+
+HarqEntity::HarqEntity(
+    int _numberDestinations,    //Number of destinations
+    TimerWheel* _timerWheel,    //Timer wheel where feedback timers are armed
+    bool _verbose)              //Verbosity flag
+{
+    numberDestinations = _numberDestinations;
+    timerWheel = _timerWheel;
+    verbose = _verbose;
+
+    processes = new HarqProcess*[numberDestinations];
+    for(int i=0;i<numberDestinations;i++){
+        processes[i] = new HarqProcess[NUMBER_HARQ_PROCESSES];
+        for(int j=0;j<NUMBER_HARQ_PROCESSES;j++){
+            processes[i][j].busy = false;
+            processes[i][j].pendingRetransmission = false;
+            processes[i][j].numberRetransmissions = 0;
+            processes[i][j].newDataIndicator = 0;
+            processes[i][j].feedbackTimer = INVALID_TIMER;
+            processes[i][j].transmissionId = 0;
+        }
+    }
+}
+
+HarqEntity::~HarqEntity(){
+    clear();
+    for(int i=0;i<numberDestinations;i++)
+        delete [] processes[i];
+    delete [] processes;
+}
+
+uint8_t
+HarqEntity::encodeSequenceNumber(
+    int process,                //HARQ process ID
+    uint8_t newDataIndicator)   //New data indicator
+{
+    return (newDataIndicator? HARQ_NEW_DATA_INDICATOR:0)|(process&HARQ_PROCESS_NONE);
+}
+
+void
+HarqEntity::armFeedbackTimer(
+    int index,      //Index of destination
+    int process)    //HARQ process ID
+{
+    HarqProcess & harqProcess = processes[index][process];
+    uint32_t transmissionId = ++harqProcess.transmissionId;
+
+    timerWheel->cancel(harqProcess.feedbackTimer);
+    harqProcess.feedbackTimer = timerWheel->arm(HARQ_FEEDBACK_TIMEOUT, [this, index, process, transmissionId](){ feedbackTimeout(index, process, transmissionId); });
+}
+
+bool
+HarqEntity::hasIdleProcess(
+    int index)      //Index of destination
+{
+    lock_guard<mutex> lk(harqMutex);
+    for(int j=0;j<NUMBER_HARQ_PROCESSES;j++)
+        if(!processes[index][j].busy)
+            return true;
+    return false;
+}
+
+int
+HarqEntity::startTransmission(
+    int index,                      //Index of destination
+    const PooledMacPdu & macPdu)    //Handle of transport block to be sent
+{
+    lock_guard<mutex> lk(harqMutex);
+    int process;        //HARQ process ID
+
+    for(process=0;process<NUMBER_HARQ_PROCESSES && processes[index][process].busy;process++);
+    if(process==NUMBER_HARQ_PROCESSES){
+        macPdu->macphy_ctl_.sequence_number = HARQ_PROCESS_NONE;
+        return -1;
+    }
+
+    HarqProcess & harqProcess = processes[index][process];
+    harqProcess.busy = true;
+    harqProcess.pendingRetransmission = false;
+    harqProcess.numberRetransmissions = 0;
+    harqProcess.newDataIndicator ^= 1;
+    macPdu->macphy_ctl_.sequence_number = encodeSequenceNumber(process, harqProcess.newDataIndicator);
+    harqProcess.macPdu = macPdu;
+    harqProcess.allocation = macPdu->allocation_;
+    armFeedbackTimer(index, process);
+
+    return process;
+}
+
+int
+HarqEntity::getRetransmission(
+    int index,                  //Index of destination
+    PooledMacPdu & macPdu)      //Handle of transport block to be sent again
+{
+    lock_guard<mutex> lk(harqMutex);
+
+    for(int process=0;process<NUMBER_HARQ_PROCESSES;process++){
+        HarqProcess & harqProcess = processes[index][process];
+        if(harqProcess.busy && harqProcess.pendingRetransmission){
+            //Same transport block may have been sent again by ARQ through another process: restore this process configuration
+            macPdu = harqProcess.macPdu;
+            macPdu->macphy_ctl_.sequence_number = encodeSequenceNumber(process, harqProcess.newDataIndicator);
+            macPdu->allocation_ = harqProcess.allocation;
+            return process;
+        }
+    }
+    return -1;
+}
+
+void
+HarqEntity::confirmRetransmission(
+    int index,                          //Index of destination
+    int process,                        //HARQ process ID
+    const allocation_cfg_t & allocation)//Resource allocation used by retransmission
+{
+    lock_guard<mutex> lk(harqMutex);
+    HarqProcess & harqProcess = processes[index][process];
+
+    harqProcess.pendingRetransmission = false;
+    harqProcess.numberRetransmissions++;
+    harqProcess.allocation = allocation;
+    armFeedbackTimer(index, process);
+    if(verbose) cout<<"[HarqEntity] Retransmission "<<harqProcess.numberRetransmissions<<" of HARQ process "<<process<<"."<<endl;
+}
+
+void
+HarqEntity::receiveFeedback(
+    int index,      //Index of destination
+    int process,    //HARQ process ID
+    bool ack)       //ACK/NACK flag
+{
+    if(index<0 || index>=numberDestinations || process<0 || process>=NUMBER_HARQ_PROCESSES)
+        return;
+
+    lock_guard<mutex> lk(harqMutex);
+    HarqProcess & harqProcess = processes[index][process];
+
+    //Feedback of a process not waiting for it (e.g. after timeout) is ignored
+    if(!harqProcess.busy || harqProcess.pendingRetransmission)
+        return;
+    timerWheel->cancel(harqProcess.feedbackTimer);
+
+    //NACK: transport block is sent again, unless retransmissions are exhausted; then, loss is left to upper layers
+    if(!ack && harqProcess.numberRetransmissions<MAXIMUM_HARQ_RETRANSMISSIONS){
+        harqProcess.pendingRetransmission = true;
+        return;
+    }
+    if(!ack && verbose) cout<<"[HarqEntity] HARQ process "<<process<<" gave up after "<<MAXIMUM_HARQ_RETRANSMISSIONS<<" retransmissions."<<endl;
+
+    harqProcess.busy = false;
+    harqProcess.macPdu.reset();
+}
+
+void
+HarqEntity::feedbackTimeout(
+    int index,                  //Index of destination
+    int process,                //HARQ process ID
+    uint32_t transmissionId)    //Transmission that armed the timer
+{
+    lock_guard<mutex> lk(harqMutex);
+    HarqProcess & harqProcess = processes[index][process];
+
+    if(!harqProcess.busy || harqProcess.transmissionId!=transmissionId)
+        return;
+    harqProcess.feedbackTimer = INVALID_TIMER;
+    harqProcess.busy = false;
+    harqProcess.pendingRetransmission = false;
+    harqProcess.macPdu.reset();
+}
+
+void
+HarqEntity::clear(){
+    lock_guard<mutex> lk(harqMutex);
+
+    for(int i=0;i<numberDestinations;i++){
+        for(int j=0;j<NUMBER_HARQ_PROCESSES;j++){
+            timerWheel->cancel(processes[i][j].feedbackTimer);
+            processes[i][j].busy = false;
+            processes[i][j].pendingRetransmission = false;
+            processes[i][j].macPdu.reset();
+        }
+    }
+}
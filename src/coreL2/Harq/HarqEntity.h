@@ -0,0 +1,135 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+
+#ifndef INCLUDED_HARQ_ENTITY_H
+#define INCLUDED_HARQ_ENTITY_H
+
+#include <iostream>     //cout
+#include <mutex>        //std::mutex
+#include <stdint.h>     //uint8_t
+
+#include "../TimerWheel/TimerWheel.h"
+#include "../MacPduPool/MacPduPool.h"
+#include "../../common/lib5grange/lib5grange.h"
+#include "../../common/libMac5gRange/libMac5gRange.h"
+
+using namespace std;
+using namespace lib5grange;
+
+#define NUMBER_HARQ_PROCESSES 8             //Parallel stop-and-wait processes of each destination
+#define MAXIMUM_HARQ_RETRANSMISSIONS 3      //Retransmissions of a transport block before it is given up to upper layers
+#define HARQ_FEEDBACK_TIMEOUT 8             //Subframes waited for feedback; L1 reporting no feedback at all means transport block was delivered
+
+/**
+ * @brief HARQ process: a transport block kept until L1 reports it was decoded by the receiver
+ */
+typedef struct{
+    PooledMacPdu macPdu;            //Handle of transport block sent, shared with ARQ, kept for retransmission
+    allocation_cfg_t allocation;    //Resource allocation of last transmission; shared object may be sent meanwhile by another process
+    bool busy;                      //Flag indicating process waits for feedback or retransmission
+    bool pendingRetransmission;     //Flag indicating NACK was received and transport block must be sent again
+    int numberRetransmissions;      //Number of retransmissions of current transport block
+    uint8_t newDataIndicator;       //Toggled for each new transport block of the process
+    TimerHandle feedbackTimer;      //Timer waiting for feedback
+    uint32_t transmissionId;        //Incremented on each (re)transmission, so stale feedback timeouts are ignored
+}HarqProcess;
+
+/**
+ * @brief Hybrid ARQ at L2/L1 boundary: NUMBER_HARQ_PROCESSES stop-and-wait processes per destination
+ * Process ID and new data indicator go to L1 in macphyctl_t::sequence_number; L1 reports ACK/NACK of each process
+ * in HarqFeedback messages, and transport blocks NACKed are sent again with the same configuration.
+ */
+class HarqEntity{
+private:
+    HarqProcess** processes;        //Processes of each destination (same indexes of Transmission Queues)
+    int numberDestinations;         //Number of destinations
+    TimerWheel* timerWheel;         //Timer wheel where feedback timers are armed
+    mutex harqMutex;                //Mutex to control access to processes
+    bool verbose;                   //Verbosity flag
+
+    /**
+     * @brief Called when feedback of a transmission did not arrive in time: process is released
+     * @param index Index of destination
+     * @param process HARQ process ID
+     * @param transmissionId Transmission that armed the timer
+     */
+    void feedbackTimeout(int index, int process, uint32_t transmissionId);
+
+    /**
+     * @brief Arms feedback timer of a process for its current transmission; harqMutex must be locked
+     * @param index Index of destination
+     * @param process HARQ process ID
+     */
+    void armFeedbackTimer(int index, int process);
+
+public:
+    /**
+     * @brief Constructs HarqEntity with all processes idle
+     * @param _numberDestinations Number of destinations
+     * @param _timerWheel Timer wheel where feedback timers are armed
+     * @param _verbose Verbosity flag
+     */
+    HarqEntity(int _numberDestinations, TimerWheel* _timerWheel, bool _verbose);
+
+    /**
+     * @brief Destroys HarqEntity
+     */
+    ~HarqEntity();
+
+    /**
+     * @brief Verifies if a destination has a process free for a new transport block
+     * @param index Index of destination
+     * @returns True if there is an idle process
+     */
+    bool hasIdleProcess(int index);
+
+    /**
+     * @brief Assigns a new transport block to an idle process, writing process ID and new data indicator in its MAC/PHY control,
+     * and keeps a handle of it
+     * @param index Index of destination
+     * @param macPdu Handle of transport block to be sent
+     * @returns HARQ process ID; -1 if all processes are busy (transport block is sent without HARQ)
+     */
+    int startTransmission(int index, const PooledMacPdu & macPdu);
+
+    /**
+     * @brief Gets next transport block of a destination that must be sent again, with MAC/PHY control and allocation of the process restored
+     * @param index Index of destination
+     * @param macPdu Variable where handle of transport block will be stored
+     * @returns HARQ process ID; -1 if there is no retransmission pending
+     */
+    int getRetransmission(int index, PooledMacPdu & macPdu);
+
+    /**
+     * @brief Marks retransmission got with getRetransmission() as sent, with allocation it was finally given
+     * @param index Index of destination
+     * @param process HARQ process ID
+     * @param allocation Resource allocation used by retransmission
+     */
+    void confirmRetransmission(int index, int process, const allocation_cfg_t & allocation);
+
+    /**
+     * @brief Treats ACK/NACK reported by L1
+     * @param index Index of destination
+     * @param process HARQ process ID
+     * @param ack True for ACK; false for NACK
+     */
+    void receiveFeedback(int index, int process, bool ack);
+
+    /**
+     * @brief Releases all processes, e.g. when MAC is reconfigured
+     */
+    void clear();
+
+    /**
+     * @brief Encodes HARQ process ID and new data indicator as macphyctl_t::sequence_number
+     * @param process HARQ process ID
+     * @param newDataIndicator New data indicator
+     * @returns Sequence number
+     */
+    static uint8_t encodeSequenceNumber(int process, uint8_t newDataIndicator);
+};
+#endif  //INCLUDED_HARQ_ENTITY_H
@@ -17,7 +17,7 @@ Company : Centro de Pesquisa e Desenvolvimento em Telecomunicacoes (CPQD)
 Direction : Diretoria de Operações (DO)
 UA : 1230 - Centro de Competencia - Sistemas Embarcados
 @Description : This module controls de communication between MAC and PHY,
-    using UPD sockets in the two Layers to exchange data Bytes and control Bytes. 
+    using UPD sockets or shared memory rings in the two Layers to exchange data Bytes and control Bytes. 
     CRC Calculation and checking is made here too.
 */
 
@@ -27,100 +27,91 @@ using namespace std;
 using namespace lib5grange;
 
 L1L2Interface::L1L2Interface(
-    bool _verbose)      //Verbosity flag
+    InterlayerTransports transportType,     //Transport used to exchange messages with PHY
+    macpdu_wire_format_t _wireFormat,       //Format in which PDUs are serialized to PHY
+    bool _verbose)                          //Verbosity flag
 {
     verbose = _verbose;
+    wireFormat = _wireFormat;
+    batchOpen = false;
 
-    //Client PDUs socket creation
-    socketPduToL1 = createClientSocketToSendMessages(PORT_TO_L1, &serverPdusSocketAddress, "127.0.0.1");
-
-    //ServerPDUs socket creation
-    socketPduFromL1 = createServerSocketToReceiveMessages(PORT_FROM_L1);
-    
-    //Client Control Messages socket creation
-    socketControlMessagesToL1 = createClientSocketToSendMessages(CONTROL_MESSAGES_PORT_TO_L1, &serverControlMessagesSocketAddress, "127.0.0.1");
+    //Transport creation: sockets or rings to send and receive PDUs and Control Messages
+    transport = InterlayerTransport::create(transportType, true, verbose);
+}
 
-    //Server Control Messages socket creation
-    socketControlMessagesFromL1 = createServerSocketToReceiveMessages(CONTROL_MESSAGES_PORT_FROM_L1);
-    
+L1L2Interface::L1L2Interface(
+    InterlayerTransport* _transport,        //Transport used to exchange messages with PHY
+    macpdu_wire_format_t _wireFormat,       //Format in which PDUs are serialized to PHY
+    bool _verbose)                          //Verbosity flag
+{
+    verbose = _verbose;
+    wireFormat = _wireFormat;
+    batchOpen = false;
+    transport = _transport;
 }
 
 L1L2Interface::~L1L2Interface() {
-    close(socketPduFromL1);
-    close(socketPduToL1);
-    close(socketControlMessagesToL1);
-    close(socketControlMessagesFromL1);
+    delete transport;
 }
 
-int
-L1L2Interface::createClientSocketToSendMessages(
-    short port,                                     //Socket Port
-    struct sockaddr_in* serverReceiverOfMessage,    //Struct to store server address to which client will send messages
-    const char* serverIp)                           //Ip address of server
+vector<uint8_t> &
+L1L2Interface::queueMessage(
+    InterlayerChannels channel)     //Outgoing channel of message
 {
-    int socketDescriptor;
-
-    //Client socket creation
-    socketDescriptor = socket(AF_INET, SOCK_DGRAM, 0);
-    if(socketDescriptor==-1) perror("[L1L2Interface] Socket to send information creation failed.");
-    else if(verbose) cout<<"[L1L2Interface] Client socket to send info created successfully."<<endl;
-    bzero(serverReceiverOfMessage, sizeof(*serverReceiverOfMessage));
-
-    serverReceiverOfMessage->sin_family = AF_INET;
-    serverReceiverOfMessage->sin_port = htons(port);
-    serverReceiverOfMessage->sin_addr.s_addr = inet_addr(serverIp);  //Localhost
-    return socketDescriptor;
+    //Buffer pointers are only taken when batch is sent, as batchBuffers may grow meanwhile
+    InterlayerMessage message = {channel, NULL, 0};
+    batchMessages.push_back(message);
+    if(batchBuffers.size()<batchMessages.size())
+        batchBuffers.resize(batchMessages.size());
+
+    vector<uint8_t> & buffer = batchBuffers[batchMessages.size()-1];
+    buffer.clear();
+    return buffer;
 }
 
-int
-L1L2Interface::createServerSocketToReceiveMessages(
-    short port)         //Socket Port
-{
-    struct sockaddr_in sockname;        //Struct to configure which address server will bind to
-    int socketDescriptor;
+void
+L1L2Interface::sendBatch(){
+    if(batchMessages.empty())
+        return;
 
-    socketDescriptor = socket(AF_INET, SOCK_DGRAM, 0);
-    if(socketDescriptor==-1) perror("[L1L2Interface] Socket to receive information creation failed.");
+    for(size_t i=0;i<batchMessages.size();i++){
+        batchMessages[i].buffer = (const char*) batchBuffers[i].data();
+        batchMessages[i].numberBytes = batchBuffers[i].size();
+    }
 
-    bzero(&sockname, sizeof(sockname));
+    //Verify if transmission was successful
+    if(transport->sendBatch(&(batchMessages[0]), batchMessages.size())){
+        if(verbose) cout<<"[L1L2Interface] "<<batchMessages.size()<<" messages sent."<<endl;
+    }
+    else
+        if(verbose) cout<<"[L1L2Interface] Could not send "<<batchMessages.size()<<" messages."<<endl;
+    batchMessages.clear();
+}
 
-    sockname.sin_family = AF_INET;
-    sockname.sin_port = htons(port);
-    sockname.sin_addr.s_addr = htonl(INADDR_ANY);
+void
+L1L2Interface::beginBatch(){
+    lock_guard<mutex> lk(sendMutex);
+    batchOpen = true;
+}
 
-    //Serve bind to socket to listen to local messages in port PORT_FROM_L1
-    int bindSuccess = bind(socketDescriptor, (const sockaddr*)(&sockname), sizeof(sockname));
-    if(bindSuccess==-1)
-        perror("[L1L2Interface] Bind error.\n");
-    else
-        if(verbose) cout<<"[L1L2Interface] Bind successfully to listen to messages."<<endl;
-    return socketDescriptor;
+void
+L1L2Interface::flushBatch(){
+    lock_guard<mutex> lk(sendMutex);
+    batchOpen = false;
+    sendBatch();
 }
 
 void
 L1L2Interface::sendPdu(
-	MacPDU macPdu,          //MAC PDU structure
+	MacPDU & macPdu,        //MAC PDU structure
 	uint8_t macAddress)     //Destination MAC Address
 {
-    size_t numberSent;      //Number of Bytes sent to L1
-
-    //Perform CRC calculation
-    size_t numberDataBytes = macPdu.mac_data_.size();   //Number of Data Bytes before inserting CRC
-    macPdu.mac_data_.resize(numberDataBytes+2);
-    crcPackageCalculate((char*)&(macPdu.mac_data_[0]), numberDataBytes);
-    //Serialize MAC PDU
-    vector<uint8_t> serializedMacPdu;
-    macPdu.serialize(serializedMacPdu);
-
-    //Send PDU to L1
-    numberSent = sendto(socketPduToL1,&(serializedMacPdu[0]), serializedMacPdu.size(), MSG_CONFIRM, (const struct sockaddr*)(&serverPdusSocketAddress), sizeof(serverPdusSocketAddress));
-
-    //Verify if transmission was successful
-	if(numberSent!=-1){
-		if(verbose) cout<<"[L1L2Interface] Pdu sent:"<<serializedMacPdu.size()<<" bytes."<<endl;
-		return;
-	}
-	if(verbose) cout<<"[L1L2Interface] Could not send Pdu."<<endl;
+    //Serialize MAC PDU into reused buffer of batch; it is sent at once if no batch is open.
+    //CRC was appended to data when PDU was gathered, so PDU is not read again here
+    lock_guard<mutex> lk(sendMutex);
+    macPdu.serialize(queueMessage(L2_TO_L1_PDUS), wireFormat);
+    if(!batchOpen)
+        sendBatch();
 }
 
 ssize_t
@@ -131,15 +122,15 @@ L1L2Interface::receivePdu(
 {
     ssize_t returnValue;    //Value that will be returned at the end of this procedure
 
-    //Perform socket UDP packet reception
-    returnValue = recv(socketPduFromL1, (void*)buffer, maximumSize, MSG_WAITALL);
+    //Perform PDU reception
+    returnValue = transport->receive(L1_TO_L2_PDUS, (char*)buffer, maximumSize, true);
 
-    //Test if PDU received is valid and checks CRC
-    if(returnValue>0){
-        if(!crcPackageChecking((char*)buffer, returnValue))
-            return -2;
-    }
-    return returnValue==0? 0:returnValue-2;     //Value returned considers size without CRC Bytes
+    //Test if PDU received is valid, i.e. it has at least one byte besides CRC, and checks CRC
+    if(returnValue<CRC_LENGTH+1)
+        return -1;
+    if(!crcPackageChecking((char*)buffer, returnValue))
+        return -2;
+    return returnValue-CRC_LENGTH;     //Value returned considers size without CRC Bytes
 }
 
 void
@@ -147,7 +138,13 @@ L1L2Interface::sendControlMessage(
     char* buffer,           //Buffer containing the message
     size_t numberBytes)     //Message size in Bytes
 {
-    if(sendto(socketControlMessagesToL1, buffer, numberBytes, MSG_CONFIRM, (const struct sockaddr*)(&serverControlMessagesSocketAddress), sizeof(serverControlMessagesSocketAddress))==-1){
+    lock_guard<mutex> lk(sendMutex);
+    if(batchOpen){
+        queueMessage(L2_TO_L1_CONTROL).assign(buffer, buffer+numberBytes);
+        return;
+    }
+
+    if(!transport->send(L2_TO_L1_CONTROL, buffer, numberBytes)){
         if(verbose) cout<<"[L1L2Interface] Error sending control message."<<endl;
     }
 }
@@ -157,20 +154,14 @@ L1L2Interface::receiveControlMessage(
     char* buffer,               //Buffer where message will be stored
     size_t maximumLength)       //Maximum message length in Bytes
 {
-    return recv(socketControlMessagesFromL1, buffer, maximumLength, MSG_DONTWAIT);
+    return transport->receive(L1_TO_L2_CONTROL, buffer, maximumLength, false);
 }
 
-void 
-L1L2Interface::crcPackageCalculate(
-    char* buffer,       //Buffer of Bytes of PDU
-    int size)           //PDU size in Bytes
+bool
+L1L2Interface::waitForControlMessage(
+    int timeout)        //Maximum waiting time in milliseconds
 {
-    unsigned short crc = 0x0000;
-    for(int i=0;i<size;i++){
-        crc = auxiliaryCalculationCRC(buffer[i],crc);
-    }
-    buffer[size] = crc>>8;
-    buffer[size+1] = crc&255;
+    return transport->waitForMessage(L1_TO_L2_CONTROL, timeout);
 }
 
 bool 
@@ -178,28 +169,10 @@ L1L2Interface::crcPackageChecking(
     char* buffer,       //Bytes of PDU
     int size)           //Size of PDU in Bytes
 {
-    //Perform CRC calculation with auxiliary function
+    //Compare CRC received with CRC calculated over the rest of PDU
     unsigned short crc1, crc2;
     crc1 = ((buffer[size-2]&255)<<8)|((buffer[size-1])&255);
-    crc2 = 0x0000;
-    for(int i=0;i<size-2;i++){
-        crc2 = auxiliaryCalculationCRC(buffer[i],crc2);
-    }
+    crc2 = CrcCalculator::calculate(CRC16_5GRANGE, buffer, size-2);
 
     return crc1==crc2;
 }
-
-unsigned short 
-L1L2Interface::auxiliaryCalculationCRC(
-    char data,              //Byte from PDU
-    unsigned short crc)     //CRC history
-{
-    //Perform CRC calculation per Byte
-    char i, bit;
-    for(i=0x01;i;i<<=1){
-        bit = (((crc&0x0001)?1:0)^((data&i)?1:0));
-        crc>>=1;
-        if(bit) crc^=0x9299;
-    }
-    return crc;
-}
@@ -7,62 +7,56 @@
 #ifndef INCLUDED_L1_L2_INTERFACE_H
 #define INCLUDED_L1_L2_INTERFACE_H
 
-#define PORT_TO_L1 8090
-#define PORT_FROM_L1 8091
-#define CONTROL_MESSAGES_PORT_TO_L1 8092
-#define CONTROL_MESSAGES_PORT_FROM_L1 8093
+#define CRC_LENGTH 2        //Number of CRC bytes appended to each PDU
 
 #include <iostream>
 #include <vector>
-#include <sys/socket.h> //socket(), AF_INET, SOCK_DGRAM
-#include <arpa/inet.h>  //struct sockaddr_in
-#include <string.h>     //bzero()
-#include <unistd.h>     //close()
+#include <mutex>        //std::mutex
 #include "../../common/lib5grange/lib5grange.h"
+#include "../../common/InterlayerTransport/InterlayerTransport.h"
+#include "../Crc/CrcCalculator.h"
 
 using namespace std;
 using namespace lib5grange;
 
 class L1L2Interface{
 private:
-    int socketPduFromL1;                        //File descriptor of socket used to RECEIVE PDUs from L1
-    int socketPduToL1;                          //File descriptor of socket used to SEND PDUs to L1
-    int socketControlMessagesFromL1;            //File descriptor of socket used to RECEIVE Control Messages from L1
-    int socketControlMessagesToL1;              //File descriptor of socket used to SEND Control Messages to L1
-    struct sockaddr_in serverPdusSocketAddress; //Address of server to which client will send PDUs
-    struct sockaddr_in serverControlMessagesSocketAddress;  //Address of server to which client will send control messages
+    InterlayerTransport* transport;             //Transport (UDP sockets or shared memory) of PDUs and Control Messages to/from L1
+    macpdu_wire_format_t wireFormat;            //Format in which PDUs are serialized to L1
+    vector<vector<uint8_t> > batchBuffers;      //Buffer where each message of batch is stored; buffers keep their capacity, so sending allocates nothing
+    vector<InterlayerMessage> batchMessages;    //Messages queued to be sent together
+    bool batchOpen;                             //Flag indicating messages are queued until batch is flushed
+    mutex sendMutex;                            //Mutex to control access to batch
     bool verbose;                               //Verbosity flag
 
     /**
-    * @brief Auxiliary function for CRC calculation
-    * @param data Single byte from PDU
-    * @param crc CRC history
-    * @returns 2-byte CRC calculation
-    */
-    unsigned short auxiliaryCalculationCRC(char data, unsigned short crc);
+     * @brief Queues a message in batch; sendMutex must be held by caller
+     * @param channel Outgoing channel of message
+     * @returns Buffer where message must be stored
+     */
+    vector<uint8_t> & queueMessage(InterlayerChannels channel);
 
     /**
-     * @brief Creates a new socket to serve as sender of messages
-     * @param port Socket port
-     * @param serverReceiverOfMessage Struct used to send message later
-     * @param serverIp Ip address of server
-     * @returns Socket file descriptor used to send message later
+     * @brief Sends all messages queued in a single transport call; sendMutex must be held by caller
      */
-    int createClientSocketToSendMessages(short port, struct sockaddr_in *serverReceiverOfMessage, const char* serverIp);
+    void sendBatch();
 
+public:
     /**
-     * @brief Creates a new socket to serve as receiver of messages
-     * @param port Socket port
-     * @returns Socket file descriptor
+     * @brief Constroys a L1L2Interface object, initializes class variables with static information and allocate transport to communicate with PHY
+     * @param transportType Transport used to exchange messages with PHY
+     * @param _wireFormat Format in which PDUs are serialized to PHY
+     * @param _verbose verbosity flag
      */
-    int createServerSocketToReceiveMessages(short port);
+    L1L2Interface(InterlayerTransports transportType, macpdu_wire_format_t _wireFormat, bool _verbose);
 
-public:
     /**
-     * @brief Constroys a L1L2Interface object, initializes class variables with static information and allocate sockets tocommunicate with PHY
+     * @brief Constroys a L1L2Interface object over a transport already created, e.g. a transport that discards messages in benchmarks
+     * @param _transport Transport used to exchange messages with PHY; L1L2Interface takes ownership of it
+     * @param _wireFormat Format in which PDUs are serialized to PHY
      * @param _verbose verbosity flag
      */
-    L1L2Interface(bool _verbose);
+    L1L2Interface(InterlayerTransport* _transport, macpdu_wire_format_t _wireFormat, bool _verbose);
 
     /**
      * @brief Destroys a L1L2Interface object
@@ -70,18 +64,28 @@ public:
     ~L1L2Interface();
 
     /**
-     * @param macPdu MAC PDU structure containing all information PHY needs
+     * @brief Starts a batch: PDUs and Control Messages are queued, instead of sent, until flushBatch() is called
+     * Caller must keep other threads from sending to PHY until batch is flushed.
+     */
+    void beginBatch();
+
+    /**
+     * @brief Sends all PDUs and Control Messages queued since beginBatch(), in order, in a single transport call
+     */
+    void flushBatch();
+
+    /**
+     * @param macPdu MAC PDU structure containing all information PHY needs; its data already ends with CRC (see MacController::getMacPdu())
      * @param macAddress Destination MAC Address
-     * @returns True if transmission was successful, false otherwise
      */
-    void sendPdu(MacPDU _macPdu, uint8_t macAddress);
+    void sendPdu(MacPDU & macPdu, uint8_t macAddress);
 
     /**
      * @brief Received a PDU from PHY Layer
      * @param buffer Buffer where PDU is going to be store
      * @param maximumSize Maximum size of PDU
      * @param macAddress Source MAC Address from which packet will be received
-     * @returns Received PDU size in bytes
+     * @returns Received PDU size in bytes, CRC excluded; -1 if reception failed or PDU is too short; -2 on CRC error
      */
     ssize_t receivePdu(const char* buffer, size_t maximumSize, uint8_t macAddress);
 
@@ -101,11 +105,11 @@ public:
     ssize_t receiveControlMessage(char* buffer, size_t maximumLength);
 
     /**
-     * @brief Calculates CRC of current PDU passed as parameter
-     * @param buffer Bytes of current PDU
-     * @param size Size of PDU in bytes
+     * @brief Blocks until a Control Message from PHY can be received
+     * @param timeout Maximum waiting time in milliseconds
+     * @returns True if a message is available; false if timeout expired
      */
-    void crcPackageCalculate(char* buffer, int size);
+    bool waitForControlMessage(int timeout);
 
     /**
      * @brief Checks if CRC contained in received PDU matches calculated CRC
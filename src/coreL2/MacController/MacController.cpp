@@ -21,7 +21,7 @@ UA : 1230 - Centro de Competencia - Sistemas Embarcados
 
 @Description : This module manages all System execution modes and their transitions. 
     It creates and starts TUN Interface reading, Control SDUs creation, 
-    Sending timeout control, and decoding threads. Also, management of
+    subframe scheduling, and decoding threads. Also, management of
     SDUs concatenation into PDU is made by this module.
 */
 
@@ -30,12 +30,28 @@ UA : 1230 - Centro de Competencia - Sistemas Embarcados
 MacController::MacController(
     const char* _deviceNameTun,     			//TUN device name
     bool _verbose)                  			//Verbosity flag
+    : MacController(_deviceNameTun, 1, vector<int>(), _verbose) { }
+
+MacController::MacController(
+    const char* _deviceNameTun,     			//TUN device name
+    int _numberTunQueues,                       //Number of TUN queues
+    const vector<int> & _tunCores,              //CPU cores where TUN reading threads are pinned
+    bool _verbose)                  			//Verbosity flag
 {    
     //Assign verbosity flag
     verbose = _verbose;
 
-    //Assign TUN device name
+    //Proportional-fair scheduling is used unless another policy is set before initialization
+    schedulingPolicyType = PROPORTIONAL_FAIR;
+
+    //L1 is reached through UDP sockets unless shared memory is set before initialization
+    interlayerTransportType = UDP_TRANSPORT;
+    pduWireFormat = MACPDU_WIRE_FLAT;
+
+    //Assign TUN device name, number of queues and cores
     deviceNameTun = _deviceNameTun;
+    numberTunQueues = _numberTunQueues<1? 1:(_numberTunQueues>MAXIMUM_TUN_QUEUES? MAXIMUM_TUN_QUEUES:_numberTunQueues);
+    tunCores = _tunCores;
 
     //Read default information from file and record to "Current.txt"
     currentParameters = new CurrentParameters(verbose);
@@ -51,9 +67,22 @@ MacController::MacController(
 
 MacController::~MacController(){
     delete [] rxMetrics;
+    delete schedulingPolicy;
+    delete [] averageThroughputs;
+    delete [] subframeMacPdus;
+    delete [] subframeMacAddresses;
+    delete uplinkScheduler;
+    delete arq;
+    delete harq;
+    delete timerWheel;
+    delete [] ackTimers;
+    delete [] ackRetries;
+    delete [] ssReportTimers;
     delete protocolControl;
     delete protocolData;
+    delete macPduPool;
     delete mux;
+    delete sduReassembler;
     delete macHigh;
     delete receptionProtocol;
     delete transmissionProtocol;
@@ -61,6 +90,7 @@ MacController::~MacController(){
     delete l1l2Interface;
     delete [] threads;
     delete [] queueConditionVariables;
+    delete [] queueMutexes;
     delete ipMacTable;
 
     //Delete current system parameters only shutting down MAC
@@ -71,6 +101,27 @@ MacController::~MacController(){
     }
 }
 
+void
+MacController::setSchedulingPolicy(
+    SchedulingPolicies policy)  //Scheduling policy
+{
+    schedulingPolicyType = policy;
+}
+
+void
+MacController::setInterlayerTransport(
+    InterlayerTransports transport)     //Transport used to exchange messages with L1
+{
+    interlayerTransportType = transport;
+}
+
+void
+MacController::setPduWireFormat(
+    macpdu_wire_format_t format)    //Format in which PDUs are serialized to L1
+{
+    pduWireFormat = format;
+}
+
 void
 MacController::initialize(){
     currentMacMode = STANDBY_MODE;      //Initializes MAC in STANDBY_MODE 
@@ -115,43 +166,59 @@ MacController::manager(){
                 ipMacTable->addEntry(addressEntry1, 1, false);
                 ipMacTable->addEntry(addressEntry2, 2, false);
 
-                //Create condition variables
+                //Create condition variables and mutexes of each Transmission Queue
                 queueConditionVariables = new condition_variable[currentParameters->getNumberUEs()];
+                queueMutexes = new mutex[currentParameters->getNumberUEs()];
                 
                 //Create Tun Interface and allocate it
-                tunInterface = new TunInterface(deviceNameTun, verbose);
+                tunInterface = new TunInterface(deviceNameTun, numberTunQueues, verbose);
                 if(!(tunInterface->allocTunInterface())){
                     if(verbose) cout << "[MacController] Error allocating tun interface." << endl;
                     exit(1);
                 }
 
                 //Create L1L2Interface
-                l1l2Interface = new L1L2Interface(verbose);
+                l1l2Interface = new L1L2Interface(interlayerTransportType, pduWireFormat, verbose);
 
                 //Create reception and transmission protocols
                 receptionProtocol = new ReceptionProtocol(l1l2Interface, tunInterface, verbose);
                 transmissionProtocol = new TransmissionProtocol(l1l2Interface,tunInterface, verbose);
 
                 //Create MACHigh queue to store IP packets received from TUN
-                macHigh = new MacHighQueue(receptionProtocol, verbose);
+                macHigh = new MacHighQueue(receptionProtocol, numberTunQueues, verbose);
 
                 //Threads definition
                 /** Threads order:
-                 * 0 .. numberEquipments-1    ---> Timeout control threads
-                 * numberEquipments           ---> ProtocolData MACD SDU enqueueing (From L3)
-                 * numberEquipments+1         ---> Data SDU enqueueing from TUN interface in MacHighQueue
-                 * numberEquipments+2         ---> Reading control messages from PHY
+                 * 0                          ---> Subframe scheduler, sending PDUs to PHY
+                 * 1                          ---> ProtocolData MACD SDU enqueueing (From L3)
+                 * 2                          ---> Reading control messages from PHY
+                 * 3                          ---> Timer wheel, expiring all MAC timeouts
+                 * 4 .. 3+numberTunQueues     ---> Data SDU enqueueing from each TUN queue in MacHighQueue
                  */
-                threads = new thread[3+currentParameters->getNumberUEs()];
+                threads = new thread[4+numberTunQueues];
 
                 //Create Multiplexer and set its TransmissionQueues
-                mux = new Multiplexer(currentParameters->getMTU(), currentMacAddress, ipMacTable, MAXSDUS, flagBS, verbose);     //PROVISIONAL UNIVERSAL MTU
+                mux = new Multiplexer(currentParameters->getMTU(), currentMacAddress, ipMacTable, MAXSDUS, flagBS? currentParameters->getNumberUEs():1, flagBS, verbose);     //PROVISIONAL UNIVERSAL MTU
                 if(flagBS){
                     for(int i=0;i<currentParameters->getNumberUEs();i++)
                         mux->setTransmissionQueue(currentParameters->getMacAddress(i));
                 }
                 else mux->setTransmissionQueue(0);      //UE needs a single Transmission Queue to BS
 
+                //Size PDUs of each destination according to its transport block capacity
+                updatePduSizes();
+
+                //Create MAC PDU objects with room for the largest PDU and its CRC; PDUs ARQ and HARQ keep for retransmission stay in pool objects.
+                //Objects for scheduling and HARQ are allocated now; pool grows only while ARQ windows fill up
+                macPduPool = new MacPduPool((MAC_PDUS_PER_DESTINATION+NUMBER_HARQ_PROCESSES)*mux->getNumberTransmissionQueues(),
+                                            (MAC_PDUS_PER_DESTINATION+ARQ_WINDOW_SIZE+NUMBER_HARQ_PROCESSES)*mux->getNumberTransmissionQueues(),
+                                            MAXIMUM_PDU_LENGTH+CRC_LENGTH, verbose);
+                subframeMacPdus = new PooledMacPdu[mux->getNumberTransmissionQueues()];
+                subframeMacAddresses = new uint8_t[mux->getNumberTransmissionQueues()];
+
+                //Create SduReassembler to rebuild SDUs segmented by the transmitter
+                sduReassembler = new SduReassembler(verbose);
+
                 //Create ProtocolData to deal with MACD SDUs
                 protocolData = new ProtocolData(this, macHigh, verbose);
 
@@ -160,9 +227,37 @@ MacController::manager(){
 
                 //Create a RxMetrics array
                 rxMetrics = new RxMetrics[currentParameters->getNumberUEs()];
+                for(int i=0;i<currentParameters->getNumberUEs();i++){
+                    rxMetrics[i].cqiReport = NO_CQI_REPORT;
+                    bzero(rxMetrics[i].ssReport, sizeof(rxMetrics[i].ssReport));    //No incumbent reported yet
+                }
+
+                //Create scheduling policy and clear average throughput of each destination
+                schedulingPolicy = SchedulingPolicy::create(schedulingPolicyType, verbose);
+                averageThroughputs = new double[mux->getNumberTransmissionQueues()]();
+
+                //BS resizes uplink reservations from buffer status reports; UE reports its buffers
+                vector<allocation_cfg_t> reservations;
+                currentParameters->getUlReservations(reservations);
+                uplinkScheduler = flagBS? new UplinkScheduler(reservations, verbose):NULL;
+                lastBufferStatusReport.clear();
+                bsrSubframeCounter = 0;
 
-                //Set subframe counter to zero
+                //Create timer wheel and timers of each UE; none is armed yet
+                timerWheel = new TimerWheel(verbose);
+                ackTimers = new TimerHandle[currentParameters->getNumberUEs()]();
+                ackRetries = new int[currentParameters->getNumberUEs()]();
+                ssReportTimers = new TimerHandle[currentParameters->getNumberUEs()]();
+
+                //Create HARQ processes of each destination, whose feedback timers are armed in timer wheel
+                harq = new HarqEntity(mux->getNumberTransmissionQueues(), timerWheel, verbose);
+
+                //Create ARQ windows of each destination; PDUs received are decoded as ARQ delivers them in sequence
+                arq = new ArqEntity(mux->getNumberTransmissionQueues(), timerWheel, [this](int index, vector<uint8_t> & pdu){ decodePdu(index, pdu); }, verbose);
+
+                //Set subframe counters to zero
                 subframeCounter = 0;
+                numberMissedSubframes = 0;
 
                 //#TODO: Send PHYConfig.Request here!
 
@@ -178,8 +273,15 @@ MacController::manager(){
                 //Here, all system threads that don't execute only in IDLE_MODE are started.
                 startThreads();
 
+                //BS starts waiting for RxMetrics of each UE
+                if(flagBS){
+                    for(int i=0;i<currentParameters->getNumberUEs();i++)
+                        restartSsReportTimer(i);
+                }
+
                 //Set MAC mode to start mode
                 currentMacMode = IDLE_MODE;
+                macHigh->notifyModeChange();
 
                 cout<<"\n\n[MacController] ___________ System entering IDLE mode. ___________\n"<<endl;
             }
@@ -194,6 +296,7 @@ MacController::manager(){
                     if(cliL2Interface->getMacConfigRequestCommandSignal()){           //MacConfigRequest
                         cliL2Interface->setMacConfigRequestCommandSignal(false);      //Reset flag
                         currentMacMode = RECONFIG_MODE;                                 //Change mode
+                        macHigh->notifyModeChange();                                    //Wake up threads blocked on MacHigh Queue
 
                         cout<<"\n\n[MacController] ___________ System entering RECONFIG mode. ___________\n"<<endl;
                     }
@@ -201,6 +304,7 @@ MacController::manager(){
                         if(cliL2Interface->getMacStopCommandSignal()){                //Mac Stop
                             cliL2Interface->setMacStopCommandSignal(false);           //Reset flag
                             currentMacMode = STOP_MODE;                                 //Change mode
+                            macHigh->notifyModeChange();                                //Wake up threads blocked on MacHigh Queue
 
                             cout<<"\n\n[MacController] ___________ System entering STOP mode. ___________\n"<<endl;
                         }
@@ -210,6 +314,7 @@ MacController::manager(){
                     if(cliL2Interface->getMacStopCommandSignal()){                    //Mac Stop  
                         cliL2Interface->setMacStopCommandSignal(false);               //Reset flag
                         currentMacMode = STOP_MODE;                                     //Change mode
+                        macHigh->notifyModeChange();                                    //Wake up threads blocked on MacHigh Queue
 
                         cout<<"\n\n[MacController] ___________ System entering STOP mode. ___________\n"<<endl;
                     }
@@ -221,17 +326,18 @@ MacController::manager(){
             {
                 //To enter RECONFIG_MODE, TX and RX must be disabled
                 if(currentMacRxMode==DISABLED_MODE_RX && currentMacTxMode==DISABLED_MODE_TX){
-                    //Before alterations, send all PDUs currently enqueued, if they exist
+                    //Before alterations, send all PDUs currently enqueued (sealed and being filled), if they exist
                     if(flagBS){     //If this is BS
                         for(int i=0;i<currentParameters->getNumberUEs();i++){
-                            if(!(mux->emptyPdu(currentParameters->getMacAddress(i))))
-                                sendPdu(currentParameters->getMacAddress(i));
+                            while(!(mux->emptyPdu(currentParameters->getMacAddress(i))))
+                                if(!sendPdu(currentParameters->getMacAddress(i))) break;
                         }
                     }
                     else{       //If this is UE
-                        if(!(mux->emptyPdu(0)))
-                            sendPdu(0);
+                        while(!(mux->emptyPdu(0)))
+                            if(!sendPdu(0)) break;
                     }
+                    //PDUs that could not be numbered by ARQ stay enqueued and are sent by scheduler in IDLE_MODE
 
                     //System will update current parameters with cli-updated parameters
                     //#TODO: configure 2 types of parameter update: cli update and system update. System will update ULMCS, DLMCS and FLUT -> setSystemParameters()
@@ -240,20 +346,33 @@ MacController::manager(){
                     //Record updated parameters
                     currentParameters->recordTxtCurrentParameters();
 
-                    //Then, if it is BS, it will send Dynamic Parameters to UE via MACC SDU for reconfiguration
+                    //Resize PDUs according to new allocations and MCSs
+                    updatePduSizes();
+
+                    //Configured reservations replace uplink grants until next BSRs arrive
                     if(flagBS){
-                        vector<uint8_t> dynamicParametersBytes;
+                        vector<allocation_cfg_t> reservations;
+                        currentParameters->getUlReservations(reservations);
+                        uplinkScheduler->reset(reservations);
+                    }
+                    else
+                        lastBufferStatusReport.clear();
+
+                    //Transport blocks waiting for feedback were built with previous configuration
+                    harq->clear();
 
-                        //Send a MACC SDU to each UE attached
+                    //Then, if it is BS, it will send Dynamic Parameters to UE via MACC SDU for reconfiguration
+                    if(flagBS){
+                        //Send a MACC SDU to each UE attached, waiting for its ACK
                         for(int i=0;i<currentParameters->getNumberUEs();i++){
-                            dynamicParametersBytes.clear();
-                            cliL2Interface->dynamicParameters->serialize(currentParameters->getMacAddress(i), dynamicParametersBytes);
-                            protocolControl->enqueueControlSdus(&(dynamicParametersBytes[0]), dynamicParametersBytes.size(), currentParameters->getMacAddress(i));
+                            ackRetries[i] = 0;
+                            sendDynamicParameters(i);
                         }
                     }
 
                     //Set MAC mode back to idle mode
                     currentMacMode = IDLE_MODE;
+                    macHigh->notifyModeChange();
                 }
             }
             break;
@@ -286,23 +405,34 @@ void
 MacController::startThreads(){
     int i;   	//Auxiliary variable for loops
 
-    //For each equipment
-    for(i=0;i<currentParameters->getNumberUEs();i++){
-        //timeoutController threads - threads[0 .. attachedEquipments-1]
-        threads[i] = thread(&MacController::timeoutController, this, i);
-    }
+    //Subframe scheduler: seals and sends PDUs of all destinations
+    threads[0] = thread(&MacController::scheduler, this);
 
     //TUN queue control thread (only IDLE mode)
-    threads[i] = thread(&ProtocolData::enqueueDataSdus, protocolData, ref(currentMacMode), ref(currentMacTxMode));
-
-    //TUN reading and enqueueing thread
-    threads[i+1] = thread(&MacHighQueue::reading, macHigh, ref(currentMacMode), ref(currentMacTunMode));
+    threads[1] = thread(&ProtocolData::enqueueDataSdus, protocolData, ref(currentMacMode), ref(currentMacTxMode));
 
     //Control messages from PHY reading (only IDLE mode)
-    threads[i+2] = thread(&ProtocolControl::receiveInterlayerMessages, protocolControl, ref(currentMacMode), ref(currentMacRxMode));
+    threads[2] = thread(&ProtocolControl::receiveInterlayerMessages, protocolControl, ref(currentMacMode), ref(currentMacRxMode));
+
+    //Timer wheel ticking every subframe
+    threads[3] = thread(&MacController::timers, this);
+
+    //TUN reading and enqueueing threads, one per TUN queue
+    for(int queue=0;queue<numberTunQueues;queue++){
+        threads[4+queue] = thread(&MacHighQueue::reading, macHigh, ref(currentMacMode), ref(currentMacTunMode), queue);
+
+        //Pin thread to its core, so each queue (and its flows) is processed always by the same CPU
+        if(!tunCores.empty() && tunCores[queue%tunCores.size()]>=0){
+            cpu_set_t cpuSet;
+            CPU_ZERO(&cpuSet);
+            CPU_SET(tunCores[queue%tunCores.size()], &cpuSet);
+            if(pthread_setaffinity_np(threads[4+queue].native_handle(), sizeof(cpu_set_t), &cpuSet)!=0)
+                if(verbose) cout<<"[MacController] Could not pin TUN queue "<<queue<<" thread to core "<<tunCores[queue%tunCores.size()]<<"."<<endl;
+        }
+    }
 
     //Join all threads
-    int numberThreads = 3+currentParameters->getNumberUEs();
+    int numberThreads = 4+numberTunQueues;
     for(i=0;i<numberThreads;i++){
         //Join all threads that don't execute only in IDLE mode 
         threads[i].detach();
@@ -311,31 +441,113 @@ MacController::startThreads(){
     if(verbose) cout<<"[MacController] Threads started successfully."<<endl;
 }
 
-void 
+bool 
 MacController::sendPdu(
     uint8_t macAddress)     //Destination MAC Address of TransmissionQueue in the Multiplexer
 {
-    //Declaration of PDU buffers: data and control
-    char bufferPdu[MAXIMUM_BUFFER_LENGTH];
+    int index = mux->getTransmissionQueueIndex(macAddress);    //Index of TransmissionQueue and its mutex
+    if(index==-1){
+        if(verbose) cout<<"[MacController] Could not send PDU: MAC Address not found."<<endl;
+        return false;
+    }
+
+    unique_lock<mutex> queueLock(queueMutexes[index]);
+    return sendPdu(queueLock, macAddress);
+}
+
+bool 
+MacController::sendPdu(
+    unique_lock<mutex> & queueLock,     //Lock held on destination TransmissionQueue mutex
+    uint8_t macAddress)                 //Destination MAC Address of TransmissionQueue in the Multiplexer
+{
+    int index = mux->getTransmissionQueueIndex(macAddress);    //Index of TransmissionQueue and its mutex
+
+    //PDU is numbered by ARQ like those of the scheduler, so receiver does not deliver it ahead of its reordering window;
+    //while destination has no idle HARQ process or its ARQ window is full, PDU waits
+    if(index==-1 || !harq->hasIdleProcess(index) || !arq->isWindowOpen(index)){
+        queueLock.unlock();
+        return false;
+    }
+
+    PooledMacPdu macPdu = macPduPool->getMacPdu();  //Subframe with a single MAC PDU
+
+    //Without a free MAC PDU object, sealed PDU waits for scheduler
+    if(!macPdu){
+        queueLock.unlock();
+        return false;
+    }
+
+    //Gets PDU from multiplexer, gathered directly into MAC PDU data, and numbers it while queue is locked
+    getMacPdu(*macPdu, macAddress);
+    arq->startTransmission(index, macPdu);
+    harq->startTransmission(index, macPdu);
+
+    //Take L1 sending lock before releasing queue lock, so PDUs of the same destination keep their order;
+    //from here on, only sending of other PDUs waits, not enqueueing of SDUs
+    lock_guard<mutex> l1Lock(l1SendMutex);
+    queueLock.unlock();
+
+    //Wake threads waiting for the sealed PDU of this destination to be taken
+    queueConditionVariables[index].notify_all();
+
+    sendSubframe(&macPdu, &macAddress, 1);
+    return true;
+}
+
+ssize_t
+MacController::getMacPdu(
+    MacPDU & macPdu,        //MAC PDU object to be filled
+    uint8_t macAddress)     //Destination MAC Address
+{
+    //Gets PDU from multiplexer, gathered directly into MAC PDU data, and its CRC, calculated while it was gathered
+    CrcCalculator crcCalculator(CRC16_5GRANGE);
+    ssize_t numberDataBytesRead = mux->getPdu(macPdu.mac_data_, macAddress, crcCalculator);
+    if(numberDataBytesRead<0) numberDataBytesRead = 0;
+
+    //CRC is appended to data now, in room reserved for it; ARQ corrects it when sequence number is written
+    uint16_t crc = crcCalculator.getCrc();
+    macPdu.mac_data_.push_back(crc>>8);
+    macPdu.mac_data_.push_back(crc&255);
+
+    //Declaration of PDU control buffer
     char bufferControl[MAXIMUM_BUFFER_LENGTH];
-    bzero(bufferPdu, MAXIMUM_BUFFER_LENGTH);
     bzero(bufferControl, MAXIMUM_BUFFER_LENGTH);
 
-    //Gets PDU from multiplexer
-    ssize_t numberDataBytesRead = mux->getPdu(bufferPdu, macAddress);
-
     //Creates a Control Header to this PDU and inserts it
     MacCtHeader macControlHeader(flagBS, verbose);
     ssize_t numberControlBytesRead = macControlHeader.getControlData(bufferControl);
 
     //Fill MAC PDU with information 
-    setMacPduStaticInformation(numberDataBytesRead, macAddress);
-    macPDU.mac_data_.assign(bufferPdu, bufferPdu+numberDataBytesRead);
-    macPDU.control_data_.assign(bufferControl, bufferControl+numberControlBytesRead);
-    macPDU.allocation_.target_ue_id = macAddress;
-    macPDU.mcs_.num_info_bytes = numberDataBytesRead;
-    macPDU.allocation_.number_of_rb = get_num_required_rb(macPDU.numID_, macPDU.mimo_, macPDU.mcs_.modulation, 3/4 , numberDataBytesRead*8);
+    setMacPduStaticInformation(macPdu, numberDataBytesRead, macAddress);
+    macPdu.control_data_.assign(bufferControl, bufferControl+numberControlBytesRead);
+
+    return numberDataBytesRead;
+}
+
+void
+MacController::fillSpectrumAvailability(
+    RbAllocator & rbAllocator)      //Allocator of the RBs of the subframe
+{
+    uint8_t fLutMatrix[RB_BITMAP_BYTES];    //Fusion LUT bitmap
+
+    currentParameters->getFLUTMatrix(fLutMatrix);
+    rbAllocator.markBusy(fLutMatrix);
+
+    //Fused decision: an incumbent detected by any UE makes the RB busy
+    for(int i=0;i<currentParameters->getNumberUEs();i++){
+        lock_guard<mutex> lk(rxMetrics[i].accessControl);
+        rbAllocator.markBusy(rxMetrics[i].ssReport);
+    }
+
+    if(verbose) cout<<"[MacController] "<<rbAllocator.getNumberIdleRbs()<<" RBs idle in subframe."<<endl;
+}
 
+void
+MacController::sendSubframe(
+    PooledMacPdu* macPdus,      //MAC PDUs of the subframe
+    uint8_t* macAddresses,      //Destination MAC Address of each PDU
+    int numberPdus)             //Number of PDUs
+{
     //Create SubframeTx.Start message
     string messageParameters;		            //This string will contain the parameters of the message
 	vector<uint8_t> messageParametersBytes;	    //Vector to receive serialized parameters structure
@@ -345,9 +557,9 @@ MacController::sendPdu(
 
         //Fill the structure with information
     	messageBS.numUEs = currentParameters->getNumberUEs();
-    	messageBS.numPDUs = 1;
+    	messageBS.numPDUs = numberPdus;
         currentParameters->getFLUTMatrix(messageBS.fLutDL);
-        currentParameters->getUlReservations(messageBS.ulReservations);
+        uplinkScheduler->getSentGrants(messageBS.ulReservations);
     	messageBS.numerology = currentParameters->getNumerology();
     	messageBS.ofdm_gfdm = currentParameters->isGFDM()? 1:0;
     	messageBS.rxMetricPeriodicity = currentParameters->getRxMetricsPeriodicity();
@@ -385,63 +597,474 @@ MacController::sendPdu(
     //Add parameters to original message
     subFrameStartMessage+=messageParameters;
 
-    //Send interlayer messages and the PDU
+    //Send interlayer messages and the PDUs of the subframe in a single batch; each PDU goes back to pool once serialized
+    l1l2Interface->beginBatch();
     protocolControl->sendInterlayerMessages(&subFrameStartMessage[0], subFrameStartMessage.size());
-    transmissionProtocol->sendPackageToL1(macPDU, macAddress);
+    for(int i=0;i<numberPdus;i++){
+        transmissionProtocol->sendPackageToL1(*(macPdus[i]), macAddresses[i]);
+        macPdus[i].reset();
+    }
     protocolControl->sendInterlayerMessages(&subFrameEndMessage[0], subFrameEndMessage.size());
+    l1l2Interface->flushBatch();
 }
 
-void 
-MacController::timeoutController(
-    int index)      //Index that identifies the condition variable and destination MAC Address of a queue 
+bool
+MacController::sealPdu(
+    unique_lock<mutex> & queueLock,     //Lock held on destination TransmissionQueue mutex
+    int index)                          //Index of destination TransmissionQueue
+{
+    //Wait until scheduler takes previous sealed PDU of this destination; queue lock is released while waiting
+    while(mux->hasSealedPdu(index) && currentMacMode!=STOP_MODE){
+        //Scheduler takes sealed PDUs only in IDLE_MODE: in other modes, this thread sends it, as RECONFIG_MODE does with PDUs left
+        if(currentMacMode!=IDLE_MODE){
+            sendPdu(queueLock, mux->getDestinationMac(index));
+            queueLock.lock();
+            if(!mux->hasSealedPdu(index))
+                break;
+        }
+        queueConditionVariables[index].wait_for(queueLock, chrono::milliseconds(SEALED_PDU_WAIT_TIMEOUT));
+    }
+
+    //Seal PDU, so Transmission Queue is empty again; scheduler sends it on next subframe
+    return mux->sealPdu(index);
+}
+
+void
+MacController::waitForModeChange(
+    int timeout,                    //Maximum waiting time in milliseconds
+    uint64_t & seenModeChanges)     //Number of mode changes already seen by calling thread
+{
+    //Every mode change is notified through MacHigh Queue
+    macHigh->waitForModeChange(timeout, seenModeChanges);
+}
+
+chrono::microseconds
+MacController::getSubframeDuration(){
+    const numerology_cfg_t & numerologyCfg = lib5grange::numerology[currentParameters->getNumerology()];  //Current numerology
+
+    //Each symbol has m subsymbols of k samples plus cyclic prefix and suffix
+    double numberSamples = numerologyCfg.symbols_per_subframe*(numerologyCfg.m*numerologyCfg.k+numerologyCfg.ncp+numerologyCfg.ncs);
+    return chrono::microseconds((long)(numberSamples*1e6/SAMPLE_RATE));
+}
+
+size_t
+MacController::calculateRequiredRbs(
+    uint8_t macAddress,     //Destination MAC Address
+    size_t numberBytes)     //Number of bytes of PDU
+{
+    allocation_cfg_t allocation;    //Resources reserved to UE
+    mimo_cfg_t mimo;                //MIMO configuration
+    uint8_t mcs = getPduTransmissionConfiguration(macAddress, numberBytes, allocation, mimo);
+
+    size_t numberRbs = get_num_required_rb(currentParameters->getNumerology(), mimo, AdaptiveModulationCoding::getMcsConvertToModulation(mcs), 
+                                           AdaptiveModulationCoding::getMcsConvertToCodeRate(mcs), numberBytes*8);
+
+    //PDU never uses more than reservation of destination
+    return numberRbs<allocation.number_of_rb? numberRbs:allocation.number_of_rb;
+}
+
+void
+MacController::scheduler(){
+    chrono::steady_clock::time_point nextSubframe = chrono::steady_clock::now();  //Instant of next subframe
+
+    //Loop will execute until STOP mode is activated
+    while(currentMacMode!=STOP_MODE){
+        //Wait for next subframe; duration is reevaluated because numerology may change on RECONFIG
+        chrono::microseconds subframeDuration = getSubframeDuration();
+        nextSubframe += subframeDuration;
+        this_thread::sleep_until(nextSubframe);
+
+        //Schedule only in IDLE mode; clock restarts afterwards, so missed subframes are not sent in a burst
+        if(currentMacMode!=IDLE_MODE){
+            nextSubframe = chrono::steady_clock::now();
+            continue;
+        }
+
+        //After a stall of more than a subframe, clock is resynchronized: missed subframes are counted, not sent back-to-back
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if(now-nextSubframe>subframeDuration){
+            long numberMissed = (now-nextSubframe)/subframeDuration;
+            numberMissedSubframes += numberMissed;
+            nextSubframe = now;
+            if(verbose) cout<<"[MacController] Scheduler late: "<<numberMissed<<" subframes missed ("<<numberMissedSubframes<<" in total)."<<endl;
+        }
+
+        scheduleSubframe();
+    }
+    if(verbose) cout<<"[MacController] Scheduler entering STOP_MODE."<<endl;
+}
+
+double
+MacController::calculateBytesPerRb(
+    uint8_t macAddress)     //Destination MAC Address
 {
-    //Timeout declaration: static
-    chrono::milliseconds timeout = chrono::milliseconds(currentParameters->getIpTimeout());    //ms
+    allocation_cfg_t allocation;    //Resources reserved to UE
+    mimo_cfg_t mimo;                //MIMO configuration
+    uint8_t mcs = getTransmissionConfiguration(macAddress, allocation, mimo);
+
+    //Capacity of a single RB
+    allocation.number_of_rb = 1;
+    size_t numberBits = get_bit_capacity(currentParameters->getNumerology(), allocation, mimo, AdaptiveModulationCoding::getMcsConvertToModulation(mcs));
+    return numberBits*AdaptiveModulationCoding::getMcsConvertToCodeRate(mcs)/8;
+}
+
+bool
+MacController::enqueueSchedulerControlSdu(
+    int index,                  //Index of Transmission Queue
+    vector<uint8_t> & sdu)      //MACC SDU
+{
+    uint16_t sduOffset = 0;     //First byte of SDU not enqueued yet
+
+    //SDU is added whole or not at all: a first segment left in a PDU would reach receiver without the rest of SDU.
+    //If it does not fit, PDU is sealed unless a sealed PDU is already waiting
+    if(!mux->fitsWholeSdu(index, sdu.size()) && !mux->hasSealedPdu(index))
+        mux->sealPdu(index);
+    if(!mux->fitsWholeSdu(index, sdu.size()))
+        return false;
+    return mux->addSduIndex((char*) &sdu[0], sdu.size(), 0, index, sduOffset)==-1;
+}
+
+void
+MacController::sendBufferStatusReport(){
+    vector<size_t> queueBytes;          //Bytes pending on each logical queue
+    vector<uint8_t> bufferStatusReport; //Serialized BSR
+
+    //SDUs already multiplexed to BS, then SDUs waiting on each TUN queue
+    queueBytes.push_back(mux->getNumberPendingBytes(0));
+    for(int queue=0;queue<macHigh->getNumberQueues();queue++)
+        queueBytes.push_back(macHigh->getNumberBytes(queue));
+    UplinkScheduler::serializeBufferStatusReport(queueBytes, bufferStatusReport);
+
+    //Report only changes, repeating it periodically in case it was lost
+    bsrSubframeCounter++;
+    if(bufferStatusReport==lastBufferStatusReport && bsrSubframeCounter<BSR_PERIODICITY)
+        return;
+
+    if(enqueueSchedulerControlSdu(0, bufferStatusReport)){
+        lastBufferStatusReport = bufferStatusReport;
+        bsrSubframeCounter = 0;
+        if(verbose) cout<<"[MacController] Buffer status report enqueued to BS."<<endl;
+    }
+}
+
+void
+MacController::sendUplinkGrants(){
+    int numberUEs = currentParameters->getNumberUEs();  //Number of UEs attached
+    vector<size_t> requiredRbs(numberUEs);  //RBs each UE needs to send its pending bytes
+    allocation_cfg_t grant;                 //Uplink grant of a UE
+    vector<uint8_t> grantBytes;             //Serialized uplink grant
+
+    //UEs transmit with their Uplink MCS; pending bytes include their PDU CRC
+    for(int i=0;i<numberUEs;i++){
+        size_t pendingBytes = uplinkScheduler->getPendingBytes(i);
+        if(pendingBytes==0)
+            continue;
+
+        uint8_t macAddress = currentParameters->getMacAddress(i);
+        uint8_t mcs = currentParameters->getMcsUplink(macAddress);
+        allocation_cfg_t allocation;        //Resources reserved to UE
+        mimo_cfg_t mimo;                    //MIMO configuration
+        getTransmissionConfiguration(macAddress, allocation, mimo);
+        requiredRbs[i] = get_num_required_rb(currentParameters->getNumerology(), mimo, AdaptiveModulationCoding::getMcsConvertToModulation(mcs), 
+                                             AdaptiveModulationCoding::getMcsConvertToCodeRate(mcs), (pendingBytes+CRC_LENGTH)*8);
+    }
+    uplinkScheduler->calculateGrants(requiredRbs);
+
+    //Grants that changed are sent to UEs; those that do not fit this subframe are retried on next one
+    for(int i=0;i<numberUEs;i++){
+        if(!uplinkScheduler->getChangedGrant(i, grant))
+            continue;
+        UplinkScheduler::serializeUplinkGrant(grant, grantBytes);
+        int index = mux->getTransmissionQueueIndex(currentParameters->getMacAddress(i));
+        if(index!=-1 && enqueueSchedulerControlSdu(index, grantBytes))
+            uplinkScheduler->confirmGrantSent(i);
+    }
+}
+
+void
+MacController::applyUplinkGrant(
+    allocation_cfg_t grant)     //Uplink grant
+{
+    lock_guard<mutex> lk(queueMutexes[0]);     //Scheduler reads reservation with this lock held
+
+    grant.target_ue_id = currentParameters->getMacAddress(0);
+    currentParameters->setUlReservation(grant);
+    setPduSize(0);
+    if(verbose) cout<<"[MacController] Uplink grant of "<<(int)grant.number_of_rb<<" RBs from RB "<<(int)grant.first_rb<<" applied."<<endl;
+}
+
+void
+MacController::scheduleSubframe(){
+    int numberQueues = mux->getNumberTransmissionQueues();      //Number of destinations
+    vector<unique_lock<mutex>> queueLocks;  //Locks of all Transmission Queues while subframe is scheduled
+    vector<SchedulingCandidate> candidates; //Backlogged destinations
+    vector<size_t> servedBytes(numberQueues, 0);    //Bytes transmitted to each destination in this subframe
+    vector<int> indexes;                    //Indexes of Transmission Queues scheduled
+    int numberPdus = 0;                     //Number of MAC PDUs taken, in subframeMacPdus and subframeMacAddresses
+    vector<bool> retransmitted(numberQueues, false);    //Destinations that get a HARQ retransmission in this subframe
+    RbAllocator rbAllocator(verbose);       //RBs of the subframe still idle
+
+    //BS transmits only in RBs idle according to spectrum sensing; UE transmits in the reservation given by BS
+    if(flagBS)
+        fillSpectrumAvailability(rbAllocator);
+
+    //Lock all queues, so PDUs do not grow between decision and sealing
+    for(int index=0;index<numberQueues;index++)
+        queueLocks.push_back(unique_lock<mutex>(queueMutexes[index]));
+
+    //Uplink control: BS grants RBs to UEs, UE reports its buffers; SDUs are added before PDUs are measured, so they go in this subframe
+    if(flagBS)
+        sendUplinkGrants();
+    else
+        sendBufferStatusReport();
+
+    //ARQ status reports to sources of PDUs received
+    for(int index=0;index<numberQueues;index++){
+        vector<uint8_t> statusReport;   //Status report MACC SDU
+        if(arq->getStatusReport(index, statusReport) && enqueueSchedulerControlSdu(index, statusReport))
+            arq->confirmStatusReport(index);
+    }
+
+    //HARQ retransmissions go first, with the same size; BS places them before RBs are given to new data.
+    //Transport blocks kept by HARQ and ARQ are sent again by handle, without copying them
+    for(int index=0;index<numberQueues;index++){
+        PooledMacPdu macPdu;                                    //Handle of transport block NACKed
+        int process = harq->getRetransmission(index, macPdu);   //HARQ process of transport block
+        if(process==-1)
+            continue;
+
+        if(flagBS){
+            int firstRb = rbAllocator.allocate(macPdu->allocation_.number_of_rb, macPdu->allocation_.first_rb);
+            if(firstRb==-1)
+                continue;
+            macPdu->allocation_.first_rb = firstRb;
+        }
+        harq->confirmRetransmission(index, process, macPdu->allocation_);
+        subframeMacAddresses[numberPdus] = mux->getDestinationMac(index);
+        subframeMacPdus[numberPdus++] = move(macPdu);
+        retransmitted[index] = true;
+    }
+
+    //Then ARQ retransmissions of PDUs NACKed by the receiver, as new transport blocks
+    for(int index=0;index<numberQueues;index++){
+        if(retransmitted[index] || !harq->hasIdleProcess(index))
+            continue;
+        PooledMacPdu macPdu;                                            //Handle of PDU reported missing
+        int sequenceNumber = arq->getRetransmission(index, macPdu);     //ARQ sequence number of PDU
+        if(sequenceNumber==-1)
+            continue;
+
+        if(flagBS){
+            int firstRb = rbAllocator.allocate(macPdu->allocation_.number_of_rb, macPdu->allocation_.first_rb);
+            if(firstRb==-1)
+                continue;
+            macPdu->allocation_.first_rb = firstRb;
+        }
+        arq->confirmRetransmission(index, sequenceNumber);
+        harq->startTransmission(index, macPdu);
+        subframeMacAddresses[numberPdus] = mux->getDestinationMac(index);
+        subframeMacPdus[numberPdus++] = move(macPdu);
+        retransmitted[index] = true;
+    }
+
+    //Gather backlogged destinations; new data waits while destination has no idle HARQ process or its ARQ window is full
+    for(int index=0;index<numberQueues;index++){
+        if(retransmitted[index] || !harq->hasIdleProcess(index) || !arq->isWindowOpen(index))
+            continue;
+        ssize_t numberBytes = mux->getNextPduSize(index);
+        if(numberBytes==0)
+            continue;
+
+        SchedulingCandidate candidate;
+        candidate.index = index;
+        candidate.bytesPerRb = calculateBytesPerRb(mux->getDestinationMac(index));
+        candidate.averageThroughput = averageThroughputs[index];
+        candidate.requiredRbs = calculateRequiredRbs(mux->getDestinationMac(index), numberBytes);
+        candidate.allocatedRbs = 0;
+        candidates.push_back(candidate);
+    }
+
+    //Policy picks destinations that transmit and RBs each one gets
+    schedulingPolicy->allocate(candidates, rbAllocator.getNumberIdleRbs());
+
+    //Seal PDU being filled if there is no sealed PDU waiting, then take it; candidates are in priority order
+    for(size_t i=0;i<candidates.size();i++){
+        if(candidates[i].allocatedRbs==0)
+            continue;
+        int index = candidates[i].index;
+        uint8_t macAddress = mux->getDestinationMac(index);
+
+        //Without a free MAC PDU object, destination waits for a later subframe
+        PooledMacPdu macPdu = macPduPool->getMacPdu();
+        if(!macPdu)
+            break;
+
+        //BS places transport block in idle RBs, preferably in UE reservation; if no idle run fits, PDU waits for a later subframe
+        int firstRb = -1;
+        if(flagBS){
+            allocation_cfg_t allocation;    //Resources reserved to UE
+            mimo_cfg_t mimo;                //MIMO configuration
+            getTransmissionConfiguration(macAddress, allocation, mimo);
+            firstRb = rbAllocator.allocate(candidates[i].allocatedRbs, allocation.first_rb);
+            if(firstRb==-1)
+                continue;
+        }
 
-    //Communication infinite loop
+        if(!mux->hasSealedPdu(index))
+            mux->sealPdu(index);
+        servedBytes[index] = getMacPdu(*macPdu, macAddress);
+        if(flagBS)
+            macPdu->allocation_.first_rb = firstRb;
+        arq->startTransmission(index, macPdu);
+        harq->startTransmission(index, macPdu);
+        subframeMacAddresses[numberPdus] = macAddress;
+        subframeMacPdus[numberPdus++] = move(macPdu);
+        indexes.push_back(index);
+    }
+
+    //Every destination has its average throughput updated, served or not
+    for(int index=0;index<numberQueues;index++)
+        SchedulingPolicy::updateAverageThroughput(averageThroughputs[index], servedBytes[index]);
+
+    if(numberPdus==0)
+        return;
+
+    //Take L1 sending lock before releasing queue locks, so PDUs of the same destination keep their order
+    lock_guard<mutex> l1Lock(l1SendMutex);
+    queueLocks.clear();
+    for(size_t i=0;i<indexes.size();i++)
+        queueConditionVariables[indexes[i]].notify_all();
+
+    //All PDUs taken were placed in non-overlapping RBs: mark first and last transport blocks and send them in one subframe
+    for(int i=0;i<numberPdus;i++){
+        subframeMacPdus[i]->macphy_ctl_.first_tb_in_subframe = (i==0);
+        subframeMacPdus[i]->macphy_ctl_.last_tb_in_subframe = (i==numberPdus-1);
+    }
+    sendSubframe(subframeMacPdus, subframeMacAddresses, numberPdus);
+}
+
+void
+MacController::timers(){
+    chrono::steady_clock::time_point nextTick = chrono::steady_clock::now();  //Instant of next tick
+
+    //Wheel ticks once per subframe, since MAC timeouts are configured in subframes
     while(currentMacMode!=STOP_MODE){
-        //Lock mutex one time to read
-        unique_lock<mutex> lk(queueMutex);
-        
-        //If there's no timeout OR the PDU is empty, no transmission is necessary
-        if(queueConditionVariables[index].wait_for(lk, timeout)==cv_status::no_timeout || mux->emptyPdu(flagBS? currentParameters->getMacAddress(index):0)) 
-            continue; 
-
-        //Else, perform PDU transmission only in IDLE mode
-        if(currentMacMode==IDLE_MODE){
-            if(verbose) cout<<"[MacController] Timeout!"<<endl;
-            sendPdu(flagBS? currentParameters->getMacAddress(index) : 0);
+        nextTick += getSubframeDuration();
+        this_thread::sleep_until(nextTick);
+
+        //Time is counted only in IDLE mode, as subframes are
+        if(currentMacMode!=IDLE_MODE){
+            nextTick = chrono::steady_clock::now();
+            continue;
         }
+
+        timerWheel->advance();
+    }
+    if(verbose) cout<<"[MacController] Timer wheel entering STOP_MODE."<<endl;
+}
+
+void
+MacController::sendDynamicParameters(
+    int index)      //Index of UE
+{
+    vector<uint8_t> dynamicParametersBytes;     //Serialized dynamic parameters of UE
+    uint8_t macAddress = currentParameters->getMacAddress(index);
+
+    cliL2Interface->dynamicParameters->serialize(macAddress, dynamicParametersBytes);
+    protocolControl->enqueueControlSdus(&(dynamicParametersBytes[0]), dynamicParametersBytes.size(), macAddress);
+
+    //Wait for ACK; a zero timeout still waits one subframe
+    lock_guard<mutex> lk(timerHandlesMutex);
+    timerWheel->cancel(ackTimers[index]);
+    ackTimers[index] = timerWheel->arm(currentParameters->getACKWaitTimeout(), [this, index](){ ackTimeout(index); });
+}
+
+void
+MacController::acknowledgeDynamicParameters(
+    uint8_t macAddress)     //Source MAC Address of ACK
+{
+    int index = currentParameters->getIndex(macAddress);
+    if(index==-1 || index>=currentParameters->getNumberUEs())
+        return;
+
+    lock_guard<mutex> lk(timerHandlesMutex);
+    timerWheel->cancel(ackTimers[index]);
+}
+
+void
+MacController::ackTimeout(
+    int index)      //Index of UE
+{
+    {
+        lock_guard<mutex> lk(timerHandlesMutex);
+        ackTimers[index] = INVALID_TIMER;
+    }
+
+    if(ackRetries[index]==MAXIMUM_ACK_RETRIES){
+        if(verbose) cout<<"[MacController] UE "<<(int)currentParameters->getMacAddress(index)<<" did not acknowledge dynamic parameters."<<endl;
+        return;
     }
+
+    ackRetries[index]++;
+    if(verbose) cout<<"[MacController] ACK timeout: resending dynamic parameters to UE "<<(int)currentParameters->getMacAddress(index)<<"."<<endl;
+    sendDynamicParameters(index);
+}
+
+void
+MacController::restartSsReportTimer(
+    int index)      //Index of UE
+{
+    //RxMetrics are expected every RxMetrics period; timeout counts from then
+    uint64_t numberSubframes = currentParameters->getRxMetricsPeriodicity()+currentParameters->getSSReportWaitTimeout();
+
+    lock_guard<mutex> lk(timerHandlesMutex);
+    timerWheel->cancel(ssReportTimers[index]);
+    ssReportTimers[index] = timerWheel->arm(numberSubframes, [this, index](){ ssReportTimeout(index); });
+}
+
+void
+MacController::ssReportTimeout(
+    int index)      //Index of UE
+{
+    if(verbose) cout<<"[MacController] SS report timeout: UE "<<(int)currentParameters->getMacAddress(index)<<" did not send RxMetrics."<<endl;
+
+    //Stale CQI is not used anymore; last spectrum sensing report is kept, so RBs with incumbents stay blocked
+    rxMetrics[index].accessControl.lock();
+    rxMetrics[index].cqiReport = NO_CQI_REPORT;
+    rxMetrics[index].accessControl.unlock();
+
+    //PDUs to UE are sized with configured Downlink MCS again
+    int queueIndex = mux->getTransmissionQueueIndex(currentParameters->getMacAddress(index));
+    if(queueIndex!=-1)
+        updatePduSize(queueIndex);
+
+    restartSsReportTimer(index);
 }
 
 uint8_t 
-MacController::decoding()
+MacController::decoding(
+    bool & crcError)    //Set to true if PDU was dropped due to CRC error
 {
     uint8_t macAddress;                     //Source MAC address
-    char buffer[MAXIMUM_BUFFER_LENGTH];     //Buffer to store message incoming
+    char buffer[MAXIMUM_PDU_LENGTH+CRC_LENGTH];     //Buffer to store message incoming
 
     //Clear buffer
     bzero(buffer,sizeof(buffer));
+    crcError = false;
 
     //Read packet from Socket
-    ssize_t numberDecodingBytes = receptionProtocol->receivePackageFromL1(buffer, MAXIMUM_BUFFER_LENGTH, macAddress);
-
-    //Error checking
-    if(numberDecodingBytes==-1 && verbose){ 
-        cout<<"[MacController] Error reading from socket."<<endl;
-        return 0;
-    }
+    ssize_t numberDecodingBytes = receptionProtocol->receivePackageFromL1(buffer, sizeof(buffer), macAddress);
 
-    //CRC checking
-    if(numberDecodingBytes==-2 && verbose){ 
-        cout<<"[MacController] Drop packet due to CRC Error."<<endl;
+    //CRC checking: error is fed back to transmitter as HARQ NACK
+    if(numberDecodingBytes==-2){ 
+        if(verbose) cout<<"[MacController] Drop packet due to CRC Error."<<endl;
+        crcError = true;
         return 0;
     }
 
-    //EOF checking
-    if(numberDecodingBytes==0 && verbose){ 
-        cout<<"[MacController] End of Transmission."<<endl;
+    //Error checking: reception failed or PDU cannot hold a MAC header
+    if(numberDecodingBytes<MAC_HEADER_LENGTH){ 
+        if(verbose) cout<<"[MacController] Error reading PDU from L1."<<endl;
         return 0;
     }
 
@@ -450,71 +1073,221 @@ MacController::decoding()
     
     if(verbose) cout<<"[MacController] Decoding MAC Address "<<(int)macAddress<<": in progress..."<<endl;
 
+    //ARQ reorders PDUs of each source, decoding them once and in sequence
+    arq->receivePdu(mux->getTransmissionQueueIndex(macAddress), buffer, numberDecodingBytes);
+
+    //If it is UE, increase subframeCounter
+    if(!flagBS){    
+        subframeCounter++;
+        if(subframeCounter==cliL2Interface->dynamicParameters->getRxMetricsPeriodicity()){
+            rxMetricsReport();
+            subframeCounter = 0;
+        }
+    }
+    
+    return macAddress;
+}
+
+void
+MacController::decodePdu(
+    int index,                  //Index of source
+    vector<uint8_t> & pdu)      //PDU delivered in sequence
+{
+    char buffer[MAXIMUM_PDU_LENGTH+CRC_LENGTH];     //Buffer where SDUs are copied
+    ssize_t numberDecodingBytes;                    //Size of SDU decoded
+
+    //PDUs lost: segments received next do not belong to SDUs in reassembly
+    if(pdu.empty()){
+        if(index!=-1) sduReassembler->dropIncomplete(mux->getDestinationMac(index));
+        return;
+    }
+    uint8_t macAddress = (pdu[0]>>4)&15;            //Source MAC address
+
     //Create ProtocolPackage object to help removing Mac Header
-    ProtocolPackage pdu(buffer, numberDecodingBytes , verbose);
-    pdu.removeMacHeader();
+    ProtocolPackage protocolPackage((char*) &(pdu[0]), pdu.size(), verbose);
+    protocolPackage.removeMacHeader();
 
     //Create TransmissionQueue object to help unstacking SDUs contained in the PDU
-    TransmissionQueue *transmissionQueue = pdu.getMultiplexedSDUs();
+    TransmissionQueue *transmissionQueue = protocolPackage.getMultiplexedSDUs();
+    char* sdu;      //Complete SDU, after reassembly of its segments
     while((numberDecodingBytes = transmissionQueue->getSDU(buffer))>0){
+        //Reassemble segments; only complete SDUs are decoded
+        numberDecodingBytes = sduReassembler->addSegment(buffer, numberDecodingBytes, transmissionQueue->getCurrentDataControlFlag(), 
+                                                         transmissionQueue->getCurrentSegmentationInfo(), macAddress, sdu);
+        if(numberDecodingBytes==0)
+            continue;
+
         //Test if it is Control SDU
         if(transmissionQueue->getCurrentDataControlFlag()==0)
-            protocolControl->decodeControlSdus(buffer, numberDecodingBytes, macAddress);
+            protocolControl->decodeControlSdus(sdu, numberDecodingBytes, macAddress);
         else    //Data SDU
-            protocolData->decodeDataSdus(buffer, numberDecodingBytes);
+            protocolData->decodeDataSdus(sdu, numberDecodingBytes);
     }
     delete transmissionQueue;
+}
 
-    //If it is UE, increase subframeCounter
-    if(!flagBS){    
-        subframeCounter++;
-        if(subframeCounter==cliL2Interface->dynamicParameters->getRxMetricsPeriodicity()){
-            rxMetricsReport();
-            subframeCounter = 0;
+void
+MacController::sendHarqFeedback(
+    uint8_t ueId,               //MAC Address of UE
+    uint8_t sequenceNumber,     //macphyctl_t::sequence_number of transport block
+    bool ack)                   //ACK/NACK flag
+{
+    //Transport blocks sent without HARQ are not acknowledged
+    if((sequenceNumber&HARQ_PROCESS_NONE)==HARQ_PROCESS_NONE)
+        return;
+
+    HarqFeedback feedback;                  //Message parameters structure
+    vector<uint8_t> messageParametersBytes; //Vector to receive serialized parameters structure
+    feedback.ueId = ueId;
+    feedback.harqProcess = sequenceNumber&HARQ_PROCESS_NONE;
+    feedback.ack = ack? 1:0;
+    feedback.serialize(messageParametersBytes);
+
+    string message = "HarqFeedback";
+    for(uint i=0;i<messageParametersBytes.size();i++)
+        message+=messageParametersBytes[i];
+
+    lock_guard<mutex> l1Lock(l1SendMutex);
+    protocolControl->sendInterlayerMessages(&message[0], message.size());
+}
+
+uint8_t
+MacController::getTransmissionConfiguration(
+    uint8_t macAddress,             //Destination MAC Address
+    allocation_cfg_t & allocation,  //Allocation of resources reserved to UE
+    mimo_cfg_t & mimo)              //MIMO configuration
+{
+    //BS transmits to UE with its Downlink MCS; UE transmits to BS with its own Uplink MCS and reservation
+    uint8_t ueMacAddress = flagBS? macAddress:currentParameters->getMacAddress(0);
+    uint8_t mcs = flagBS? currentParameters->getMcsDownlink(ueMacAddress):currentParameters->getMcsUplink(ueMacAddress);
+    allocation = currentParameters->getUlReservation(ueMacAddress);
+
+    //On BS, Downlink MCS follows last CQI reported by UE, if there is one; ranking, RB count, PDU size and transport block all use it
+    if(flagBS){
+        int index = currentParameters->getIndex(ueMacAddress);
+        if(index!=-1){
+            //CQI is written by control reception and by SS report timeout, in other threads
+            rxMetrics[index].accessControl.lock();
+            uint8_t cqiReport = rxMetrics[index].cqiReport;
+            rxMetrics[index].accessControl.unlock();
+            if(cqiReport!=NO_CQI_REPORT)
+                mcs = AdaptiveModulationCoding::getCqiConvertToMcs(cqiReport);
         }
     }
-    
-    return macAddress;
+
+    //MIMO Configuration
+    mimo.scheme = currentParameters->getMimoConf(macAddress)==0? NONE:(currentParameters->getMimoDiversityMultiplexing(macAddress)==0? DIVERSITY:MULTIPLEXING);
+    mimo.num_tx_antenas = currentParameters->getMimoAntenna(macAddress)==0? 2:4;
+    mimo.precoding_mtx = currentParameters->getMimoPrecoding(macAddress);
+
+    return mcs;
+}
+
+uint16_t
+MacController::calculatePduCapacity(
+    uint8_t macAddress)     //Destination MAC Address
+{
+    allocation_cfg_t allocation;    //Resources reserved to UE
+    mimo_cfg_t mimo;                //MIMO configuration
+    uint8_t mcs = getTransmissionConfiguration(macAddress, allocation, mimo);
+
+    //Limit to PDU buffers size
+    size_t numberBytes = calculateTransportBlockBytes(allocation, mimo, mcs);
+    return numberBytes>MAXIMUM_PDU_LENGTH? MAXIMUM_PDU_LENGTH:numberBytes;
+}
+
+size_t
+MacController::calculateTransportBlockBytes(
+    const allocation_cfg_t & allocation,    //Resources of transport block
+    const mimo_cfg_t & mimo,                //MIMO configuration
+    uint8_t mcs)                            //Modulation and Coding Scheme
+{
+    //Information bits are the coded bits capacity of the whole allocation scaled by code rate
+    size_t numberBits = get_bit_capacity(currentParameters->getNumerology(), allocation, mimo, AdaptiveModulationCoding::getMcsConvertToModulation(mcs));
+    size_t numberBytes = (size_t)(numberBits*AdaptiveModulationCoding::getMcsConvertToCodeRate(mcs))/8;
+
+    //Discount CRC appended to PDU
+    return numberBytes>CRC_LENGTH? numberBytes-CRC_LENGTH:0;
+}
+
+uint8_t
+MacController::getPduTransmissionConfiguration(
+    uint8_t macAddress,             //Destination MAC Address
+    size_t numberBytes,             //Number of bytes of PDU, CRC excluded
+    allocation_cfg_t & allocation,  //Allocation of resources reserved to UE
+    mimo_cfg_t & mimo)              //MIMO configuration
+{
+    uint8_t mcs = getTransmissionConfiguration(macAddress, allocation, mimo);
+
+    //PDU sized before a lower CQI (or a smaller grant) does not fit reservation with current MCS: it is sent with the lowest
+    //MCS that carries it, which is at most the one it was sized with, so transport block is never smaller than PDU
+    while(mcs<NUMBER_MCS-1 && calculateTransportBlockBytes(allocation, mimo, mcs)<numberBytes)
+        mcs++;
+    return mcs;
+}
+
+void
+MacController::updatePduSizes(){
+    for(int i=0;i<mux->getNumberTransmissionQueues();i++)
+        updatePduSize(i);
+}
+
+void
+MacController::updatePduSize(
+    int index)      //Index of Transmission Queue
+{
+    lock_guard<mutex> lk(queueMutexes[index]);
+    setPduSize(index);
+}
+
+void
+MacController::setPduSize(
+    int index)      //Index of Transmission Queue
+{
+    uint16_t capacity = calculatePduCapacity(mux->getDestinationMac(index));   //New maximum PDU size
+
+    //PDU filled at the old size is sealed before size goes down; if a sealed PDU is already waiting, PDU being filled
+    //takes no SDU beyond the new size, so it is sealed as soon as the scheduler takes the other one
+    if(capacity<mux->getMaxNumberBytes(index) && !mux->hasSealedPdu(index) && mux->sealPdu(index) && verbose)
+        cout<<"[MacController] PDU to MAC "<<(int)mux->getDestinationMac(index)<<" sealed before its size goes down."<<endl;
+    mux->setMaxNumberBytes(index, capacity);
 }
 
 void
 MacController::setMacPduStaticInformation(
+    MacPDU & macPDU,            //MAC PDU object to be filled
     size_t numberBytes,         //Number of Data Bytes in the PDU
     uint8_t macAddress)         //Destination MAC Address
 {
-    //Static information:
-    unsigned numerologyID = 2;                  //Numerology identification
-    float codeRate = 3/4;                       //Core rate used in codification
-
     //Define Structures
     mimo_cfg_t mimoConfiguration;               //MIMO configuration structure
     mcs_cfg_t mcsConfiguration;                 //Modulation Coding Scheme configuration
     allocation_cfg_t allocationConfiguration;   //Resource allocation configuration
     macphyctl_t macPhyControl;                  //MAC-PHY control structure
 
-    //MIMO Configuration
-    mimoConfiguration.scheme = currentParameters->getMimoConf(macAddress)==0? NONE:(currentParameters->getMimoDiversityMultiplexing(macAddress)==0? DIVERSITY:MULTIPLEXING);
-    mimoConfiguration.num_tx_antenas = currentParameters->getMimoAntenna(macAddress)==0? 2:4;
-    mimoConfiguration.precoding_mtx = currentParameters->getMimoPrecoding(macAddress);
+    //Current configuration of destination: numerology, allocation, MIMO and MCS
+    unsigned numerologyID = currentParameters->getNumerology();     //Numerology identification
+    uint8_t mcs = getPduTransmissionConfiguration(macAddress, numberBytes, allocationConfiguration, mimoConfiguration);
+    float codeRate = AdaptiveModulationCoding::getMcsConvertToCodeRate(mcs);   //Code rate used in codification
 
     //MCS Configuration
-    mcsConfiguration.num_info_bytes = currentParameters->getMTU();
-    mcsConfiguration.num_coded_bytes = currentParameters->getMTU()/codeRate;
-    mcsConfiguration.modulation = QAM64;
+    mcsConfiguration.num_info_bytes = numberBytes;
+    mcsConfiguration.num_coded_bytes = numberBytes/codeRate;
+    mcsConfiguration.modulation = AdaptiveModulationCoding::getMcsConvertToModulation(mcs);
     mcsConfiguration.power_offset = currentParameters->getTPC(macAddress);
 
-    //Resource allocation configuration
-    allocationConfiguration.first_rb = 0;
-    allocationConfiguration.number_of_rb = get_num_required_rb(numerologyID, mimoConfiguration, mcsConfiguration.modulation, codeRate, numberBytes*8);
+    //Resource allocation configuration: PDU uses only RBs it needs from the reservation
+    allocationConfiguration.number_of_rb = calculateRequiredRbs(macAddress, numberBytes);
     allocationConfiguration.target_ue_id = macAddress;
 
     //MAC-PHY Control
     macPhyControl.first_tb_in_subframe = true;
     macPhyControl.last_tb_in_subframe = true;
-    macPhyControl.sequence_number = 1;
+    macPhyControl.sequence_number = HARQ_PROCESS_NONE;  //Set by HARQ entity when transport block is assigned to a process
     macPhyControl.subframe_number = 3;
 
     //MAC PDU object definition
+    macPDU.numID_ = numerologyID;
     macPDU.allocation_ = allocationConfiguration;
     macPDU.mimo_ = mimoConfiguration;
     macPDU.mcs_ = mcsConfiguration;
@@ -538,6 +1311,7 @@ MacController::managerDynamicParameters(
 
     //Now, turn MAC into RECONFIG_MODE to reconfigure static parameters
     currentMacMode = RECONFIG_MODE;
+    macHigh->notifyModeChange();
 }
 
 void 
@@ -9,15 +9,20 @@
 
 #include <iostream>             //std::cout
 #include <future>               //std::async, std::future
+#include <thread>               //std::this_thread::sleep_until()
 #include <chrono>               //std::chrono::milliseconds
 #include <mutex>                //std::mutex
 #include <condition_variable>   //std::condition_variable
+#include <vector>               //std::vector
+#include <pthread.h>            //pthread_setaffinity_np()
+#include <sched.h>              //cpu_set_t, CPU_ZERO(), CPU_SET()
 
 #include "../ProtocolData/MacHighQueue.h"
 #include "../ProtocolPackage/ProtocolPackage.h"
 #include "../Multiplexer/MacAddressTable/MacAddressTable.h"
 #include "../Multiplexer/TransmissionQueue.h"
 #include "../Multiplexer/Multiplexer.h"
+#include "../Multiplexer/SduReassembler.h"
 #include "../ReceptionProtocol/ReceptionProtocol.h"
 #include "../TransmissionProtocol/TransmissionProtocol.h"
 #include "../ProtocolControl/MacCtHeader.h"
@@ -27,6 +32,14 @@
 #include "../../common/libMac5gRange/libMac5gRange.h"
 #include "../SystemParameters/CurrentParameters.h"
 #include "../CLIL2Interface/CLIL2Interface.h"
+#include "../AdaptiveModulationCoding/AdaptiveModulationCoding.h"
+#include "../Scheduler/SchedulingPolicy.h"
+#include "../Scheduler/RbAllocator.h"
+#include "../Scheduler/UplinkScheduler.h"
+#include "../TimerWheel/TimerWheel.h"
+#include "../Harq/HarqEntity.h"
+#include "../Arq/ArqEntity.h"
+#include "../MacPduPool/MacPduPool.h"
 
 using namespace std;
 
@@ -35,6 +48,9 @@ using namespace std;
 #define SRC_OFFSET 12                   //IP packet source address offset in bytes 
 #define DST_OFFSET 16                   //IP packet destination address offset in bytes
 #define TIMEOUT_DYNAMIC_PARAMETERS 5    //Timeout(seconds) to check for dynamic parameters alterations
+#define NO_CQI_REPORT 255               //CQI of UEs that did not report RxMetrics yet
+#define SEALED_PDU_WAIT_TIMEOUT 100     //Maximum time(ms) a thread blocks waiting for scheduler to take a sealed PDU before reevaluating MAC mode
+#define MAXIMUM_ACK_RETRIES 3           //Number of times dynamic parameters are resent to a UE that does not acknowledge them
 
 
 //Initializing classes that will be defined in other .h files
@@ -55,19 +71,37 @@ private:
     uint8_t currentMacAddress;              //MAC Address of current equipment
     const char* deviceNameTun;              //TUN device name
     TunInterface* tunInterface;             //TunInterface object to perform L3 packet capture
+    int numberTunQueues;                    //Number of TUN queues, each one read by its own thread
+    vector<int> tunCores;                   //CPU cores where TUN reading threads are pinned (empty for no pinning)
     MacHighQueue* macHigh;                  //Queue to receive and enqueue L3 packets
     MacAddressTable* ipMacTable;            //Table to associate IP addresses to 5G-RANGE domain MAC addresses
 	ProtocolData* protocolData;             //Object to deal with enqueueing DATA SDUS
     ProtocolControl* protocolControl;       //Object to deal with enqueueing CONTROL SDUS
 	thread *threads;                        //Threads array
-    MacPDU macPDU;                          //Object MacPDU containing all information that will be sent to PHY
     unsigned int subframeCounter;           //Subframe counter used for RxMetrics reporting to BS.
+    SchedulingPolicies schedulingPolicyType;    //Scheduling policy used by scheduler
+    SchedulingPolicy* schedulingPolicy;     //Policy that splits RBs of each subframe among destinations
+    InterlayerTransports interlayerTransportType;   //Transport used to exchange messages with L1
+    macpdu_wire_format_t pduWireFormat;     //Format in which PDUs are serialized to L1
+    MacPduPool* macPduPool;                 //Preallocated MAC PDU objects passed by handle from scheduler to L1L2Interface
+    PooledMacPdu* subframeMacPdus;          //[Scheduler] MAC PDUs of the subframe being scheduled; one per destination at most
+    uint8_t* subframeMacAddresses;          //[Scheduler] Destination MAC Address of each PDU of the subframe
+    unsigned long numberMissedSubframes;    //[Scheduler] Subframes skipped because scheduler woke up more than a subframe late
+    double* averageThroughputs;             //Moving average of bytes per subframe transmitted to each destination (same indexes of Transmission Queues)
+    vector<uint8_t> lastBufferStatusReport; //[UE] Last BSR enqueued to BS
+    unsigned int bsrSubframeCounter;        //[UE] Subframes since last BSR was enqueued
+    TimerHandle* ackTimers;                 //[BS] Timer waiting for ACK of dynamic parameters sent to each UE
+    int* ackRetries;                        //[BS] Number of times dynamic parameters were resent to each UE
+    TimerHandle* ssReportTimers;            //[BS] Timer waiting for RxMetrics (and SS report) of each UE
+    mutex timerHandlesMutex;                //Mutex to control access to timer handles
     bool verbose;                           //Verbosity flag
 
 public:
-    condition_variable* queueConditionVariables;    //Condition variables to manage access to Multiplexer Queues
-    mutex queueMutex;               //Mutex to control access to Transmission Queue
+    condition_variable* queueConditionVariables;    //Condition variables notified when scheduler takes sealed PDU of each Multiplexer Queue
+    mutex* queueMutexes;            //Mutexes to control access to each Transmission Queue (same indexes of condition variables)
+    mutex l1SendMutex;              //Mutex to keep SubframeTx.Start, PDU and SubframeTx.End messages to L1 together
 	Multiplexer* mux;               //Multiplexes various SDUs to multiple destinations
+    SduReassembler* sduReassembler; //Rebuilds segmented SDUs received from L1
     bool flagBS;                    //BaseStation flag: 1 for BS; 0 for UE
     ReceptionProtocol* receptionProtocol;           //Object to receive packets from L1 and L3
     TransmissionProtocol* transmissionProtocol;     //Object to transmit packets to L1 and L3
@@ -75,6 +109,10 @@ public:
     CurrentParameters* currentParameters;           //Object with static/default parameters read from a file
     CLIL2Interface* cliL2Interface;             //Object to configure dynamic parameters 
     RxMetrics* rxMetrics;                           //Array of Reception Metrics for each UE
+    UplinkScheduler* uplinkScheduler;               //[BS] Resizes uplink reservations from UEs buffer status reports; NULL on UE
+    TimerWheel* timerWheel;                         //Timer wheel where all MAC timeouts are armed, ticking once per subframe
+    HarqEntity* harq;                               //HARQ processes of each destination, keeping transport blocks until L1 reports ACK
+    ArqEntity* arq;                                 //Selective-repeat ARQ of each destination, above HARQ, delivering PDUs received in sequence
     
     /**
      * @brief Initializes a MacController object to manage all 5G RANGE MAC Operations
@@ -82,12 +120,39 @@ public:
      * @param _verbose Verbosity flag
      */
     MacController(const char* _deviceNameTun, bool _verbose);
+
+    /**
+     * @brief Initializes a MacController object reading L3 packets from a multi-queue TUN Interface
+     * @param _deviceNameTun Customized name for TUN Interface
+     * @param _numberTunQueues Number of TUN queues (and reading threads)
+     * @param _tunCores CPU cores where TUN reading threads are pinned, assigned in round-robin; empty for no pinning
+     * @param _verbose Verbosity flag
+     */
+    MacController(const char* _deviceNameTun, int _numberTunQueues, const vector<int> & _tunCores, bool _verbose);
     
     /**
      * @brief Destructs MacController object
      */
     ~MacController();
 
+    /**
+     * @brief Sets scheduling policy; it must be called before initialize()
+     * @param policy Scheduling policy
+     */
+    void setSchedulingPolicy(SchedulingPolicies policy);
+
+    /**
+     * @brief Sets transport used to exchange messages with L1; it must be called before initialize()
+     * @param transport UDP sockets or shared memory rings; L1 must use the same
+     */
+    void setInterlayerTransport(InterlayerTransports transport);
+
+    /**
+     * @brief Sets format in which PDUs are serialized to L1; it must be called before initialize()
+     * @param format Flat format, or legacy format for PHYs that do not parse the flat one
+     */
+    void setPduWireFormat(macpdu_wire_format_t format);
+
     /**
      * @brief Initializes MAC System in STANDBY_MODE
      */
@@ -106,28 +171,242 @@ public:
     /**
      * @brief Performs PDU sending to destination identified by macAddress
      * @param macAddress MAC Address of destination
+     * @returns True if PDU was sent; false if it waits for an idle HARQ process, ARQ window or MAC PDU object
+     */
+    bool sendPdu(uint8_t macAddress);
+
+    /**
+     * @brief Performs PDU sending to destination identified by macAddress, whose Transmission Queue is already locked
+     * PDU is taken from Multiplexer under the queue lock, which is released before L1 sending, so enqueueing is not blocked by L1.
+     * It is numbered by ARQ and kept by HARQ, as PDUs sent by scheduler are
+     * @param queueLock Lock held on the mutex of destination Transmission Queue; it is released on return
+     * @param macAddress MAC Address of destination
+     * @returns True if PDU was sent; false if it waits for an idle HARQ process, ARQ window or MAC PDU object
+     */
+    bool sendPdu(unique_lock<mutex> & queueLock, uint8_t macAddress);
+
+    /**
+     * @brief Takes PDU of a destination from Multiplexer and fills MAC PDU with its data, control data and static information
+     * Mutex of destination Transmission Queue must be locked
+     * @param macPdu MAC PDU object to be filled
+     * @param macAddress MAC Address of destination
+     * @returns Number of data bytes of PDU; 0 if there was no PDU
+     */
+    ssize_t getMacPdu(MacPDU & macPdu, uint8_t macAddress);
+
+    /**
+     * @brief [BS] Removes from availability the RBs occupied according to fusion LUT and to the spectrum sensing reports of all UEs
+     * An RB is idle only if no UE reported an incumbent on it and fusion LUT does not flag it
+     * @param rbAllocator Allocator of the RBs of the subframe
+     */
+    void fillSpectrumAvailability(RbAllocator & rbAllocator);
+
+    /**
+     * @brief Sends a subframe to L1: SubframeTx.Start message with the number of PDUs, the PDUs and SubframeTx.End message
+     * All messages go to L1 in a single batch. l1SendMutex must be held by caller. PDUs are given back to pool as they are serialized.
+     * @param macPdus MAC PDUs of the subframe
+     * @param macAddresses Destination MAC Address of each PDU
+     * @param numberPdus Number of PDUs
+     */
+    void sendSubframe(PooledMacPdu* macPdus, uint8_t* macAddresses, int numberPdus);
+
+    /**
+     * @brief Seals PDU of a destination, so its Transmission Queue can be filled again while PDU waits for next subframe
+     * If previous sealed PDU of this destination was not taken by scheduler yet, waits for it (never for L1 sending itself);
+     * outside IDLE_MODE, when scheduler does not run, previous sealed PDU is sent by calling thread instead
+     * @param queueLock Lock held on the mutex of destination Transmission Queue; it is still held on return
+     * @param index Index of destination Transmission Queue
+     * @returns True if PDU was sealed; false if there was nothing to seal or MAC is stopping
+     */
+    bool sealPdu(unique_lock<mutex> & queueLock, int index);
+
+    /**
+     * @brief Blocks until MAC mode changes or timeout expires; used by threads idle outside IDLE_MODE
+     * @param timeout Maximum waiting time in milliseconds
+     * @param seenModeChanges Number of mode changes already seen by calling thread; updated on return
+     */
+    void waitForModeChange(int timeout, uint64_t & seenModeChanges);
+
+    /**
+     * @brief Gets duration of a subframe (TTI) with current numerology
+     * @returns Subframe duration
+     */
+    chrono::microseconds getSubframeDuration();
+
+    /**
+     * @brief Calculates number of RBs a PDU needs with its transmission configuration (see getPduTransmissionConfiguration()), limited to destination reservation
+     * @param macAddress Destination MAC Address
+     * @param numberBytes Number of bytes of PDU
+     * @returns Number of RBs
+     */
+    size_t calculateRequiredRbs(uint8_t macAddress, size_t numberBytes);
+
+    /**
+     * @brief Procedure that executes until STOP mode, scheduling a subframe on each TTI
+     * It replaces per-destination timeout threads: latency of an SDU is bounded by the subframe duration.
+     * After a stall longer than a subframe, subframes missed are counted and skipped instead of scheduled back-to-back
+     */
+    void scheduler();
+
+    /**
+     * @brief Calculates number of bytes a single RB carries to a destination, with its current MCS
+     * @param macAddress Destination MAC Address
+     * @returns Bytes per RB
+     */
+    double calculateBytesPerRb(uint8_t macAddress);
+
+    /**
+     * @brief Adds a MACC SDU generated by scheduler to a Transmission Queue, sealing PDU being filled if it is full and there is no sealed PDU
+     * Mutex of Transmission Queue must be locked; scheduler never waits for a sealed PDU to be taken, since it is the one that takes it
+     * @param index Index of Transmission Queue
+     * @param sdu MACC SDU; it is never segmented, but added whole or not at all
+     * @returns True if SDU was enqueued; false if nothing was enqueued and it must be retried on next subframe
+     */
+    bool enqueueSchedulerControlSdu(int index, vector<uint8_t> & sdu);
+
+    /**
+     * @brief [UE] Enqueues a buffer status report to BS if bytes pending changed or BSR_PERIODICITY subframes elapsed
+     * Logical queues are the Transmission Queue to BS followed by each TUN queue; mutex of Transmission Queue must be locked
      */
-    void sendPdu(uint8_t macAddress);
+    void sendBufferStatusReport();
 
     /**
-     * @brief Procedure that controls timeout and triggers PDU sending
-     * @param index Index of MAC Addresses of equipments and Condition Variables Arrays
+     * @brief [BS] Calculates uplink grants of all UEs from their buffer status reports and enqueues grants that changed
+     * Mutexes of all Transmission Queues must be locked
      */
-    void timeoutController(int index);
+    void sendUplinkGrants();
 
     /**
-     * @brief Procedure that performs decoding of PDUs received from L1
-     * @param macAddress Source MAC Address from which packet will be received
+     * @brief Picks destinations that transmit in this subframe and the RBs each one gets, using scheduling policy, then seals and sends their PDUs
+     * Destinations not served transmit in a later subframe
+     */
+    void scheduleSubframe();
+
+    /**
+     * @brief [UE] Applies uplink grant received from BS: reservation is resized and PDUs are sized to it
+     * @param grant Uplink grant
+     */
+    void applyUplinkGrant(allocation_cfg_t grant);
+
+    /**
+     * @brief Procedure that executes until STOP mode, advancing timer wheel once per subframe
+     */
+    void timers();
+
+    /**
+     * @brief [BS] Enqueues dynamic parameters to a UE and arms timer waiting for its ACK
+     * @param index Index of UE
+     */
+    void sendDynamicParameters(int index);
+
+    /**
+     * @brief [BS] Cancels timer waiting for ACK of dynamic parameters
+     * @param macAddress Source MAC Address of ACK
+     */
+    void acknowledgeDynamicParameters(uint8_t macAddress);
+
+    /**
+     * @brief [BS] Called when a UE does not acknowledge dynamic parameters in time: they are resent up to MAXIMUM_ACK_RETRIES times
+     * @param index Index of UE
+     */
+    void ackTimeout(int index);
+
+    /**
+     * @brief [BS] Restarts timer waiting for next RxMetrics of a UE
+     * @param index Index of UE
+     */
+    void restartSsReportTimer(int index);
+
+    /**
+     * @brief [BS] Called when a UE does not send RxMetrics in time: its CQI report is discarded
+     * @param index Index of UE
+     */
+    void ssReportTimeout(int index);
+
+    /**
+     * @brief Procedure that performs decoding of PDUs received from L1, reassembling segmented SDUs
+     * @param crcError Variable set to true if PDU was dropped due to CRC error
      * @returns Source MAC Address
      */
-    uint8_t decoding();
+    uint8_t decoding(bool & crcError);
+
+    /**
+     * @brief Decodes a PDU delivered in sequence by ARQ, reassembling segmented SDUs and forwarding them to L3 or Protocol Control
+     * @param index Index of source; -1 if unknown
+     * @param pdu PDU, MAC header included; empty if PDUs of the source were lost, so SDUs in reassembly are dropped
+     */
+    void decodePdu(int index, vector<uint8_t> & pdu);
+
+    /**
+     * @brief Sends HarqFeedback message to L1, so it reports ACK/NACK of a transport block received to its transmitter
+     * @param ueId MAC Address of UE that transmitted the transport block (BS) or own MAC Address (UE)
+     * @param sequenceNumber macphyctl_t::sequence_number of transport block, reported by L1 in SubframeRx.Start
+     * @param ack True for ACK; false for NACK
+     */
+    void sendHarqFeedback(uint8_t ueId, uint8_t sequenceNumber, bool ack);
 
     /**
      * @brief Sets MAC PDU object with static information
+     * @param macPdu MAC PDU object to be filled
      * @param numberBytes Number of Data bytes to send
      * @param macAddress User equipment MAC Address (if it is sending or if is destination)
      */
-    void setMacPduStaticInformation(size_t numberBytes, uint8_t macAddress);
+    void setMacPduStaticInformation(MacPDU & macPdu, size_t numberBytes, uint8_t macAddress);
+
+    /**
+     * @brief Gets current transmission configuration to a destination: its allocation, MIMO configuration and MCS
+     * On BS, MCS is derived from last CQI reported by UE when there is one, else it is the configured Downlink MCS
+     * @param macAddress Destination MAC Address
+     * @param allocation Allocation structure to be filled with resources reserved to UE
+     * @param mimo MIMO configuration structure to be filled
+     * @returns Modulation and Coding Scheme
+     */
+    uint8_t getTransmissionConfiguration(uint8_t macAddress, allocation_cfg_t & allocation, mimo_cfg_t & mimo);
+
+    /**
+     * @brief Gets transmission configuration of a PDU to a destination: current configuration, with MCS raised to the lowest one
+     * whose transport block carries PDU in the reservation. Only PDUs filled before MCS or reservation went down need it
+     * @param macAddress Destination MAC Address
+     * @param numberBytes Number of bytes of PDU, CRC excluded
+     * @param allocation Allocation structure to be filled with resources reserved to UE
+     * @param mimo MIMO configuration structure to be filled
+     * @returns Modulation and Coding Scheme
+     */
+    uint8_t getPduTransmissionConfiguration(uint8_t macAddress, size_t numberBytes, allocation_cfg_t & allocation, mimo_cfg_t & mimo);
+
+    /**
+     * @brief Calculates number of MAC bytes that fit in a transport block, CRC excluded
+     * @param allocation Resources of transport block
+     * @param mimo MIMO configuration
+     * @param mcs Modulation and Coding Scheme
+     * @returns Number of bytes
+     */
+    size_t calculateTransportBlockBytes(const allocation_cfg_t & allocation, const mimo_cfg_t & mimo, uint8_t mcs);
+
+    /**
+     * @brief Calculates number of MAC bytes that fit in the transport block of a destination, with its current allocation, MCS, MIMO and numerology
+     * @param macAddress Destination MAC Address
+     * @returns Maximum PDU size in bytes, CRC excluded, limited to MAXIMUM_PDU_LENGTH
+     */
+    uint16_t calculatePduCapacity(uint8_t macAddress);
+
+    /**
+     * @brief Updates maximum PDU size of each destination in Multiplexer according to its transport block capacity
+     */
+    void updatePduSizes();
+
+    /**
+     * @brief Updates maximum PDU size of a destination in Multiplexer, e.g. when its MCS follows a new CQI report
+     * @param index Index of Transmission Queue; its mutex must not be locked by caller
+     */
+    void updatePduSize(int index);
+
+    /**
+     * @brief Sets maximum PDU size of a destination to its transport block capacity; when size goes down, PDU being filled
+     * at the old size is sealed first, so no SDU is added to it beyond the new size
+     * @param index Index of Transmission Queue; its mutex must be locked by caller
+     */
+    void setPduSize(int index);
 
     /**
      * @brief [UE] Receives bytes referring to Dynamic Parameters coming by MACC SDU and updates class with new information
@@ -0,0 +1,205 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+/**
+@Arquive name : MacPduPool.cpp
+@Classification : MAC PDU Pool
+@
+@Version : v1.0
+
+Project : H2020 5G-Range
+
+@Description : This module keeps a set of preallocated MAC PDU objects that
+    travel by handle from the scheduler to L1L2Interface and come back after
+    being sent or, when ARQ and HARQ share them for retransmission, after
+    their last handle is released.
+*/
+
+#include "MacPduPool.h"
+
+PooledMacPdu::PooledMacPdu(){
+    pool = NULL;
+    entry = NULL;
+}
+
+PooledMacPdu::PooledMacPdu(
+    MacPduPool* _pool,      //Pool that owns MAC PDU object
+    MacPduEntry* _entry)    //MAC PDU object
+{
+    pool = _pool;
+    entry = _entry;
+}
+
+PooledMacPdu::PooledMacPdu(
+    const PooledMacPdu & other)     //Handle shared
+{
+    pool = other.pool;
+    entry = other.entry;
+    if(entry!=NULL)
+        pool->addHandle(entry);
+}
+
+PooledMacPdu::PooledMacPdu(
+    PooledMacPdu && other) noexcept     //Handle moved
+{
+    pool = other.pool;
+    entry = other.entry;
+    other.pool = NULL;
+    other.entry = NULL;
+}
+
+PooledMacPdu &
+PooledMacPdu::operator=(
+    const PooledMacPdu & other)     //Handle shared
+{
+    //Count new handle first, so assigning a handle of the same object (or the handle itself) never releases it
+    MacPduPool* otherPool = other.pool;
+    MacPduEntry* otherEntry = other.entry;
+    if(otherEntry!=NULL)
+        otherPool->addHandle(otherEntry);
+    reset();
+    pool = otherPool;
+    entry = otherEntry;
+    return *this;
+}
+
+PooledMacPdu &
+PooledMacPdu::operator=(
+    PooledMacPdu && other) noexcept     //Handle moved
+{
+    if(this!=&other){
+        reset();
+        pool = other.pool;
+        entry = other.entry;
+        other.pool = NULL;
+        other.entry = NULL;
+    }
+    return *this;
+}
+
+PooledMacPdu::~PooledMacPdu(){
+    reset();
+}
+
+void
+PooledMacPdu::reset(){
+    if(entry!=NULL)
+        pool->releaseHandle(entry);
+    pool = NULL;
+    entry = NULL;
+}
+
+MacPDU*
+PooledMacPdu::get() const{
+    return entry!=NULL? &(entry->macPdu):NULL;
+}
+
+MacPDU*
+PooledMacPdu::operator->() const{
+    return &(entry->macPdu);
+}
+
+MacPDU &
+PooledMacPdu::operator*() const{
+    return entry->macPdu;
+}
+
+PooledMacPdu::operator bool() const{
+    return entry!=NULL;
+}
+
+MacPduPool::MacPduPool(
+    int initialNumberMacPdus,       //Number of MAC PDU objects allocated now
+    int _maximumNumberMacPdus,      //Number of MAC PDU objects pool may grow to
+    size_t _dataCapacity,           //Bytes reserved for data of each MAC PDU object
+    bool _verbose)                  //Verbosity flag
+{
+    maximumNumberMacPdus = _maximumNumberMacPdus<initialNumberMacPdus? initialNumberMacPdus:_maximumNumberMacPdus;
+    dataCapacity = _dataCapacity;
+    verbose = _verbose;
+
+    //Only pointers are reserved for the maximum; objects needed from the start are allocated and pushed to the free stack
+    entries = new MacPduEntry*[maximumNumberMacPdus];
+    freeEntries = new MacPduEntry*[maximumNumberMacPdus];
+    numberMacPdus = 0;
+    numberFreeMacPdus = 0;
+    while(numberMacPdus<initialNumberMacPdus)
+        grow();
+}
+
+MacPduPool::~MacPduPool(){
+    for(int i=0;i<numberMacPdus;i++)
+        delete entries[i];
+    delete [] entries;
+    delete [] freeEntries;
+}
+
+bool
+MacPduPool::grow(){
+    if(numberMacPdus==maximumNumberMacPdus)
+        return false;
+
+    MacPduEntry* entry = new MacPduEntry;
+    entry->macPdu.mac_data_.reserve(dataCapacity);
+    entry->macPdu.control_data_.reserve(MAC_PDU_CONTROL_CAPACITY);
+    entry->numberHandles = 0;
+    entries[numberMacPdus++] = entry;
+    freeEntries[numberFreeMacPdus++] = entry;
+
+    if(verbose) cout<<"[MacPduPool] Pool grew to "<<numberMacPdus<<" MAC PDUs."<<endl;
+    return true;
+}
+
+PooledMacPdu
+MacPduPool::getMacPdu(){
+    lock_guard<mutex> lk(poolMutex);
+    if(numberFreeMacPdus==0 && !grow()){
+        if(verbose) cout<<"[MacPduPool] No MAC PDUs available."<<endl;
+        return PooledMacPdu();
+    }
+    MacPduEntry* entry = freeEntries[--numberFreeMacPdus];
+    entry->numberHandles = 1;
+    return PooledMacPdu(this, entry);
+}
+
+void
+MacPduPool::addHandle(
+    MacPduEntry* entry)     //MAC PDU object
+{
+    entry->numberHandles.fetch_add(1, memory_order_relaxed);
+}
+
+void
+MacPduPool::releaseHandle(
+    MacPduEntry* entry)     //MAC PDU object
+{
+    //Object is still in use while other handles are alive; last holder sees all changes made through the others
+    if(entry->numberHandles.fetch_sub(1, memory_order_acq_rel)>1)
+        return;
+
+    //Restore default configuration; clearing vectors keeps their capacity
+    MacPDU* macPdu = &(entry->macPdu);
+    macPdu->numID_ = 0;
+    macPdu->macphy_ctl_ = macphyctl_t();
+    macPdu->allocation_ = allocation_cfg_t();
+    macPdu->mimo_ = mimo_cfg_t();
+    macPdu->mcs_ = mcs_cfg_t();
+    macPdu->mac_data_.clear();
+    macPdu->coded_data_.clear();
+    macPdu->symbols_.clear();
+    macPdu->control_data_.clear();
+    macPdu->control_symbols_.clear();
+    for(int i=0;i<4;i++)
+        macPdu->mimo_symbols_[i].clear();
+
+    lock_guard<mutex> lk(poolMutex);
+    freeEntries[numberFreeMacPdus++] = entry;
+}
+
+int
+MacPduPool::getNumberFreeMacPdus(){
+    lock_guard<mutex> lk(poolMutex);
+    return numberFreeMacPdus;
+}
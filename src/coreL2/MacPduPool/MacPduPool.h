@@ -0,0 +1,185 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+
+#ifndef INCLUDED_MAC_PDU_POOL_H
+#define INCLUDED_MAC_PDU_POOL_H
+
+#include <iostream>     //cout
+#include <mutex>        //std::mutex
+#include <atomic>       //std::atomic
+#include <stddef.h>     //size_t, NULL
+
+#include "../../common/lib5grange/lib5grange.h"
+
+using namespace std;
+using namespace lib5grange;
+
+#define MAC_PDUS_PER_DESTINATION 2      //Number of MAC PDU objects preallocated for each destination besides those retained by ARQ/HARQ: one scheduled, one sent directly
+#define MAC_PDU_CONTROL_CAPACITY 64     //Bytes reserved for control data of each MAC PDU object
+
+class MacPduPool;
+
+/**
+ * @brief MAC PDU object of a MacPduPool and its count of handles
+ */
+typedef struct{
+    MacPDU macPdu;                  //MAC PDU object
+    atomic<int> numberHandles;      //Number of handles alive of MAC PDU object
+}MacPduEntry;
+
+/**
+ * @brief Counted handle of a MAC PDU object drawn from a MacPduPool. Copying a handle shares the object, as ARQ and HARQ
+ * do to keep a PDU for retransmission without copying it; moving a handle transfers it. Object goes back to its pool
+ * when the last handle is destroyed or reset. All holders see the same object: only the scheduler changes it, and only
+ * to (re)transmit it
+ */
+class PooledMacPdu{
+private:
+    MacPduPool* pool;       //Pool that owns MAC PDU object; NULL if handle is empty
+    MacPduEntry* entry;     //MAC PDU object and its count of handles; NULL if handle is empty
+
+    /**
+     * @brief Constructs the first handle of a MAC PDU object; only its pool does it
+     * @param _pool Pool that owns MAC PDU object
+     * @param _entry MAC PDU object, with a count of one handle
+     */
+    PooledMacPdu(MacPduPool* _pool, MacPduEntry* _entry);
+
+    friend class MacPduPool;
+
+public:
+    /**
+     * @brief Constructs an empty handle
+     */
+    PooledMacPdu();
+
+    /**
+     * @brief Constructs another handle of the same MAC PDU object
+     * @param other Handle shared
+     */
+    PooledMacPdu(const PooledMacPdu & other);
+
+    /**
+     * @brief Takes MAC PDU object of another handle, which becomes empty
+     * @param other Handle moved
+     */
+    PooledMacPdu(PooledMacPdu && other) noexcept;
+
+    /**
+     * @brief Releases current object and shares object of another handle
+     * @param other Handle shared
+     * @returns This handle
+     */
+    PooledMacPdu & operator=(const PooledMacPdu & other);
+
+    /**
+     * @brief Releases current object and takes object of another handle, which becomes empty
+     * @param other Handle moved
+     * @returns This handle
+     */
+    PooledMacPdu & operator=(PooledMacPdu && other) noexcept;
+
+    /**
+     * @brief Releases object of handle
+     */
+    ~PooledMacPdu();
+
+    /**
+     * @brief Releases object of handle, which becomes empty; object goes back to pool if this was its last handle
+     */
+    void reset();
+
+    /**
+     * @brief Gets MAC PDU object
+     * @returns MAC PDU object; NULL if handle is empty
+     */
+    MacPDU* get() const;
+
+    /**
+     * @brief Accesses MAC PDU object; handle must not be empty
+     * @returns MAC PDU object
+     */
+    MacPDU* operator->() const;
+
+    /**
+     * @brief Accesses MAC PDU object; handle must not be empty
+     * @returns MAC PDU object
+     */
+    MacPDU & operator*() const;
+
+    /**
+     * @brief Verifies if handle holds a MAC PDU object
+     * @returns True if handle is not empty
+     */
+    explicit operator bool() const;
+};
+
+/**
+ * @brief Set of MacPDU objects with data vectors reserved for the largest PDU, so transmitting a PDU allocates and copies
+ * nothing: vectors keep their capacity when objects are reused
+ * Objects needed for scheduling and HARQ are allocated at construction; pool grows one object at a time, up to a maximum,
+ * only when ARQ keeps more PDUs waiting for acknowledgement, and never shrinks, so steady state allocates nothing
+ * It is thread-safe: scheduler and threads sending PDUs directly may draw objects at the same time
+ */
+class MacPduPool{
+private:
+    MacPduEntry** entries;      //MAC PDU objects allocated so far; room for maximum number
+    MacPduEntry** freeEntries;  //Stack of MAC PDU objects available
+    int numberMacPdus;          //Number of MAC PDU objects allocated so far
+    int maximumNumberMacPdus;   //Number of MAC PDU objects pool may grow to
+    int numberFreeMacPdus;      //Number of MAC PDU objects available in the stack
+    size_t dataCapacity;        //Bytes reserved for data of each MAC PDU object
+    mutex poolMutex;            //Mutex to control access to the stack
+    bool verbose;               //Verbosity flag
+
+    /**
+     * @brief Allocates one more MAC PDU object and pushes it to the free stack; poolMutex must be locked
+     * @returns True if object was allocated; false if pool has its maximum number of objects
+     */
+    bool grow();
+
+    /**
+     * @brief Counts one more handle of a MAC PDU object. Called by PooledMacPdu
+     * @param entry MAC PDU object
+     */
+    void addHandle(MacPduEntry* entry);
+
+    /**
+     * @brief Counts one handle less of a MAC PDU object, giving it back to the pool when it has no handles left. Called by PooledMacPdu
+     * @param entry MAC PDU object
+     */
+    void releaseHandle(MacPduEntry* entry);
+
+    friend class PooledMacPdu;
+
+public:
+    /**
+     * @brief Constructs pool and allocates its initial MAC PDU objects
+     * @param initialNumberMacPdus Number of MAC PDU objects allocated now
+     * @param _maximumNumberMacPdus Number of MAC PDU objects pool may grow to
+     * @param _dataCapacity Bytes reserved for data of each MAC PDU object, CRC included
+     * @param _verbose Verbosity flag
+     */
+    MacPduPool(int initialNumberMacPdus, int _maximumNumberMacPdus, size_t _dataCapacity, bool _verbose);
+
+    /**
+     * @brief Destroys pool and all its MAC PDU objects; no handle may be alive
+     */
+    ~MacPduPool();
+
+    /**
+     * @brief Draws a MAC PDU object from the pool, with default configuration and empty vectors
+     * @returns Handle of MAC PDU object; empty handle if all objects are in use and pool has its maximum number of objects
+     */
+    PooledMacPdu getMacPdu();
+
+    /**
+     * @brief Gets number of MAC PDU objects available
+     * @returns Number of free MAC PDU objects
+     */
+    int getNumberFreeMacPdus();
+};
+#endif  //INCLUDED_MAC_PDU_POOL_H
@@ -30,15 +30,19 @@ Multiplexer::Multiplexer(
         uint8_t _sourceMac,             //Source MAC Address
         MacAddressTable* _ipMacTable,   //MAC - IP table   
         int _maxSDUs,                   //Maximum number of SDUs in PDU
+        int _maxNumberQueues,           //Maximum number of TransmissionQueues
         bool _flagBS,                   //Flag true if equipment is BS, otherwise it is UE
         bool _verbose)                  //Verbosity flag
 {
-    transmissionQueues = new TransmissionQueue*[MAX_BUFFERS];
+    maxNumberTransmissionQueues = _maxNumberQueues<MAX_MAC_ADDRESSES? _maxNumberQueues:MAX_MAC_ADDRESSES;
+    transmissionQueues = new TransmissionQueue*[maxNumberTransmissionQueues];
     sourceMac = _sourceMac;
-    destinationMac = new uint8_t[MAX_BUFFERS];
-    numberBytes = new uint16_t[MAX_BUFFERS];
+    destinationMac = new uint8_t[maxNumberTransmissionQueues];
+    numberBytes = new uint16_t[maxNumberTransmissionQueues];
     maxNumberBytes = _maxNumberBytes;
     numberTransmissionQueues = 0;
+    for(int i=0;i<MAX_MAC_ADDRESSES;i++)
+        queueIndexes[i] = -1;
     ipMacTable = _ipMacTable;
     maxSDUs = _maxSDUs;
     flagBS = _flagBS;
@@ -68,16 +72,17 @@ Multiplexer::getMacAddress(
     
     //Search IP Address in MacAddressTable
     mac = ipMacTable->getMacAddress(ipAddress);
+    return mac;
 }
 
 void 
 Multiplexer::setTransmissionQueue(
     uint8_t _destinationMac)    //Destination MAC Address
 {
-    //Check if array is full
-    if(numberTransmissionQueues>MAX_BUFFERS && verbose){
-        cout<<"[Multiplexer] Trying to create more buffers than supported."<<endl;
-        exit(1);
+    //Check if array is full or destination already has its queue
+    if(numberTransmissionQueues>=maxNumberTransmissionQueues || queueIndexes[_destinationMac&15]!=-1){
+        if(verbose) cout<<"[Multiplexer] TransmissionQueue to "<<(int)_destinationMac<<" not created: array is full or queue exists."<<endl;
+        return;
     }
 
     //Allocate new TransmissionQueue and stores it in array
@@ -86,17 +91,40 @@ Multiplexer::setTransmissionQueue(
     //Initialize values of number of bytes and data/control flag
     destinationMac[numberTransmissionQueues] = _destinationMac;
     numberBytes[numberTransmissionQueues] = 0;
+    queueIndexes[_destinationMac&15] = numberTransmissionQueues;
 
     //Increment counter
     numberTransmissionQueues++;
 }
 
+int
+Multiplexer::getTransmissionQueueIndex(
+    uint8_t _destinationMac)    //Destination MAC Address
+{
+    int index = queueIndexes[_destinationMac&15];   //Index of TransmissionQueue
+
+    //TransmissionQueue not found
+    if(index==-1 && !flagBS && numberTransmissionQueues>0){
+        if(verbose) cout<<"[Multiplexer] No TransmissionQueue found. Forwarding to BS..."<<endl;
+        index = 0;      //BS index of TransmissionQueues (only this TransmissionQueue)
+    }
+    return index;
+}
+
+uint8_t
+Multiplexer::getDestinationMac(
+    int index)      //Index of TransmissionQueue
+{
+    return destinationMac[index];
+}
+
 int 
 Multiplexer::addSdu(
     char* sdu,          //Data SDU received from TUN
-    uint16_t size)      //Number of Bytes in SDU
+    uint16_t size,      //Number of Bytes in SDU
+    uint16_t & offset)  //First byte of SDU to be added
 {
-    return addSdu(sdu, size, 1, getMacAddress(sdu));
+    return addSdu(sdu, size, 1, getMacAddress(sdu), offset);
 }
 
 int 
@@ -104,83 +132,199 @@ Multiplexer::addSdu(
     char* sdu,                  //SDU buffer
     uint16_t size,              //Number of Bytes of SDU
     uint8_t flagDataControl,    //Data/Control flag
-    uint8_t _destinationMac)    //Destination MAC Address
+    uint8_t _destinationMac,    //Destination MAC Address
+    uint16_t & offset)          //First byte of SDU to be added
 {
-    int i;
+    return addSduIndex(sdu, size, flagDataControl, getTransmissionQueueIndex(_destinationMac), offset);
+}
 
-    //Look for TransmissionQueue corresponding to Mac Address
-    for(i=0;i<numberTransmissionQueues;i++)
-        if(destinationMac[i]==_destinationMac)
-            break;
+int 
+Multiplexer::addSduIndex(
+    char* sdu,                  //SDU buffer
+    uint16_t size,              //Number of Bytes of SDU
+    uint8_t flagDataControl,    //Data/Control flag
+    int index,                  //Index of TransmissionQueue
+    uint16_t & offset)          //First byte of SDU to be added
+{
+    int segmentSize;                //Number of bytes of next segment
+    uint8_t segmentationInfo;       //Segmentation information of next segment
 
     //TransmissionQueue not found
-    if(i==numberTransmissionQueues){
-        if(!flagBS){
-            if(verbose) cout<<"[Multiplexer] No TransmissionQueue found. Forwarding to BS..."<<endl;
-            i = 0;      //BS index of TransmissionQueues (only this TransmissionQueue)
-        }
-        else if(verbose){
-            cout<<"[Multiplexer] Error: no TransmissionQueue found."<<endl;
-            return -2;
-        }
+    if(index<0 || index>=numberTransmissionQueues){
+        if(verbose) cout<<"[Multiplexer] Error: no TransmissionQueue found."<<endl;
+        return -2;
     }
 
-    //Test if queue is full: if so, returns the MAC Address
-    if((size + 2 + transmissionQueues[i]->getNumberofBytes())>maxNumberBytes){
-        if(verbose) cout<<"[Multiplexer] Number of bytes exceed buffer max length. Returning MAC Address."<<endl;
-        return _destinationMac;
+    TransmissionQueue* transmissionQueue = transmissionQueues[index];
+
+    //A new SDU is refused before its first segment if an empty PDU could not take a segment of it, so the rest of an SDU
+    //always fits in the PDUs that follow and no SDU is left with only its first segments enqueued
+    if(offset==0 && (transmissionQueue->maximumNumberSDUs<=1 || transmissionQueue->maxNumberBytes<=MAC_HEADER_LENGTH+2)){
+        if(verbose) cout<<"[Multiplexer] Error: maximum PDU size too small for any SDU."<<endl;
+        return -2;
     }
 
-    //Test if there number of SDUs extrapolates maximum
-    if(transmissionQueues[i]->numberSDUs+1 == transmissionQueues[i]->maximumNumberSDUs){
-        if(verbose) cout<<"[Multiplexer] Tried to multiplex more SDUs than supported."<<endl;
-        return _destinationMac;
+    //Add SDU in as many segments as needed to fill PDU
+    while(offset<size){
+        //Test if there number of SDUs extrapolates maximum
+        if(transmissionQueue->numberSDUs+1 == transmissionQueue->maximumNumberSDUs){
+            if(verbose) cout<<"[Multiplexer] Tried to multiplex more SDUs than supported."<<endl;
+            return destinationMac[index];
+        }
+
+        //Segment takes all remaining bytes that fit in PDU after its 2-byte header
+        segmentSize = transmissionQueue->maxNumberBytes - transmissionQueue->getNumberofBytes() - 2;
+        if(segmentSize>size-offset) segmentSize = size-offset;
+        if(segmentSize>MAXIMUM_SEGMENT_LENGTH) segmentSize = MAXIMUM_SEGMENT_LENGTH;
+
+        //Test if queue is full: if so, returns the MAC Address; an empty queue always takes a segment, so SDU always gets through
+        if(segmentSize<=0 || (segmentSize<size-offset && segmentSize<MINIMUM_SEGMENT_LENGTH && transmissionQueue->numberSDUs>0)){
+            if(transmissionQueue->numberSDUs==0){
+                if(verbose) cout<<"[Multiplexer] Error: maximum PDU size too small for any SDU."<<endl;
+                return -2;
+            }
+            if(verbose) cout<<"[Multiplexer] Number of bytes exceed buffer max length. Returning MAC Address."<<endl;
+            return destinationMac[index];
+        }
+
+        //Segmentation information: SDU does not start here if offset>0 and does not end here if bytes remain
+        segmentationInfo = ((offset>0)<<1)|(offset+segmentSize<size);
+
+        //Attempts to add SDU (or its segment) to TransmissionQueue
+        if(!transmissionQueue->addSDU(sdu+offset, segmentSize, flagDataControl, segmentationInfo))
+            return -2;
+        offset+=segmentSize;
+        numberBytes[index]+=segmentSize;
+        if(verbose&&segmentationInfo!=COMPLETE_SDU) cout<<"[Multiplexer] SDU segment of "<<segmentSize<<" bytes added to queue."<<endl;
     }
 
-    //Attempts to add SDU to TransmissionQueue
-    if(transmissionQueues[i]->addSDU(sdu, size, flagDataControl)){
-        numberBytes[i]+=size;
-        if(verbose&&flagDataControl) cout<< "[Multiplexer] Data SDU added to queue!"<<endl;
-        if(verbose&&!flagDataControl) cout<< "[Multiplexer] Control SDU added to queue!"<<endl;
-        return -1;
+    if(verbose&&flagDataControl) cout<< "[Multiplexer] Data SDU added to queue!"<<endl;
+    if(verbose&&!flagDataControl) cout<< "[Multiplexer] Control SDU added to queue!"<<endl;
+    return -1;
+}
+
+bool
+Multiplexer::fitsWholeSdu(
+    int index,          //Index of TransmissionQueue
+    uint16_t size)      //Number of bytes of SDU
+{
+    TransmissionQueue* transmissionQueue = transmissionQueues[index];
+
+    //Same limits addSduIndex() applies to a segment, plus its 2-byte header
+    return transmissionQueue->numberSDUs+1<transmissionQueue->maximumNumberSDUs && size<=MAXIMUM_SEGMENT_LENGTH &&
+           transmissionQueue->getNumberofBytes()+2+size<=transmissionQueue->maxNumberBytes;
+}
+
+bool
+Multiplexer::sealPdu(
+    int index)      //Index of TransmissionQueue
+{
+    if(!transmissionQueues[index]->sealPdu())
+        return false;
+    numberBytes[index] = 0;
+    return true;
+}
+
+bool
+Multiplexer::hasSealedPdu(
+    int index)      //Index of TransmissionQueue
+{
+    return transmissionQueues[index]->hasSealedPdu();
+}
+
+ssize_t
+Multiplexer::getNextPduSize(
+    int index)      //Index of TransmissionQueue
+{
+    ssize_t size;   //Size of sealed PDU
+
+    if(transmissionQueues[index]->hasSealedPdu()){
+        transmissionQueues[index]->getSealedPdu(size);
+        return size;
     }
-    return -2; 
+    return numberBytes[index]==0? 0:transmissionQueues[index]->getNumberofBytes();
+}
+
+size_t
+Multiplexer::getNumberPendingBytes(
+    int index)      //Index of TransmissionQueue
+{
+    ssize_t size = 0;   //Size of sealed PDU
+
+    if(transmissionQueues[index]->hasSealedPdu())
+        transmissionQueues[index]->getSealedPdu(size);
+    return size+(numberBytes[index]==0? 0:transmissionQueues[index]->getNumberofBytes());
 }
 
 ssize_t 
 Multiplexer::getPdu(
-    char* buffer,       //Buffer to store PDU
-    uint8_t macAddress) //Destination MAC Address of PDU
+    char* buffer,                   //Buffer to store PDU
+    uint8_t macAddress,             //Destination MAC Address of PDU
+    CrcCalculator & crcCalculator)  //CRC calculator updated with PDU bytes
 {
-    ssize_t size;   //Size of PDU
-    int index;      //Auxiliary variable for loop
+    ssize_t size;                                       //Size of PDU
+    int index = getTransmissionQueueIndex(macAddress);  //Index of TransmissionQueue
 
-    for(index=0;index<numberTransmissionQueues;index++){
-        if(destinationMac[index]==macAddress)
-            break;
-    }
     //Test if macAddress was found
-    if(index==numberTransmissionQueues){
+    if(index==-1){
         if(verbose) cout<<"[Multiplexer] Could not get PDU: MAC Address not found."<<endl;
         return -1;
     }
 
+    //Sealed PDU is older, so it is returned first
+    if(transmissionQueues[index]->hasSealedPdu()){
+        char* sealedPdu = transmissionQueues[index]->getSealedPdu(size);
+        memcpy(buffer, sealedPdu, size);
+        crcCalculator = transmissionQueues[index]->getSealedPduCrc();
+        transmissionQueues[index]->releaseSealedPdu();
+        return size;
+    }
+
     //Test if there are bytes to return
     if(numberBytes[index] == 0){
         if(verbose) cout<<"[Multiplexer] Could not get PDU: no Bytes to transfer."<<endl;
         return -1;
     }
 
-    //Creates a ProtocolPackage to receive the PDU
-    ProtocolPackage* pdu = transmissionQueues[index]->getPDUPackage();
-
     if(verbose) cout<<"[Multiplexer] Inserting MAC Header."<<endl;
 
-    //Inserts MacHeader and returns PDU size
-    pdu->insertMacHeader();
-    size = pdu->getPduSize();
-    memcpy(buffer, pdu->buffer, size);
-    delete pdu;
+    //Gathers MacHeader and SDUs directly into buffer and returns PDU size
+    size = transmissionQueues[index]->getPdu(buffer, crcCalculator);
+
+    transmissionQueues[index]->clearBuffer();
+    numberBytes[index] = 0;
+
+    return size;
+}
+
+ssize_t 
+Multiplexer::getPdu(
+    vector<uint8_t> & pdu,          //Vector to store PDU
+    uint8_t macAddress,             //Destination MAC Address of PDU
+    CrcCalculator & crcCalculator)  //CRC calculator updated with PDU bytes
+{
+    ssize_t size;                                       //Size of PDU
+    int index = getTransmissionQueueIndex(macAddress);  //Index of TransmissionQueue
+
+    //Sealed PDU is older, so it is returned first
+    if(index!=-1 && transmissionQueues[index]->hasSealedPdu()){
+        char* sealedPdu = transmissionQueues[index]->getSealedPdu(size);
+        pdu.assign(sealedPdu, sealedPdu+size);
+        crcCalculator = transmissionQueues[index]->getSealedPduCrc();
+        transmissionQueues[index]->releaseSealedPdu();
+        return size;
+    }
+
+    //Test if macAddress was found and if there are bytes to return
+    if(index==-1 || numberBytes[index]==0){
+        if(verbose) cout<<"[Multiplexer] Could not get PDU: MAC Address not found or no Bytes to transfer."<<endl;
+        pdu.clear();
+        return -1;
+    }
+
+    //Resize vector once and gather PDU straight into it
+    pdu.resize(transmissionQueues[index]->getNumberofBytes());
+    size = transmissionQueues[index]->getPdu((char*) pdu.data(), crcCalculator);
 
     transmissionQueues[index]->clearBuffer();
     numberBytes[index] = 0;
@@ -192,12 +336,12 @@ bool
 Multiplexer::emptyPdu(
     uint8_t macAddress)      //Destination MAC Address of PDU
 {
-    for(int i=0;i<numberTransmissionQueues;i++){
-        if(destinationMac[i]==macAddress)
-            return numberBytes[i]==0;
+    int index = getTransmissionQueueIndex(macAddress);  //Index of TransmissionQueue
+    if(index==-1){
+        if(verbose) cout<<"[Multiplexer] MAC address not found verifying empty PDU."<<endl;
+        return true;
     }
-    if(verbose) cout<<"[Multiplexer] MAC address not found verifying empty PDU."<<endl;
-    return true;
+    return numberBytes[index]==0 && !transmissionQueues[index]->hasSealedPdu();
 }
 
 int 
@@ -209,7 +353,23 @@ void
 Multiplexer::setMaxNumberBytes(
 		uint16_t _maxNumberBytes)	//Maximum number of Bytes for each PDU
 {
-	maxNumberBytes = _maxNumberBytes;
+	maxNumberBytes = _maxNumberBytes>MAXIMUM_PDU_LENGTH? MAXIMUM_PDU_LENGTH:_maxNumberBytes;
 	for(int i=0;i<numberTransmissionQueues;i++)
-		transmissionQueues[i]->maxNumberBytes = _maxNumberBytes;
+		transmissionQueues[i]->maxNumberBytes = maxNumberBytes;
+}
+
+void
+Multiplexer::setMaxNumberBytes(
+    int index,                  //Index of TransmissionQueue
+    uint16_t _maxNumberBytes)   //Maximum number of Bytes for PDUs of this destination
+{
+    transmissionQueues[index]->maxNumberBytes = _maxNumberBytes>MAXIMUM_PDU_LENGTH? MAXIMUM_PDU_LENGTH:_maxNumberBytes;
+    if(verbose) cout<<"[Multiplexer] Maximum PDU size to MAC "<<(int)destinationMac[index]<<" set to "<<transmissionQueues[index]->maxNumberBytes<<" bytes."<<endl;
+}
+
+uint16_t
+Multiplexer::getMaxNumberBytes(
+    int index)      //Index of TransmissionQueue
+{
+    return transmissionQueues[index]->maxNumberBytes;
 }
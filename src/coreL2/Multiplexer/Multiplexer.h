@@ -10,13 +10,14 @@
 #include <iostream>
 #include <list>
 #include <string.h>
+#include <vector>
 
 #include "../Multiplexer/TransmissionQueue.h"
 #include "../ProtocolPackage/ProtocolPackage.h"
 #include "MacAddressTable/MacAddressTable.h"
 
-#define MAX_BUFFERS 8       //Maximum number of SDU buffers (maximum destinations)
 #define DST_OFFSET 16       //IP address offset in L3 packet
+#define MAX_MAC_ADDRESSES 16    //Number of possible MAC Addresses (4 bits)
 using namespace std;
 
 class Multiplexer{
@@ -24,9 +25,11 @@ private:
     TransmissionQueue** transmissionQueues;     //Array of TransmissionQueues to manage SDU queues
     uint8_t sourceMac;                          //Source MAC Address
     uint8_t* destinationMac;                    //Destination MAC5GR for each TransmissionQueue
+    int queueIndexes[MAX_MAC_ADDRESSES];        //Index of TransmissionQueue of each destination MAC Address; -1 if there is none
     uint16_t* numberBytes;                      //Number of bytes for each IP Address
-    uint16_t maxNumberBytes;                    //Maximum number of bytes to fill PDU
+    uint16_t maxNumberBytes;                    //Default maximum number of bytes to fill PDU (each TransmissionQueue keeps its own)
     int numberTransmissionQueues;               //Number of TransmissionQueues actually stored in Multiplexer
+    int maxNumberTransmissionQueues;            //Number of TransmissionQueues arrays were allocated for (maximum destinations)
     int maxSDUs;                                //Maximum number of SDUs multiplexed
     MacAddressTable* ipMacTable;                //Table of correlation of IP Addresses and MAC5GR Addresses
     bool flagBS;                                //Flag to know if equipment is BS or UE
@@ -38,10 +41,11 @@ public:
      * @param _sourceMac Source MAC Address
      * @param _ipMacTable Static declared MacAddressTable
      * @param _maxSDUs Maximum number of SDUs supported in a single PDU
+     * @param _maxNumberQueues Maximum number of TransmissionQueues (destinations): number of UEs for BS, 1 for UE
      * @param _flagBS Flag that is true if equipment is BS
      * @param _verbose Verbosity flag
      */
-    Multiplexer(uint16_t _maxNumberBytes, uint8_t _sourceMac, MacAddressTable* _ipMacTable, int _maxSDUs, bool _flagBS, bool _verbose);
+    Multiplexer(uint16_t _maxNumberBytes, uint8_t _sourceMac, MacAddressTable* _ipMacTable, int _maxSDUs, int _maxNumberQueues, bool _flagBS, bool _verbose);
     
     /**
      * @brief Destroys the Multiplexer object and unallocates memory
@@ -58,18 +62,35 @@ public:
     /**
      * @brief Defines a new TransmissionQueue to specific destination and adds
      * it to array of TransmissionQueues in the Multiplexer.
+     * A destination beyond the maximum number of TransmissionQueues, or already set, is ignored.
      * 
      * @param _destinationMac Destination MAC Address
      */
     void setTransmissionQueue(uint8_t _destinationMac);
+
+    /**
+     * @brief Gets index of TransmissionQueue of a destination in constant time
+     * The index is the same as the order of creation of TransmissionQueues, so it also identifies per-destination resources, e.g. condition variables
+     * @param _destinationMac Destination MAC Address
+     * @returns Index of TransmissionQueue; UE falls back to its single queue to BS; -1 if BS has no queue to destination
+     */
+    int getTransmissionQueueIndex(uint8_t _destinationMac);
+
+    /**
+     * @brief Gets destination MAC Address of a TransmissionQueue
+     * @param index Index of TransmissionQueue
+     * @returns Destination MAC Address
+     */
+    uint8_t getDestinationMac(int index);
     
     /**
      * @brief Adds a new DATA SDU to the TransmissionQueue that corresponds with IP Address of the L3 Packet
      * @param sdu Data SDU received from TUN interface
      * @param size Number of bytes in SDU
+     * @param offset First byte of SDU to be added (0 for a new SDU); advanced by the number of bytes added
      * @returns -1 if successful; MAC Address of queue to send data if queue is full for Tx; -2 for errors
      */
-    int addSdu(char* sdu, uint16_t size);
+    int addSdu(char* sdu, uint16_t size, uint16_t & offset);
     
     /**
      * @brief Adds a new SDU to the TransmissionQueue that corresponds with MAC address passed as parameter
@@ -77,20 +98,81 @@ public:
      * @param size Number of bytes of SDU
      * @param flagDataControl Data/Control Flag
      * @param _destinationMac Destination MAC Address
+     * @param offset First byte of SDU to be added (0 for a new SDU); advanced by the number of bytes added
      * @returns -1 if successful; MAC Address of queue to send data if queue is full for Tx; -2 for errors
      */    
-    int addSdu(char* sdu, uint16_t size, uint8_t flagDataControl, uint8_t _destinationMac);
+    int addSdu(char* sdu, uint16_t size, uint8_t flagDataControl, uint8_t _destinationMac, uint16_t & offset);
+
+    /**
+     * @brief Adds a new SDU to the TransmissionQueue identified by its index, previously got with getTransmissionQueueIndex()
+     * SDU bytes that do not fit in the PDU are segmented: PDU is filled up to its maximum size and, if it is full, the MAC Address is
+     * returned with offset pointing to the remaining bytes, which must be added again after the PDU is sealed.
+     * A new SDU (offset 0) is refused with -2 before any segment is enqueued if an empty PDU of the queue could not take a segment
+     * @param sdu SDU buffer
+     * @param size Number of bytes of SDU
+     * @param flagDataControl Data/Control Flag
+     * @param index Index of TransmissionQueue
+     * @param offset First byte of SDU to be added (0 for a new SDU); advanced by the number of bytes added
+     * @returns -1 if whole SDU was added; MAC Address of queue to send data if queue is full for Tx; -2 for errors
+     */    
+    int addSduIndex(char* sdu, uint16_t size, uint8_t flagDataControl, int index, uint16_t & offset);
     
     /**
-     * @brief Gets the multiplexed PDU with MacHeader from TransmissionQueue identified by MAC Address
+     * @brief Verifies if an SDU can be added to a TransmissionQueue whole, in a single segment
+     * @param index Index of TransmissionQueue
+     * @param size Number of bytes of SDU
+     * @returns True if SDU fits in PDU being filled
+     */
+    bool fitsWholeSdu(int index, uint16_t size);
+
+    /**
+     * @brief Seals PDU of a TransmissionQueue, so a sender can take it while the queue is filled again with new SDUs
+     * @param index Index of TransmissionQueue
+     * @returns True if PDU was sealed; false if queue is empty or its previous sealed PDU was not taken yet
+     */
+    bool sealPdu(int index);
+
+    /**
+     * @brief Verifies if a TransmissionQueue has a sealed PDU waiting to be sent
+     * @param index Index of TransmissionQueue
+     * @returns True if there is a sealed PDU
+     */
+    bool hasSealedPdu(int index);
+
+    /**
+     * @brief Gets size of the PDU that will be taken next from a TransmissionQueue: its sealed PDU if it exists, else the PDU being filled
+     * @param index Index of TransmissionQueue
+     * @returns Size of PDU in bytes; 0 if there is no PDU
+     */
+    ssize_t getNextPduSize(int index);
+
+    /**
+     * @brief Gets number of bytes waiting in a TransmissionQueue: its sealed PDU plus the PDU being filled
+     * @param index Index of TransmissionQueue
+     * @returns Number of bytes
+     */
+    size_t getNumberPendingBytes(int index);
+
+    /**
+     * @brief Gets the multiplexed PDU with MacHeader from TransmissionQueue identified by MAC Address; sealed PDU is returned first, if it exists
      * @param buffer Buffer where PDU will be stored
      * @param macAddress Destination MAC Address of PDU
+     * @param crcCalculator CRC calculator updated with PDU bytes while they are gathered
      * @returns Size of the PDU
      */    
-    ssize_t getPdu(char* buffer, uint8_t macAddress);
+    ssize_t getPdu(char* buffer, uint8_t macAddress, CrcCalculator & crcCalculator);
+
+    /**
+     * @brief Gets the multiplexed PDU with MacHeader from TransmissionQueue identified by MAC Address directly into a byte vector; sealed PDU is returned first, if it exists
+     * @param pdu Vector resized to PDU size and filled with PDU, e.g. MacPDU::mac_data_
+     * @param macAddress Destination MAC Address of PDU
+     * @param crcCalculator CRC calculator updated with PDU bytes while they are gathered
+     * @returns Size of the PDU; -1 if there is no PDU
+     */    
+    ssize_t getPdu(vector<uint8_t> & pdu, uint8_t macAddress, CrcCalculator & crcCalculator);
     
     /**
-     * @brief Verifies if PDU is empty
+     * @brief Verifies if PDU is empty, i.e. there are no SDUs enqueued and no sealed PDU
      * @param macAddress Destination MAC Address of PDU
      * @returns true if empty; false otherwise
      */    
@@ -107,5 +189,19 @@ public:
      * @param _maxNumberBytes
      */
     void setMaxNumberBytes(uint16_t _maxNumberBytes);
+
+    /**
+     * @brief Sets Maximum number of Bytes for PDUs of a single destination, e.g. according to its transport block capacity
+     * @param index Index of TransmissionQueue
+     * @param _maxNumberBytes Maximum number of bytes, limited to MAXIMUM_PDU_LENGTH
+     */
+    void setMaxNumberBytes(int index, uint16_t _maxNumberBytes);
+
+    /**
+     * @brief Gets Maximum number of Bytes for PDUs of a single destination
+     * @param index Index of TransmissionQueue
+     * @returns Maximum number of bytes
+     */
+    uint16_t getMaxNumberBytes(int index);
 };
 #endif  //INCLUDED_MULTIPLEXER_H
@@ -0,0 +1,71 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+/**
+@Arquive name : PduBufferPool.cpp
+@Classification : Multiplexer
+@
+@Version : v1.0
+
+Project : H2020 5G-Range
+
+@Description : This module keeps a fixed set of preallocated PDU buffers, so
+    multiplexing does not allocate memory for each PDU transmitted.
+*/
+
+#include "PduBufferPool.h"
+
+PduBufferPool::PduBufferPool(
+    int _numberBuffers,     //Number of buffers
+    size_t _bufferSize,     //Size of each buffer in bytes
+    bool _verbose)          //Verbosity flag
+{
+    numberBuffers = _numberBuffers;
+    bufferSize = _bufferSize;
+    verbose = _verbose;
+
+    //Allocate all buffers at once and push them to the free stack
+    memory = new char[numberBuffers*bufferSize];
+    freeBuffers = new char*[numberBuffers];
+    for(int i=0;i<numberBuffers;i++)
+        freeBuffers[i] = memory+i*bufferSize;
+    numberFreeBuffers = numberBuffers;
+}
+
+PduBufferPool::~PduBufferPool(){
+    delete [] freeBuffers;
+    delete [] memory;
+}
+
+char*
+PduBufferPool::getBuffer(){
+    if(numberFreeBuffers==0){
+        if(verbose) cout<<"[PduBufferPool] No buffers available."<<endl;
+        return NULL;
+    }
+    return freeBuffers[--numberFreeBuffers];
+}
+
+void
+PduBufferPool::returnBuffer(
+    char* buffer)       //Buffer to give back
+{
+    //Ignore buffers that do not belong to this pool
+    if(buffer<memory || buffer>=memory+numberBuffers*bufferSize || numberFreeBuffers==numberBuffers){
+        if(verbose) cout<<"[PduBufferPool] Tried to return invalid buffer."<<endl;
+        return;
+    }
+    freeBuffers[numberFreeBuffers++] = buffer;
+}
+
+size_t
+PduBufferPool::getBufferSize(){
+    return bufferSize;
+}
+
+int
+PduBufferPool::getNumberFreeBuffers(){
+    return numberFreeBuffers;
+}
@@ -0,0 +1,68 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+
+#ifndef INCLUDED_PDU_BUFFER_POOL_H
+#define INCLUDED_PDU_BUFFER_POOL_H
+
+#include <iostream>     //cout
+#include <stddef.h>     //size_t, NULL
+
+using namespace std;
+
+#define PDU_BUFFERS_PER_DESTINATION 2   //Number of PDU buffers preallocated for each destination
+
+/**
+ * @brief Fixed set of PDU buffers allocated once and reused for every PDU of a destination
+ * It is not thread-safe: it must be used under the lock of the TransmissionQueue that owns it
+ */
+class PduBufferPool{
+private:
+    char* memory;               //Contiguous memory of all buffers
+    char** freeBuffers;         //Stack of buffers available
+    int numberBuffers;          //Total number of buffers
+    int numberFreeBuffers;      //Number of buffers available in the stack
+    size_t bufferSize;          //Size of each buffer in bytes
+    bool verbose;               //Verbosity flag
+
+public:
+    /**
+     * @brief Constructs pool and allocates all its buffers
+     * @param _numberBuffers Number of buffers
+     * @param _bufferSize Size of each buffer in bytes
+     * @param _verbose Verbosity flag
+     */
+    PduBufferPool(int _numberBuffers, size_t _bufferSize, bool _verbose);
+
+    /**
+     * @brief Destroys pool and frees memory of all its buffers
+     */
+    ~PduBufferPool();
+
+    /**
+     * @brief Draws a buffer from the pool
+     * @returns Buffer with getBufferSize() bytes; NULL if all buffers are in use
+     */
+    char* getBuffer();
+
+    /**
+     * @brief Gives a buffer back to the pool
+     * @param buffer Buffer previously got with getBuffer()
+     */
+    void returnBuffer(char* buffer);
+
+    /**
+     * @brief Gets size of each buffer
+     * @returns Buffer size in bytes
+     */
+    size_t getBufferSize();
+
+    /**
+     * @brief Gets number of buffers available
+     * @returns Number of free buffers
+     */
+    int getNumberFreeBuffers();
+};
+#endif  //INCLUDED_PDU_BUFFER_POOL_H
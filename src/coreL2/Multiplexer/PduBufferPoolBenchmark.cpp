@@ -0,0 +1,235 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+/**
+@Arquive name : PduBufferPoolBenchmark.cpp
+@Classification : Multiplexer [BENCHMARK]
+@
+@Version : v1.0
+
+Project : H2020 5G-Range
+
+@Description : Standalone program that counts heap allocations while SDUs are
+    multiplexed, segmented, sealed and gathered into PDUs, checking that PDU
+    buffers drawn from PduBufferPool make the steady state allocation-free, and
+    measures time per PDU. Then it does the same over the whole transmission
+    path of a UE: MacController::getMacPdu() (gathering, CRC appended) into
+    objects of MacPduPool, and L1L2Interface::sendPdu() (serialization) over
+    a transport that discards messages.
+    It writes its Default.txt in a temporary directory, where it runs.
+    Build: g++ -O2 -std=c++14 PduBufferPoolBenchmark.cpp $(find .. -name "*.cpp" ! -name CoreL2.cpp ! -name "*Benchmark.cpp")
+        ../../common/lib5grange/lib5grange.cpp ../../common/InterlayerTransport/InterlayerTransport.cpp
+        ../../common/InterlayerTransport/ShmRing.cpp -pthread -o pduBufferPoolBenchmark
+*/
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <new>          //std::bad_alloc
+#include <fstream>      //std::ofstream
+#include <stdlib.h>     //malloc(), free(), atoi(), mkdtemp()
+#include <unistd.h>     //chdir()
+
+#include "Multiplexer.h"
+#include "../MacController/MacController.h"
+
+using namespace std;
+
+#define BENCHMARK_PDU_LENGTH 2048       //Maximum bytes of each PDU
+#define BENCHMARK_MAX_SDUS 20           //Maximum SDUs of each PDU, as MAXSDUS
+#define BENCHMARK_WARM_UP_PDUS 64       //PDUs assembled before allocations are counted
+#define BENCHMARK_ITERATIONS 100000     //PDUs assembled while allocations are counted
+#define BENCHMARK_DESTINATION_MAC 1     //MAC Address of destination
+#define BENCHMARK_UE_MAC 1              //MAC Address of UE whose transmission path is measured; it sends to BS (MAC Address 0)
+
+static atomic<size_t> numberAllocations(0);    //Heap allocations made by the whole program
+
+void* operator new(size_t size){
+    numberAllocations++;
+    void* pointer = malloc(size? size:1);
+    if(pointer==NULL)
+        throw bad_alloc();
+    return pointer;
+}
+
+void* operator new[](size_t size){
+    return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept{
+    free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept{
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept{
+    free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept{
+    free(pointer);
+}
+
+/**
+ * @brief Assembles PDUs as the MAC does: SDUs of varying sizes are added (segmented when they do not fit),
+ * PDU is sealed when full and gathered into a reused vector
+ * @param mux Multiplexer with a single TransmissionQueue
+ * @param sdu Buffer of largest SDU
+ * @param pdu Vector where PDUs are gathered, as MacPDU::mac_data_
+ * @param numberPdus Number of PDUs to assemble
+ * @returns Total bytes of PDUs assembled
+ */
+static size_t assemblePdus(Multiplexer & mux, char* sdu, vector<uint8_t> & pdu, int numberPdus){
+    size_t totalBytes = 0;      //Bytes of all PDUs
+    uint16_t sduSize = 40;      //Size of next SDU: from TCP ACKs to full MTU
+    for(int i=0;i<numberPdus;){
+        uint16_t offset = 0;    //First byte of SDU not enqueued yet
+        while(mux.addSduIndex(sdu, sduSize, 1, 0, offset)>=0){
+            mux.sealPdu(0);
+            CrcCalculator crcCalculator(CRC16_5GRANGE);
+            totalBytes += mux.getPdu(pdu, BENCHMARK_DESTINATION_MAC, crcCalculator);
+            i++;
+        }
+        sduSize = sduSize%1500+97;
+    }
+    return totalBytes;
+}
+
+/**
+ * @brief Transport that discards messages, so only L2 work is measured
+ */
+class NullTransport : public InterlayerTransport{
+public:
+    NullTransport() : InterlayerTransport(true, false) { }
+
+    bool send(InterlayerChannels channel, const char* buffer, size_t numberBytes){
+        return true;
+    }
+
+    bool sendBatch(const InterlayerMessage* messages, int numberMessages){
+        return true;
+    }
+
+    ssize_t receive(InterlayerChannels channel, char* buffer, size_t maximumLength, bool blocking){
+        return -1;
+    }
+
+    bool waitForMessage(InterlayerChannels channel, int timeout){
+        return false;
+    }
+};
+
+/**
+ * @brief Writes Default.txt of a UE with a single antenna and whole band reserved in a temporary directory, and moves there
+ * @returns True if parameters were written
+ */
+static bool writeUeParameters(){
+    char directory[] = "/tmp/pduBufferPoolBenchmarkXXXXXX";     //Temporary directory
+    if(mkdtemp(directory)==NULL || chdir(directory)!=0)
+        return false;
+
+    //FlagBS, numerology, OFDM/GFDM, RxMetrics periodicity, MTU, IP timeout; then UE reservation, MCS Uplink, MIMO and TPC
+    ofstream parameters("Default.txt");
+    parameters<<"0\n0\n0\n10\n1500\n10\n"<<BENCHMARK_UE_MAC<<"\n0\n132\n15\n0\n0\n0\n0\n0\n0\n";
+    return parameters.good();
+}
+
+/**
+ * @brief Transmits PDUs as a UE does outside the scheduler: SDUs are multiplexed, PDU is sealed when full, taken by
+ * MacController::getMacPdu() into a MAC PDU object of the pool and sent by L1L2Interface
+ * @param macController MacController with Multiplexer and L1L2Interface set
+ * @param macPduPool Pool of MAC PDU objects
+ * @param sdu Buffer of largest SDU
+ * @param numberPdus Number of PDUs to transmit
+ * @returns Total bytes of PDUs transmitted
+ */
+static size_t transmitPdus(MacController & macController, MacPduPool & macPduPool, char* sdu, int numberPdus){
+    size_t totalBytes = 0;      //Bytes of all PDUs
+    uint16_t sduSize = 40;      //Size of next SDU: from TCP ACKs to full MTU
+    for(int i=0;i<numberPdus;){
+        uint16_t offset = 0;    //First byte of SDU not enqueued yet
+        while(macController.mux->addSduIndex(sdu, sduSize, 1, 0, offset)>=0){
+            macController.mux->sealPdu(0);
+            PooledMacPdu macPdu = macPduPool.getMacPdu();
+            totalBytes += macController.getMacPdu(*macPdu, 0);
+            macController.l1l2Interface->sendPdu(*macPdu, 0);
+            i++;
+        }
+        sduSize = sduSize%1500+97;
+    }
+    return totalBytes;
+}
+
+/**
+ * @brief Prints results of a stage and verifies it allocated nothing
+ * @param stage Name of stage
+ * @param numberPdus Number of PDUs measured
+ * @param totalBytes Total bytes of PDUs
+ * @param elapsed Time spent
+ * @param allocations Heap allocations made
+ * @returns True if stage is allocation-free
+ */
+static bool report(const char* stage, int numberPdus, size_t totalBytes, chrono::nanoseconds elapsed, size_t allocations){
+    cout<<stage<<endl;
+    cout<<"PDUs: "<<numberPdus<<", "<<(double)totalBytes/numberPdus<<" bytes each"<<endl;
+    cout<<"Time: "<<(double)elapsed.count()/numberPdus<<" ns/PDU"<<endl;
+    cout<<"Allocations: "<<(double)allocations/numberPdus<<" per PDU"<<endl;
+    if(allocations!=0){
+        cout<<"Steady state is not allocation-free: "<<allocations<<" allocations."<<endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv){
+    int iterations = argc>1? atoi(argv[1]):BENCHMARK_ITERATIONS;
+    MacAddressTable ipMacTable(false);
+    Multiplexer mux(BENCHMARK_PDU_LENGTH, 0, &ipMacTable, BENCHMARK_MAX_SDUS, 1, true, false);
+    mux.setTransmissionQueue(BENCHMARK_DESTINATION_MAC);
+    vector<char> sdu(1600);
+    for(size_t i=0;i<sdu.size();i++)
+        sdu[i] = rand();
+
+    //PDU vector is reserved once, as MAC PDU objects of MacPduPool
+    vector<uint8_t> pdu;
+    pdu.reserve(BENCHMARK_PDU_LENGTH);
+
+    //Buffers are drawn from pool on first PDUs; afterwards, nothing may be allocated
+    assemblePdus(mux, &sdu[0], pdu, BENCHMARK_WARM_UP_PDUS);
+    size_t allocationsBefore = numberAllocations;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    size_t totalBytes = assemblePdus(mux, &sdu[0], pdu, iterations);
+    chrono::nanoseconds elapsed = chrono::steady_clock::now()-start;
+    size_t allocations = numberAllocations-allocationsBefore;
+
+    bool allocationFree = report("Multiplexer:", iterations, totalBytes, elapsed, allocations);
+
+    //Transmission path of a UE: MacController is only given the objects getMacPdu() uses, so it is not initialized
+    //(no TUN, no threads) and it is never destroyed
+    if(!writeUeParameters()){
+        cout<<"Could not write Default.txt."<<endl;
+        return 1;
+    }
+    MacController* macController = new MacController("benchmark", false);
+    macController->flagBS = false;
+    macController->mux = new Multiplexer(BENCHMARK_PDU_LENGTH, BENCHMARK_UE_MAC, &ipMacTable, BENCHMARK_MAX_SDUS, 1, false, false);
+    macController->mux->setTransmissionQueue(0);
+    macController->l1l2Interface = new L1L2Interface(new NullTransport(), MACPDU_WIRE_FLAT, false);
+    MacPduPool macPduPool(MAC_PDUS_PER_DESTINATION, MAC_PDUS_PER_DESTINATION, MAXIMUM_PDU_LENGTH+CRC_LENGTH, false);
+
+    //Batch buffers of L1L2Interface grow on first PDUs; afterwards, nothing may be allocated
+    transmitPdus(*macController, macPduPool, &sdu[0], BENCHMARK_WARM_UP_PDUS);
+    allocationsBefore = numberAllocations;
+    start = chrono::steady_clock::now();
+    totalBytes = transmitPdus(*macController, macPduPool, &sdu[0], iterations);
+    elapsed = chrono::steady_clock::now()-start;
+    allocations = numberAllocations-allocationsBefore;
+
+    allocationFree = report("MacController, MacPduPool and L1L2Interface:", iterations, totalBytes, elapsed, allocations) && allocationFree;
+    return allocationFree? 0:1;
+}
@@ -0,0 +1,104 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+/**
+@Arquive name : SduReassembler.cpp
+@Classification : Multiplexer
+@
+@Version : v1.0
+
+Project : H2020 5G-Range
+
+@Description : This module rebuilds SDUs from the segments carried in 
+    consecutive PDUs of the same source, on decoding.
+*/
+
+#include "SduReassembler.h"
+
+SduReassembler::SduReassembler(
+    bool _verbose)      //Verbosity flag
+{
+    verbose = _verbose;
+    for(int i=0;i<MAX_MAC_ADDRESSES;i++){
+        for(int j=0;j<2;j++){
+            buffers[i][j] = NULL;
+            sizes[i][j] = 0;
+            inReassembly[i][j] = false;
+        }
+    }
+}
+
+SduReassembler::~SduReassembler(){
+    for(int i=0;i<MAX_MAC_ADDRESSES;i++)
+        for(int j=0;j<2;j++)
+            delete[] buffers[i][j];
+}
+
+ssize_t
+SduReassembler::addSegment(
+    char* segment,                  //Buffer containing SDU or segment
+    uint16_t size,                  //Size of SDU or segment in bytes
+    uint8_t flagDataControl,        //Data/Control flag
+    uint8_t segmentationInfo,       //Segmentation information
+    uint8_t sourceMac,              //Source MAC Address
+    char* & sdu)                    //Pointer to complete SDU
+{
+    uint8_t mac = sourceMac&15;         //Index of source
+    uint8_t flag = flagDataControl&1;   //Index of D/C flag
+
+    //A segment that starts an SDU means previous SDU in reassembly lost its last segment
+    if(!(segmentationInfo&2) && inReassembly[mac][flag]){
+        if(verbose) cout<<"[SduReassembler] Dropped incomplete SDU from MAC "<<(int)mac<<"."<<endl;
+        inReassembly[mac][flag] = false;
+    }
+
+    //Not segmented: no copy needed
+    if(segmentationInfo==COMPLETE_SDU){
+        sdu = segment;
+        return size;
+    }
+
+    //Continuation of an SDU whose first segment was lost
+    if((segmentationInfo&2) && !inReassembly[mac][flag]){
+        if(verbose) cout<<"[SduReassembler] Dropped segment from MAC "<<(int)mac<<" with no SDU in reassembly."<<endl;
+        return 0;
+    }
+
+    //First segment: start new SDU
+    if(!(segmentationInfo&2)){
+        if(buffers[mac][flag]==NULL)
+            buffers[mac][flag] = new char[MAXIMUM_REASSEMBLED_SDU_LENGTH];
+        sizes[mac][flag] = 0;
+        inReassembly[mac][flag] = true;
+    }
+
+    //Append segment
+    if(sizes[mac][flag]+size>MAXIMUM_REASSEMBLED_SDU_LENGTH){
+        if(verbose) cout<<"[SduReassembler] Dropped SDU from MAC "<<(int)mac<<" larger than supported."<<endl;
+        inReassembly[mac][flag] = false;
+        return 0;
+    }
+    memcpy(buffers[mac][flag]+sizes[mac][flag], segment, size);
+    sizes[mac][flag]+=size;
+
+    //SDU is complete on its last segment
+    if(segmentationInfo&1)
+        return 0;
+    inReassembly[mac][flag] = false;
+    sdu = buffers[mac][flag];
+    if(verbose) cout<<"[SduReassembler] SDU of "<<sizes[mac][flag]<<" bytes reassembled."<<endl;
+    return sizes[mac][flag];
+}
+
+void
+SduReassembler::dropIncomplete(
+    uint8_t sourceMac)      //Source MAC Address
+{
+    uint8_t mac = sourceMac&15;     //Index of source
+
+    if(verbose && (inReassembly[mac][0]||inReassembly[mac][1])) cout<<"[SduReassembler] Dropped incomplete SDU from MAC "<<(int)mac<<"."<<endl;
+    inReassembly[mac][0] = false;
+    inReassembly[mac][1] = false;
+}
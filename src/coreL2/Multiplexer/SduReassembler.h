@@ -0,0 +1,64 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+
+#ifndef INCLUDED_SDU_REASSEMBLER_H
+#define INCLUDED_SDU_REASSEMBLER_H
+
+#include <iostream>     //cout
+#include <string.h>     //memcpy()
+#include <sys/types.h>  //ssize_t
+
+#include "Multiplexer.h"
+#include "TransmissionQueue.h"
+
+using namespace std;
+
+#define MAXIMUM_REASSEMBLED_SDU_LENGTH MAXIMUM_PDU_LENGTH  //Maximum size of an SDU rebuilt from segments, in bytes
+
+/**
+ * @brief Rebuilds SDUs segmented by the Multiplexer on reception
+ * Segments of Data and Control SDUs of each source are reassembled separately, since they are ordered separately in PDUs.
+ * Segments keep their order, so there is only one SDU in reassembly for each source and D/C flag; if a segment is lost, its SDU is dropped.
+ * It is not thread-safe: it must be used only by the decoding thread
+ */
+class SduReassembler{
+private:
+    char* buffers[MAX_MAC_ADDRESSES][2];        //Buffer of SDU in reassembly for each source and D/C flag; allocated on its first segment
+    uint16_t sizes[MAX_MAC_ADDRESSES][2];       //Number of bytes already reassembled
+    bool inReassembly[MAX_MAC_ADDRESSES][2];    //True if an SDU is waiting for its next segments
+    bool verbose;                               //Verbosity flag
+
+public:
+    /**
+     * @brief Constructs a SduReassembler with no SDUs in reassembly
+     * @param _verbose Verbosity flag
+     */
+    SduReassembler(bool _verbose);
+
+    /**
+     * @brief Destroys SduReassembler and frees its buffers
+     */
+    ~SduReassembler();
+
+    /**
+     * @brief Adds an SDU or SDU segment received and returns SDU when it is complete
+     * @param segment Buffer containing SDU or segment
+     * @param size Size of SDU or segment in bytes
+     * @param flagDataControl Data(1)/Control(0) flag of SDU
+     * @param segmentationInfo Segmentation information of SDU, from MAC header
+     * @param sourceMac Source MAC Address
+     * @param sdu Pointer set to complete SDU: segment itself if it is not segmented; internal buffer valid until next call otherwise
+     * @returns Size of complete SDU; 0 if SDU is not complete yet or segment was dropped
+     */
+    ssize_t addSegment(char* segment, uint16_t size, uint8_t flagDataControl, uint8_t segmentationInfo, uint8_t sourceMac, char* & sdu);
+
+    /**
+     * @brief Drops SDUs in reassembly from a source, e.g. when PDUs carrying their next segments were lost
+     * @param sourceMac Source MAC Address
+     */
+    void dropIncomplete(uint8_t sourceMac);
+};
+#endif  //INCLUDED_SDU_REASSEMBLER_H
@@ -31,17 +31,28 @@ TransmissionQueue::TransmissionQueue(
     uint8_t _destinationAddress,    //Destination MAC Address
     int _maximumNumberSDUs,         //Maximum number of SDUs supported by a PDU
     bool _verbose)                  //Verbosity flag
+    : sealedPduCrc(CRC16_5GRANGE)
 {
-    maxNumberBytes = _maxNumberBytes;
-    buffer = new char[maxNumberBytes];
+    maxNumberBytes = _maxNumberBytes>MAXIMUM_PDU_LENGTH? MAXIMUM_PDU_LENGTH:_maxNumberBytes;
+    verbose = _verbose;
+
+    //All memory used for encoding is allocated here and only reused afterwards; buffers support largest PDU, so maxNumberBytes can grow later
+    bufferPool = new PduBufferPool(PDU_BUFFERS_PER_DESTINATION, MAXIMUM_PDU_LENGTH, verbose);
+    buffer = bufferPool->getBuffer();
+    bufferLength = 0;
+    sealedPdu = NULL;
+    sealedPduSize = 0;
     sourceAddress = _sourceAddress;
     destinationAddress = _destinationAddress;
     numberSDUs = 0;
-    controlOffset = 0;
+    numberControlSDUs = 0;
+    numberDataSDUs = 0;
     maximumNumberSDUs = _maximumNumberSDUs;
-    sizesSDUs = new uint16_t[maximumNumberSDUs];
-    flagsDataControl = new uint8_t[maximumNumberSDUs];
-    verbose = _verbose;
+    controlSdus = new SduReference[maximumNumberSDUs];
+    dataSdus = new SduReference[maximumNumberSDUs];
+    sizesSDUs = NULL;
+    flagsDataControl = NULL;
+    segmentationInfoSDUs = NULL;
 }
 
 TransmissionQueue::TransmissionQueue(
@@ -49,86 +60,73 @@ TransmissionQueue::TransmissionQueue(
     uint8_t _numberSDUs,                //Number of SDUs into PDU
     uint16_t* _sizesSDUs,               //Array of sizes of each SDU
     uint8_t* _flagsDataControl_SDUS,    //Array of Data/Control flags
+    uint8_t* _segmentationInfo_SDUS,    //Array of segmentation information
     bool _verbose)                      //Verbosity flag
+    : sealedPduCrc(CRC16_5GRANGE)
 {
     offset = 0;
+    positionBuffer = 0;
     buffer = _buffer;
     numberSDUs = _numberSDUs;
     sizesSDUs = _sizesSDUs;
     flagsDataControl = _flagsDataControl_SDUS;
+    segmentationInfoSDUs = _segmentationInfo_SDUS;
+    controlSdus = NULL;
+    dataSdus = NULL;
+    bufferPool = NULL;
     verbose = _verbose; 
 }
 
 TransmissionQueue::~TransmissionQueue(){
-    delete[] buffer;
+    //On encoding, buffer belongs to the pool; on decoding, it was allocated by ProtocolPackage
+    if(bufferPool!=NULL) delete bufferPool;
+    else delete[] buffer;
+    delete[] controlSdus;
+    delete[] dataSdus;
     delete[] sizesSDUs;
     delete[] flagsDataControl;
-}
-
-int 
-TransmissionQueue::currentBufferLength(){
-    int length = 0;
-    for(int i=0;i<numberSDUs;i++){
-        length += sizesSDUs[i];
-    }
-    return length;
+    delete[] segmentationInfoSDUs;
 }
 
 int TransmissionQueue::getNumberofBytes(){
-    int numberBytes = 0;
-    //Header length:
-    numberBytes = 2 + 2*numberSDUs;
-    numberBytes +=currentBufferLength();
-    return numberBytes;
+    //Header length plus SDUs length
+    return MAC_HEADER_LENGTH + 2*numberSDUs + bufferLength;
 }
 
 bool 
-TransmissionQueue::addSduPosition(
+TransmissionQueue::addSDU(
     char* sdu,                  //Buffer containing single SDU
     uint16_t size,              //SDU size
     uint8_t flagDataControl,    //SDU Data/Control flag
-    int position)               //Position in the queue where SDU will be added
+    uint8_t segmentationInfo)   //SDU segmentation information
 {
-    int bufferOffset = 0;                   //Buffer offset to manage copying arrays
-    int length = currentBufferLength();     //Current length of the queue
-
-    //Copying forward information already in queue
-    for(int i=numberSDUs-1;i>=position;i--){
-        sizesSDUs[i+1] = sizesSDUs[i];
-        flagsDataControl[i+1] = flagsDataControl[i];
-        bufferOffset+=sizesSDUs[i+1];
-    }
-    for(int i=(length-1);i>=(length-bufferOffset);i--){
-        buffer[i+size] = buffer[i];
+    //Verify if it is possible to insert SDU; larger SDUs must be segmented by the caller
+    if((size+2+getNumberofBytes())>maxNumberBytes || size>MAXIMUM_SEGMENT_LENGTH){
+        if(verbose) cout<<"[TransmissionQueue] Tried to multiplex SDU which size extrapolates maxNumberBytes."<<endl;
+        return false;
     }
 
-    //Implanting actual SDU
-    sizesSDUs[position] = size;
-    flagsDataControl[position] = flagDataControl;
-    for(int i=0;i<size;i++)
-        buffer[length-bufferOffset+i] = sdu[i];
+    //Append SDU bytes to buffer; its position in PDU is given only by the reference list it is added to
+    memcpy(buffer+bufferLength, sdu, size);
+    if(flagDataControl){
+        dataSdus[numberDataSDUs].position = bufferLength;
+        dataSdus[numberDataSDUs].size = size;
+        dataSdus[numberDataSDUs].segmentationInfo = segmentationInfo;
+        numberDataSDUs++;
+    }
+    else{
+        controlSdus[numberControlSDUs].position = bufferLength;
+        controlSdus[numberControlSDUs].size = size;
+        controlSdus[numberControlSDUs].segmentationInfo = segmentationInfo;
+        numberControlSDUs++;
+    }
+    bufferLength += size;
     numberSDUs++;
-    if(!flagDataControl) controlOffset++;
+
     if(verbose) cout<<"[TransmissionQueue] Multiplexed "<<(int)numberSDUs<<" SDUs into PDU."<<endl;
     return true;
 }
 
-bool 
-TransmissionQueue::addSDU(
-    char* sdu,                  //Buffer containing single SDU
-    uint16_t size,              //SDU size
-    uint8_t flagDataControl)    //SDU Data/Control flag
-{
-    //Verify if it is possible to insert SDU
-    if((size+2+getNumberofBytes())>maxNumberBytes){
-        if(verbose) cout<<"[TransmissionQueue] Tried to multiplex SDU which size extrapolates maxNumberBytes."<<endl;
-        exit(4);
-    }
-
-    //Adds SDU to position depending if it is Data or Control SDU
-    return flagDataControl? addSduPosition(sdu, size, flagDataControl, numberSDUs):addSduPosition(sdu, size, flagDataControl, controlOffset);
-}
-
 ssize_t 
 TransmissionQueue::getSDU(
     char* sdu)      //Buffer to store SDU
@@ -139,35 +137,128 @@ TransmissionQueue::getSDU(
         return -1;
     }
 
-    //Set an position offset to next SDU position in buffer
-    int positionBuffer = 0;
-    for(int i=0;i<offset;i++)
-        positionBuffer+=sizesSDUs[i];
-    
     //Copy SDU from buffer
-    for(int i=0;i<sizesSDUs[offset];i++)
-        sdu[i] = buffer[positionBuffer+i];
+    memcpy(sdu, buffer+positionBuffer, sizesSDUs[offset]);
     
-    //Increment decoding offset
+    //Increment decoding offset and position of next SDU
+    positionBuffer+=sizesSDUs[offset];
     offset++;
     if(verbose) cout<<"[TransmissionQueue] Demultiplexed SDU "<<offset<<endl;
     return sizesSDUs[offset-1];
 }
 
-ProtocolPackage* 
-TransmissionQueue::getPDUPackage(){
-    ProtocolPackage* pdu = new ProtocolPackage(sourceAddress, destinationAddress, numberSDUs, sizesSDUs, flagsDataControl, buffer, verbose);
-    return pdu;
+void
+TransmissionQueue::writeSduHeader(
+    char* header,               //Position of header to write
+    uint16_t size,              //SDU size
+    uint8_t flagDataControl,    //SDU Data/Control flag
+    uint8_t segmentationInfo)   //SDU segmentation information
+{
+    header[0] = (flagDataControl<<7)|((segmentationInfo&3)<<5)|((size>>8)&31);
+    header[1] = size&255;
+}
+
+ssize_t 
+TransmissionQueue::getPdu(
+    char* pdu,                      //Buffer to store PDU
+    CrcCalculator & crcCalculator)  //CRC calculator updated with PDU bytes
+{
+    char* header = pdu+MAC_HEADER_LENGTH;   //Position of next SDU header
+    char* payload = pdu+MAC_HEADER_LENGTH+2*numberSDUs;     //Position of next SDU bytes
+    int i;                                  //Auxiliary variable for loops
+
+    //Fills the 2 first slots
+    pdu[0] = (sourceAddress<<4)|(destinationAddress&15);
+    pdu[1] = numberSDUs;
+
+    //Sequence number is written by ARQ only when PDU is transmitted; ARQ corrects CRC then
+    pdu[SEQUENCE_NUMBER_OFFSET] = 0;
+    pdu[SEQUENCE_NUMBER_OFFSET+1] = 0;
+
+    //SDU headers come first in PDU: Control SDUs, then Data SDUs
+    for(i=0;i<numberControlSDUs;i++,header+=2)
+        writeSduHeader(header, controlSdus[i].size, 0, controlSdus[i].segmentationInfo);
+    for(i=0;i<numberDataSDUs;i++,header+=2)
+        writeSduHeader(header, dataSdus[i].size, 1, dataSdus[i].segmentationInfo);
+    crcCalculator.update(pdu, payload-pdu);
+
+    //Then SDU bytes in the same order, each one added to CRC while it is still in cache
+    for(i=0;i<numberControlSDUs;i++){
+        memcpy(payload, buffer+controlSdus[i].position, controlSdus[i].size);
+        crcCalculator.update(payload, controlSdus[i].size);
+        payload+=controlSdus[i].size;
+    }
+    for(i=0;i<numberDataSDUs;i++){
+        memcpy(payload, buffer+dataSdus[i].position, dataSdus[i].size);
+        crcCalculator.update(payload, dataSdus[i].size);
+        payload+=dataSdus[i].size;
+    }
+
+    if(verbose) cout<<"[TransmissionQueue] PDU assembled with MAC Header."<<endl;
+
+    return payload-pdu;
+}
+
+bool
+TransmissionQueue::sealPdu(){
+    //Only one PDU may be sealed at a time
+    if(sealedPdu!=NULL || numberSDUs==0)
+        return false;
+
+    //Assemble PDU in the other buffer of this destination
+    sealedPdu = bufferPool->getBuffer();
+    if(sealedPdu==NULL)
+        return false;
+    sealedPduCrc.reset();
+    sealedPduSize = getPdu(sealedPdu, sealedPduCrc);
+
+    //Start filling again from the beginning
+    bufferLength = 0;
+    numberSDUs = 0;
+    numberControlSDUs = 0;
+    numberDataSDUs = 0;
+
+    if(verbose) cout<<"[TransmissionQueue] PDU sealed: "<<sealedPduSize<<" bytes."<<endl;
+    return true;
+}
+
+bool
+TransmissionQueue::hasSealedPdu(){
+    return sealedPdu!=NULL;
+}
+
+char*
+TransmissionQueue::getSealedPdu(
+    ssize_t & size)     //Size of sealed PDU
+{
+    size = sealedPduSize;
+    return sealedPdu;
+}
+
+CrcCalculator
+TransmissionQueue::getSealedPduCrc(){
+    return sealedPduCrc;
+}
+
+void
+TransmissionQueue::releaseSealedPdu(){
+    if(sealedPdu==NULL) return;
+    bufferPool->returnBuffer(sealedPdu);
+    sealedPdu = NULL;
+    sealedPduSize = 0;
 }
 
 void 
 TransmissionQueue::clearBuffer(){
-    this->~TransmissionQueue();
-    buffer = new char[maxNumberBytes];
-    sizesSDUs = new uint16_t[maximumNumberSDUs];
-    flagsDataControl = new uint8_t[maximumNumberSDUs];
+    //Give buffer back to the pool and draw the next one; no memory is allocated
+    bufferPool->returnBuffer(buffer);
+    buffer = bufferPool->getBuffer();
+    bufferLength = 0;
+    sealedPdu = NULL;
+    sealedPduSize = 0;
     numberSDUs=0;
-    controlOffset = 0;
+    numberControlSDUs = 0;
+    numberDataSDUs = 0;
 }
 
 uint8_t 
@@ -175,6 +266,11 @@ TransmissionQueue::getCurrentDataControlFlag(){
     return flagsDataControl[offset-1];
 }
 
+uint8_t 
+TransmissionQueue::getCurrentSegmentationInfo(){
+    return segmentationInfoSDUs[offset-1];
+}
+
 uint8_t 
 TransmissionQueue::getDestinationAddress(){
     return destinationAddress;
@@ -8,46 +8,76 @@
 #define INCLUDED_TRANSMISSION_QUEUE_H
 
 #include <iostream>
+#include <string.h>     //memcpy()
 
 #include "../ProtocolPackage/ProtocolPackage.h"
 #include "MacAddressTable/MacAddressTable.h"
+#include "PduBufferPool.h"
+#include "../Crc/CrcCalculator.h"
 using namespace std;
 
+#define MAXIMUM_PDU_LENGTH 16384    //Maximum PDU length in bytes, i.e. size of each PDU buffer
+#define MAXIMUM_SEGMENT_LENGTH 8191 //Maximum length of an SDU or SDU segment in bytes (13 bits of MAC header)
+#define MINIMUM_SEGMENT_LENGTH 16   //Minimum length of a segment added to a non-empty PDU; less free space is left unused
+#define MAC_HEADER_LENGTH 4         //Bytes of MAC header before SDU headers: addresses, number of SDUs and ARQ sequence number
+#define SEQUENCE_NUMBER_OFFSET 2    //Position of ARQ sequence number (16 bits) in MAC header; zero if PDU is sent without ARQ
+
 //Predefinition of class ProtocolPackage 
 class ProtocolPackage;
 
+/**
+ * @brief Segmentation information of each SDU in MAC header (2 bits)
+ * Bit 1 is set if SDU does not start in this segment; bit 0 is set if SDU does not end in this segment
+ */
+enum SegmentationInfo {COMPLETE_SDU, FIRST_SEGMENT, LAST_SEGMENT, MIDDLE_SEGMENT};
+
+/**
+ * @brief Reference to an SDU stored in TransmissionQueue buffer
+ */
+typedef struct{
+    int position;               //Position of first byte of SDU in buffer
+    uint16_t size;              //SDU size in bytes
+    uint8_t segmentationInfo;   //Segmentation information of SDU
+} SduReference;
+
 /**
  * @brief Queue used to store SDUs that will be transmitted to a specific destination
+ * On encoding, SDU bytes are only appended to buffer; Control and Data SDUs are ordered by two separate lists of references,
+ * so inserting Control SDUs before Data SDUs never moves bytes and the PDU is assembled in a single gather pass
  */
 class TransmissionQueue{
 private:
-    char* buffer;                   //Buffer accumulates SDUs
+    char* buffer;                   //Buffer accumulates SDUs (in arrival order on encoding)
+    PduBufferPool* bufferPool;      //[Encoding] Preallocated buffers of this destination, from which buffer is drawn
+    char* sealedPdu;                //[Encoding] Complete PDU waiting to be sent while buffer is filled again; NULL if there is none
+    ssize_t sealedPduSize;          //[Encoding] Size of sealed PDU in bytes
+    CrcCalculator sealedPduCrc;     //[Encoding] CRC of sealed PDU, calculated while it was assembled
+    int bufferLength;               //[Encoding] Number of SDU bytes stored in buffer
     uint8_t sourceAddress;          //Source MAC address
     uint8_t destinationAddress;     //Destination MAC address
-    int offset;                     //Offset for decoding
-    int controlOffset;              //Offset for encoding Control SDUs
-    uint16_t* sizesSDUs;            //Sizes of each SDU multiplexed
-    uint8_t* flagsDataControl;      //Data(1)/Control(0) flag
+    int offset;                     //[Decoding] Index of next SDU
+    int positionBuffer;             //[Decoding] Position of next SDU in buffer
+    SduReference* controlSdus;      //[Encoding] References to Control SDUs, placed first in PDU
+    SduReference* dataSdus;         //[Encoding] References to Data SDUs, placed after Control SDUs in PDU
+    int numberControlSDUs;          //[Encoding] Number of Control SDUs multiplexed
+    int numberDataSDUs;             //[Encoding] Number of Data SDUs multiplexed
+    uint16_t* sizesSDUs;            //[Decoding] Sizes of each SDU multiplexed
+    uint8_t* flagsDataControl;      //[Decoding] Data(1)/Control(0) flag
+    uint8_t* segmentationInfoSDUs;  //[Decoding] Segmentation information of each SDU
     bool verbose;                   //Verbosity flag
     
     /**
-     * @brief Adds SDU to specific position of the multiplexing queue
-     * @param sdu Buffer containing single SDU
+     * @brief Writes 2 bytes of MAC header referring to one SDU
+     * @param header Position of header where information will be written
      * @param size SDU size
      * @param flagDataControl SDU D/C flag
-     * @param position Position where SDU will be added
-     * @returns True if SDU was inserted successfully; False otherwise
+     * @param segmentationInfo SDU segmentation information
      */
-    bool addSduPosition(char* sdu, uint16_t size, uint8_t flagDataControl, int position);  
-    
-    /**
-     * @brief Returns the current queue buffer length considering the size of each SDU
-     * @returns Current TransmissionQueue buffer length in bytes
-     */
-    int currentBufferLength();     
+    void writeSduHeader(char* header, uint16_t size, uint8_t flagDataControl, uint8_t segmentationInfo);
+
 public:
     uint8_t numberSDUs;     //Number of SDUs multiplexed
-    int maxNumberBytes;             //Maximum number of bytes
+    int maxNumberBytes;             //Maximum number of bytes (up to MAXIMUM_PDU_LENGTH)
     int maximumNumberSDUs;  //Maximum number of SDUs multiplexed
 
     /**
@@ -66,9 +96,10 @@ public:
      * @param _nSDUs Number of SDUs enqueued in PDU
      * @param _sizesSDUs Array with sizes of each SDU enqueued
      * @param _flagsDataControl_SDUS Array with Data/Control flags of each SDU
+     * @param _segmentationInfo_SDUS Array with segmentation information of each SDU
      * @param _verbose Verbosity flag
      */
-    TransmissionQueue(char* _buffer, uint8_t _nSDUs, uint16_t* _sizesSDUs, uint8_t* _flagsDataControl_SDUS, bool _verbose);
+    TransmissionQueue(char* _buffer, uint8_t _nSDUs, uint16_t* _sizesSDUs, uint8_t* _flagsDataControl_SDUS, uint8_t* _segmentationInfo_SDUS, bool _verbose);
     
     /**
      * @brief Destroy a TransmissionQueue object
@@ -76,18 +107,20 @@ public:
     ~TransmissionQueue();
 
     /**
-     * @brief Returns the total PDU length in bytes, considering extra overhead of 2 bytes (sourceAddress, destinationAddress, numSDUs)
+     * @brief Returns the total PDU length in bytes, considering extra overhead of MAC_HEADER_LENGTH bytes (sourceAddress, destinationAddress, numSDUs, sequence number)
+     * @returns PDU length in bytes, computed in constant time
      */
     int getNumberofBytes();
     
     /**
-     * @brief Adds SDU to the multiplexing queue
-     * @param sdu Buffer containing single SDU
-     * @param size SDU size
+     * @brief Adds SDU, or SDU segment, to the multiplexing queue
+     * @param sdu Buffer containing single SDU or segment
+     * @param size SDU or segment size, up to MAXIMUM_SEGMENT_LENGTH
      * @param flagDataControl SDU D/C flag
+     * @param segmentationInfo Segmentation information of the bytes added
      * @returns True if SDU was inserted successfully; False otherwise
      */     
-    bool addSDU(char* sdu, uint16_t size, uint8_t flagDataControl);
+    bool addSDU(char* sdu, uint16_t size, uint8_t flagDataControl, uint8_t segmentationInfo);
 
     /**
      * @brief Function used for getting SDUs while decoding
@@ -97,14 +130,47 @@ public:
     ssize_t getSDU(char* sdu);
     
     /**
-     * @brief Creates a new ProtocolPackage object based on information stored in class variables on encoding process
-     * @returns ProtocolPackage for the SDUs multiplexed
+     * @brief Assembles PDU, MAC header included, in a single pass over the SDUs multiplexed (Control SDUs first)
+     * CRC is updated with each piece as it is gathered, so PDU is not read again to calculate it
+     * @param pdu Buffer where PDU will be stored; must have at least getNumberofBytes() bytes
+     * @param crcCalculator CRC calculator updated with PDU bytes; sequence number is zero
+     * @returns Size of PDU in bytes
      * Requires clearing the buffer before using this TransmissionQueue again
      */
-    ProtocolPackage* getPDUPackage();
+    ssize_t getPdu(char* pdu, CrcCalculator & crcCalculator);
     
     /**
-     * @brief Clears the TransmissionQueue buffer; Make sure the PDU is sent before clearing the buffer
+     * @brief Assembles current SDUs into a sealed PDU, held in a second buffer, and clears queue to receive new SDUs
+     * @returns True if PDU was sealed; false if queue is empty or previous sealed PDU was not taken yet
+     */
+    bool sealPdu();
+
+    /**
+     * @brief Verifies if there is a sealed PDU waiting to be sent
+     * @returns True if there is a sealed PDU
+     */
+    bool hasSealedPdu();
+
+    /**
+     * @brief Gets sealed PDU without copying it; it must be released with releaseSealedPdu()
+     * @param size Variable where size of sealed PDU will be stored
+     * @returns Pointer to sealed PDU; NULL if there is none
+     */
+    char* getSealedPdu(ssize_t & size);
+
+    /**
+     * @brief Gets CRC calculator of sealed PDU, updated with its bytes when it was assembled
+     * @returns CRC calculator of sealed PDU
+     */
+    CrcCalculator getSealedPduCrc();
+
+    /**
+     * @brief Releases sealed PDU, giving its buffer back so the queue can be sealed again
+     */
+    void releaseSealedPdu();
+
+    /**
+     * @brief Clears the TransmissionQueue buffer, reusing preallocated memory; Make sure the PDU is sent before clearing the buffer
      */   
     void clearBuffer(); 
 
@@ -114,6 +180,12 @@ public:
      */
     uint8_t getCurrentDataControlFlag();
 
+    /**
+     * @brief Gets segmentation information of previous SDU to be used in decoding
+     * @returns Segmentation information for SDU immediately behind (it is supposed getSDU() has been used before) current SDU in decoding queue
+     */
+    uint8_t getCurrentSegmentationInfo();
+
     /**
      * @brief Gets destination MAC address of TransmissionQueue object
      * @returns Destination MAC address
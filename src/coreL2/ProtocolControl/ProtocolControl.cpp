@@ -40,42 +40,29 @@ ProtocolControl::enqueueControlSdus(
     size_t numberBytes,     //Size of MACC SDU in Bytes
     uint8_t macAddress)     //Destination MAC Address
 {
-    //Find index to identify the queue referring to this UE
-    int index;  //Index of destination UE in queues
-    if(!macController->flagBS)      //If it is UE, then it only has BS "attached"
-        index=0;
-    else{
-        index = macController->currentParameters->getIndex(macAddress);
-
-        if(index==-1){
-            if(verbose) cout<<"[ProtocolControl] Did not find MAC Address to send MACC SDU."<<endl;
-            exit(1);
-        }
+    //Find index to identify the queue referring to this UE (UE only has BS "attached", index 0)
+    int index = macController->mux->getTransmissionQueueIndex(macAddress);  //Index of destination UE in queues
+    if(index==-1){
+        if(verbose) cout<<"[ProtocolControl] Did not find MAC Address to send MACC SDU."<<endl;
+        exit(1);
     }
 
-    if(macController->mux->emptyPdu(macAddress))
-        	macController->queueConditionVariables[index].notify_all();     //index 0: UE has only BS as equipment
-
     char sduBuffer[MAXIMUM_BUFFER_LENGTH];   //Buffer to store SDU for futher transmission
 
     //Copy MACC SDU
     for(int i=0;i<numberBytes;i++)
         sduBuffer[i] = controlSdu[i];
     
-    //Lock Mutex
-    lock_guard<mutex> lk(macController->queueMutex);
-
-    //Try to add SDU to sending queue
-    int macSendingPDU = macController->mux->addSdu(sduBuffer, numberBytes, 0, macAddress);
-
-    //If addSdu returns -1, SDU was added successfully
-    if(macSendingPDU==-1) return;
-
-    //Else, queue is full. Need to send PDU
-    macController->sendPdu(macSendingPDU);
-
-    //Then, adds Sdu
-    macController->mux->addSdu(sduBuffer, numberBytes, 0, macAddress);
+    //Lock Mutex of destination queue
+    unique_lock<mutex> lk(macController->queueMutexes[index]);
+
+    //Try to add SDU to sending queue; if addSdu returns -1, SDU was added successfully
+    uint16_t sduOffset = 0;     //First byte of SDU not enqueued yet
+    while(macController->mux->addSdu(sduBuffer, numberBytes, 0, macAddress, sduOffset)>=0){
+        //Else, queue is full. Need to seal PDU for next subframe, then add remaining SDU segments
+        if(!macController->sealPdu(lk, index))
+            return;
+    }
 }
 
 void 
@@ -84,9 +71,23 @@ ProtocolControl::decodeControlSdus(
     size_t numberDecodingBytes,     //Size of Control SDU in Bytes
     uint8_t macAddress)             //Source MAC Address
 {
-    //If it is BS, it can receive ACKs or Rx Metrics
-    if(macController->flagBS){
-        if(numberDecodingBytes==3){     //It is an "ACK"
+    size_t pendingBytes;            //Bytes pending on UE, reported in BSR
+    allocation_cfg_t grant;         //Uplink grant sent by BS
+    uint16_t ackSequenceNumber;     //ARQ sequence number acknowledged by peer
+    vector<uint16_t> nacks;         //ARQ sequence numbers reported missing by peer
+
+    //Both BS and UE receive ARQ status reports of PDUs they sent
+    if(ArqEntity::deserializeStatusReport(buffer, numberDecodingBytes, ackSequenceNumber, nacks)){
+        macController->arq->receiveStatus(macController->mux->getTransmissionQueueIndex(macAddress), ackSequenceNumber, nacks);
+        if(verbose) cout<<"[ProtocolControl] ARQ status from MAC "<<(int) macAddress<<" received: "<<nacks.size()<<" PDUs missing."<<endl;
+    }
+    //If it is BS, it can receive ACKs, buffer status reports or Rx Metrics
+    else if(macController->flagBS){
+        if(UplinkScheduler::deserializeBufferStatusReport(buffer, numberDecodingBytes, pendingBytes)){     //It is a BSR
+            macController->uplinkScheduler->setPendingBytes(macController->currentParameters->getIndex(macAddress), pendingBytes);
+            if(verbose) cout<<"[ProtocolControl] BSR from UE "<<(int) macAddress<<" received: "<<pendingBytes<<" bytes pending."<<endl;
+        }
+        else if(numberDecodingBytes==3){     //It is an "ACK"
             string receivedString;      //String to be compared to "ACK"
 
             //Convert array received to string
@@ -95,6 +96,7 @@ ProtocolControl::decodeControlSdus(
             
             //Compare Strings
             if(receivedString=="ACK"){
+                macController->acknowledgeDynamicParameters(macAddress);
                 if(verbose) cout<<"[ProtocolControl] Received ACK from UE."<<endl;
             }
         }
@@ -111,11 +113,20 @@ ProtocolControl::decodeControlSdus(
             for(int i=0;i<numberDecodingBytes;i++)
                 rxMetricsBytes.push_back(buffer[i]);
 
-            //Deserialize Bytes
+            //Deserialize Bytes; scheduler and timer threads read metrics of UE concurrently
+            macController->rxMetrics[index].accessControl.lock();
             macController->rxMetrics[index].deserialize(rxMetricsBytes);
+            uint8_t cqiReport = macController->rxMetrics[index].cqiReport;     //CQI just reported
+            macController->rxMetrics[index].accessControl.unlock();
+            macController->restartSsReportTimer(index);
+
+            //PDUs to UE are sized with MCS derived from its new CQI
+            int queueIndex = macController->mux->getTransmissionQueueIndex(macAddress);
+            if(queueIndex!=-1)
+                macController->updatePduSize(queueIndex);
 
             //Calculate new DLMCS
-            macController->cliL2Interface->dynamicParameters->setMcsDownlink(macAddress,AdaptiveModulationCoding::getCqiConvertToMcs(macController->rxMetrics[index].cqiReport));
+            macController->cliL2Interface->dynamicParameters->setMcsDownlink(macAddress,AdaptiveModulationCoding::getCqiConvertToMcs(cqiReport));
 
             if(verbose){
                 cout<<"[ProtocolControl] RxMetrics from UE "<<(int) macAddress<<" received.";
@@ -123,25 +134,24 @@ ProtocolControl::decodeControlSdus(
             }
         }   
     }
+    else if(UplinkScheduler::deserializeUplinkGrant(buffer, numberDecodingBytes, grant)){     //UE received a new uplink grant
+        macController->applyUplinkGrant(grant);
+    }
     else{    //UE needs to set its Dynamic Parameters and return ACK to BS
         macController->managerDynamicParameters((uint8_t*) buffer, numberDecodingBytes);
         if(verbose) cout<<"[ProtocolControl] UE Configured correctly. Returning ACK to BS..."<<endl;
 
         // ACK
-        if(macController->mux->emptyPdu(0))
-        	macController->queueConditionVariables[0].notify_all();     //index 0: UE has only BS as equipment
-
         char ackBuffer[3] = {'A', 'C', 'K'};
-        lock_guard<mutex> lk(macController->queueMutex);
-        int macSendingPDU = macController->mux->addSdu(ackBuffer, 3, 0,0);
+        unique_lock<mutex> lk(macController->queueMutexes[0]);     //index 0: UE has only BS as equipment
 
         //If addSdu returns -1, SDU was added successfully
-        if(macSendingPDU==-1) return;
-
-        //Else, queue is full. Need to send PDU
-        macController->sendPdu(macSendingPDU);
-
-        macController->mux->addSdu(ackBuffer, 3, 0, 0);
+        uint16_t sduOffset = 0;     //First byte of SDU not enqueued yet
+        while(macController->mux->addSdu(ackBuffer, 3, 0, 0, sduOffset)>=0){
+            //Else, queue is full. Need to seal PDU for next subframe
+            if(!macController->sealPdu(lk, 0))
+                return;
+        }
     }    
 }
 
@@ -162,6 +172,8 @@ ProtocolControl::receiveInterlayerMessages(
     string message;                     //String containing message converted from char*
     uint8_t cqi;                        //Channel Quality information based on SINR measurement from PHY
     uint8_t sourceMacAddress;           //Source MAC Address
+    bool crcError;                      //Flag indicating PDU received was dropped due to CRC error
+    uint64_t seenModeChanges = 0;       //Number of MAC mode changes this thread has seen
 
     //Control message stream
     while(currentMacMode!=STOP_MODE){
@@ -170,6 +182,10 @@ ProtocolControl::receiveInterlayerMessages(
             //Change system Rx mode to ACTIVE_MODE_RX
             currentMacRxMode = ACTIVE_MODE_RX; 
 
+            //Sleep until L1 sends a Control message; timeout lets MAC mode be reevaluated
+            if(!macController->l1l2Interface->waitForControlMessage(CONTROL_MESSAGES_WAIT_TIMEOUT))
+                continue;
+
             //Receive Control message
             ssize_t messageSize = macController->l1l2Interface->receiveControlMessage(buffer, MAXIMUM_BUFFER_LENGTH);
 
@@ -199,8 +215,9 @@ ProtocolControl::receiveInterlayerMessages(
                 //Perform channel quality information calculation and uplink MCS calculation
                 cqi = LinkAdaptation::getSinrConvertToCqi(messageParametersBS.sinr);
 
-                //Receive source MAC Address from decoding function
-                sourceMacAddress = macController->decoding();
+                //Receive source MAC Address from decoding function and feed CRC result back to UE
+                sourceMacAddress = macController->decoding(crcError);
+                macController->sendHarqFeedback(messageParametersBS.ueId, messageParametersBS.harqProcess, !crcError);
 
                 //Calculates new UL MCS and sets it
                 macController->cliL2Interface->dynamicParameters->setMcsUplink(sourceMacAddress, AdaptiveModulationCoding::getCqiConvertToMcs(cqi));
@@ -223,17 +240,32 @@ ProtocolControl::receiveInterlayerMessages(
                 macController->rxMetrics->pmi = messageParametersUE.pmi;
                 macController->rxMetrics->ri = messageParametersUE.ri;
                 macController->rxMetrics->accessControl.unlock();   //Unlock Mutex
-                macController->decoding();
+                macController->decoding(crcError);
+                macController->sendHarqFeedback(macController->currentParameters->getMacAddress(0), messageParametersUE.harqProcess, !crcError);
             }
 
-            //Clear buffer and message and receive next control message
+            //L1 reports ACK/NACK of a transport block sent: BS identifies destination by UE; UE only transmits to BS
+            if(message.compare(0, 12, "HarqFeedback")==0){
+                HarqFeedback feedback;      //Define struct for feedback parameters
+                for(int i=12;i<messageSize;i++)
+                    messageParametersBytes.push_back(buffer[i]);
+                feedback.deserialize(messageParametersBytes);
+
+                int index = macController->flagBS? macController->mux->getTransmissionQueueIndex(feedback.ueId):0;
+                if(verbose) cout<<"[ProtocolControl] Received HARQ "<<(feedback.ack? "ACK":"NACK")<<" of process "<<(int)feedback.harqProcess<<"."<<endl;
+                macController->harq->receiveFeedback(index, feedback.harqProcess, feedback.ack!=0);
+            }
+
+            //Clear buffer and message; next control message is received on next iteration
             bzero(buffer, MAXIMUM_BUFFER_LENGTH);
             message.clear();
-            messageSize = macController->l1l2Interface->receiveControlMessage(buffer, MAXIMUM_BUFFER_LENGTH);
         }
         else{
             //Change MAC Rx Mode to DISABLED_MODE_RX
             currentMacRxMode = DISABLED_MODE_RX;
+
+            //Block until MAC mode changes
+            macController->waitForModeChange(CONTROL_MESSAGES_WAIT_TIMEOUT, seenModeChanges);
         }
     }
 
@@ -7,6 +7,8 @@
 #ifndef INCLUDED_PROTOCOL_CONTROL_H
 #define INCLUDED_PROTOCOL_CONTROL_H
 
+#define CONTROL_MESSAGES_WAIT_TIMEOUT 100   //Maximum time(ms) blocked waiting for Control messages from L1 before reevaluating MAC mode
+
 #include <iostream>
 #include <mutex>
 #include <condition_variable>
@@ -65,6 +67,7 @@ public:
 
     /**
      * @brief Perform reception of Interlayer Control Messages from PHY and decides what to do
+     * Thread sleeps while PHY sends no message and, outside IDLE_MODE, until MAC mode changes.
      * @param currentMacMode Actual MAC Mode to control enqueueing while system is in another modes, e.g. RECONFIG_MODE or STOP_MODE
      * @param currentMacRxMode Actual MAC Rx Mode to signal to system if it is in an active mode, e.g. ACTIVE_MODE_RX
      */
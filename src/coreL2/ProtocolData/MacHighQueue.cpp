@@ -25,100 +25,249 @@ UA : 1230 - Centro de Competencia - Sistemas Embarcados
 
 #include "MacHighQueue.h"
 
+#include <stdlib.h>     //posix_memalign(), free(), exit()
+#include <new>          //placement new
+
+MacHighQueue::MacHighQueue(
+    ReceptionProtocol* _reception,  //Object to receive packets from L3
+    bool _verbose)                  //Verbosity flag
+    : MacHighQueue(_reception, 1, _verbose) { }
+
 MacHighQueue::MacHighQueue(
     ReceptionProtocol* _reception,  //Object to receive packets from L3
+    int _numberQueues,              //Number of TUN queues
     bool _verbose)                  //Verbosity flag
 {
     reception = _reception;
+    numberQueues = _numberQueues;
     verbose = _verbose;
+
+    //All slots are allocated here, so reading and dequeueing do not allocate memory
+    //Rings keep producer and consumer indexes in separate cache lines, so C++14 new cannot be used to place them
+    rings = new SduRingBuffer*[numberQueues];
+    discardBuffers = new char*[numberQueues];
+    for(int i=0;i<numberQueues;i++){
+        void* ringMemory;       //Cache-aligned memory for ring object
+        if(posix_memalign(&ringMemory, alignof(SduRingBuffer), sizeof(SduRingBuffer))!=0){
+            perror("[MacHighQueue] Error allocating SDU ring");
+            exit(1);
+        }
+        rings[i] = new (ringMemory) SduRingBuffer(MAC_HIGH_QUEUE_SLOTS, MAXIMUM_BUFFER_LENGTH);
+        discardBuffers[i] = new char[MAXIMUM_BUFFER_LENGTH];
+    }
+    currentReadQueue = 0;
+    numberActiveReaders = 0;
+    consumerWaiting = false;
+    modeChanges = 0;
 }
 
 MacHighQueue::~MacHighQueue(){
-    while(queue.size()>0){
-        char* buffer = queue.front();
-        delete [] buffer;
-        queue.erase(queue.begin());
-        sizes.erase(sizes.begin());
+    for(int i=0;i<numberQueues;i++){
+        rings[i]->~SduRingBuffer();
+        free(rings[i]);
+        delete [] discardBuffers[i];
+    }
+    delete [] rings;
+    delete [] discardBuffers;
+}
+
+bool
+MacHighQueue::acceptPacket(
+    char* buffer)       //Buffer containing L3 packet
+{
+    uint8_t* packet = (uint8_t*) buffer;    //Unsigned view of packet to compare addresses
+
+    //Check ipv4
+    if(((packet[0]>>4)&15) != 4){
+        if(verbose) cout<<"[MacHighQueue] Dropped non-ipv4 packet."<<endl;
+        return false;
+    }
+
+    //Check broadcast
+    if((packet[DST_OFFSET]==255)&&(packet[DST_OFFSET+1]==255)&&(packet[DST_OFFSET+2]==255)&&(packet[DST_OFFSET+3]==255)){
+        if(verbose) cout<<"[MacHighQueue] Dropped broadcast packet."<<endl;
+        return false;
     }
- }
+
+    //Check multicast
+    if((packet[DST_OFFSET]>=224)&&(packet[DST_OFFSET]<=239)){
+        if(verbose) cout<<"[MacHighQueue] Dropped multicast packet."<<endl;
+        return false;
+    }
+
+    return true;
+}
 
 void 
 MacHighQueue::reading(
     MacModes & currentMacMode,          //Current MAC execution mode
-    MacTunModes & currentMacTunMode)    //Current MAC execution Tun mode
+    MacTunModes & currentMacTunMode,    //Current MAC execution Tun mode
+    int queue)                          //Index of TUN queue read by this thread
 {
     char *buffer;
     ssize_t numberBytesRead = 0;
+    int numberPacketsBatch;             //Number of packets enqueued after a single wake up
+    bool endOfTransmission = false;     //Flag indicating TUN interface reached EOF
+    SduRingBuffer* ring = rings[queue]; //Ring fed exclusively by this thread
     
     //Mark current MAC Tun mode as ENABLED for reading TUN interface and enqueueing Data SDUs.
+    numberActiveReaders++;
     currentMacTunMode = TUN_ENABLED;
 
     //Loop will execute until STOP mode is activated
-    while(currentMacMode!=STOP_MODE){
-        //Allocate buffer
-        buffer = new char[MAXIMUM_BUFFER_LENGTH];
-        bzero(buffer, MAXIMUM_BUFFER_LENGTH);
+    while(currentMacMode!=STOP_MODE && !endOfTransmission){
+        //Block until there are packets in TUN Interface queue
+        if(!reception->waitPackageFromL3(TUN_WAIT_TIMEOUT, queue))
+            continue;
 
-        //Read from TUN Interface
-        numberBytesRead = reception->receivePackageFromL3(buffer, MAXIMUM_BUFFER_LENGTH);
+        //Drain all packets available in TUN Interface queue
+        numberPacketsBatch = 0;
+        while(true){
+            //Get next free slot; if queue is full, packet is read anyway to be dropped
+            buffer = ring->getWriteSlot();
+            if(buffer==NULL)
+                buffer = discardBuffers[queue];
 
-        //Check if there is actually information received
-        if(numberBytesRead<0){
-        	delete [] buffer;
-            continue;
-        }
+            //Read from TUN Interface directly into the slot
+            numberBytesRead = reception->receivePackageFromL3(buffer, MAXIMUM_BUFFER_LENGTH, queue);
+
+            //Check if there is actually information received; if not, TUN Interface is drained
+            if(numberBytesRead<0)
+                break;
 
-        else
-        {
-            //Lock to write in the queue
-            lock_guard<mutex> lk(tunMutex);
-            
             //Check EOF
             if(numberBytesRead==0){
                 if(verbose) cout<<"[MacHighQueue] End of Transmission."<<endl;
-                delete [] buffer;
-            	break;
+                endOfTransmission = true;
+                break;
             }
 
-            //Check ipv4
-            if(((buffer[0]>>4)&15) != 4){
-                if(verbose) cout<<"[MacHighQueue] Dropped non-ipv4 packet."<<endl;
-                delete [] buffer;
+            //Check if packet is IPv4 unicast
+            if(!acceptPacket(buffer))
                 continue;
-            }
 
-            //Check broadcast
-            if((buffer[DST_OFFSET]==255)&&(buffer[DST_OFFSET+1]==255)&&(buffer[DST_OFFSET+2]==255)&&(buffer[DST_OFFSET+3]==255)){
-                if(verbose) cout<<"[MacHighQueue] Dropped broadcast packet."<<endl;
-                delete [] buffer;
+            //Check if queue was full
+            if(buffer==discardBuffers[queue]){
+                ring->countDrop();
+                if(verbose) cout<<"[MacHighQueue] Dropped packet: queue is full."<<endl;
                 continue;
             }
+                
+            //Everything is ok, slot can be published to the consumer
+            ring->commitWrite(numberBytesRead);
+            numberPacketsBatch++;
 
-            //Check multicast
-            if((buffer[DST_OFFSET]>=224)&&(buffer[DST_OFFSET]<=239)){
-                if(verbose) cout<<"[MacHighQueue] Dropped multicast packet."<<endl;
-                delete [] buffer;
-                continue;
+            //Under sustained load TUN may never be drained, so consumer is also notified periodically
+            if(numberPacketsBatch==TUN_NOTIFY_PERIOD){
+                notifyConsumer();
+                numberPacketsBatch = 0;
             }
-            
-            //Everything is ok, buffer can be added to queue
-            queue.push_back(buffer);
-            sizes.push_back(numberBytesRead);
-            if(verbose) cout<<"[MacHighQueue] SDU added to Queue. Num SDUs: "<<queue.size()<<endl;
+            if(verbose) cout<<"[MacHighQueue] SDU added to Queue "<<queue<<". Num SDUs: "<<ring->getDepth()<<endl;
         }
+
+        //Wake consumer once for the rest of the batch
+        if(numberPacketsBatch>0)
+            notifyConsumer();
     }
 
     if(verbose) cout<<"[MacHighQueue] Entering STOP_MODE."<<endl;
 
-    //Mark current MAC Tun mode as DISABLED for reading TUN interface and enqueueing Data SDUs.
-    currentMacTunMode = TUN_DISABLED;
+    //Mark current MAC Tun mode as DISABLED for reading TUN interface and enqueueing Data SDUs when last reader stops.
+    if(--numberActiveReaders==0)
+        currentMacTunMode = TUN_DISABLED;
+}
+
+void
+MacHighQueue::notifyConsumer(){
+    //Guarantees slot publication is visible before reading the waiting flag
+    atomic_thread_fence(memory_order_seq_cst);
+
+    //Mutex is only taken if consumer is actually blocked
+    if(consumerWaiting.load(memory_order_relaxed)){
+        lock_guard<mutex> lk(wakeUpMutex);
+        wakeUpConditionVariable.notify_one();
+    }
+}
+
+bool
+MacHighQueue::waitForSdus(
+    int timeout,                    //Maximum waiting time in milliseconds
+    uint64_t & seenModeChanges)     //Number of mode changes already seen by calling thread
+{
+    //Fast path: there are SDUs already
+    if(getNumberPackets()>0)
+        return true;
+
+    unique_lock<mutex> lk(wakeUpMutex);
+    consumerWaiting.store(true, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    //Wait until producers publish a slot or mode changes
+    wakeUpConditionVariable.wait_for(lk, chrono::milliseconds(timeout), [&]{ return getNumberPackets()>0 || modeChanges!=seenModeChanges; });
+    consumerWaiting.store(false, memory_order_relaxed);
+    seenModeChanges = modeChanges;
+
+    return getNumberPackets()>0;
+}
+
+void
+MacHighQueue::waitForModeChange(
+    int timeout,                    //Maximum waiting time in milliseconds
+    uint64_t & seenModeChanges)     //Number of mode changes already seen by calling thread
+{
+    unique_lock<mutex> lk(wakeUpMutex);
+    wakeUpConditionVariable.wait_for(lk, chrono::milliseconds(timeout), [&]{ return modeChanges!=seenModeChanges; });
+    seenModeChanges = modeChanges;
+}
+
+void
+MacHighQueue::notifyModeChange(){
+    lock_guard<mutex> lk(wakeUpMutex);
+    modeChanges++;
+    wakeUpConditionVariable.notify_all();
 }
 
 int 
 MacHighQueue::getNumberPackets(){
-    //Lock mutex to consult queue size information
-    lock_guard<mutex> lk(tunMutex);
-    return (int)queue.size();
+    int numberPackets = 0;     //Sum of depths of all rings
+    for(int i=0;i<numberQueues;i++)
+        numberPackets += rings[i]->getDepth();
+    return numberPackets;
+}
+
+int
+MacHighQueue::getNumberQueues(){
+    return numberQueues;
+}
+
+size_t
+MacHighQueue::getNumberBytes(
+    int queue)      //Index of TUN queue
+{
+    return rings[queue]->getNumberBytes();
+}
+
+char*
+MacHighQueue::getNextSduPointer(
+    ssize_t & size)     //Size of SDU
+{
+    char* slot;         //Slot containing SDU
+
+    //Visit rings in round-robin, starting from the one after last ring read
+    for(int i=1;i<=numberQueues;i++){
+        int queue = (currentReadQueue+i)%numberQueues;
+        slot = rings[queue]->getReadSlot(size);
+        if(slot!=NULL){
+            currentReadQueue = queue;
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+void
+MacHighQueue::releaseSdu(){
+    rings[currentReadQueue]->releaseRead();
 }
 
 ssize_t 
@@ -127,26 +276,31 @@ MacHighQueue::getNextSdu(
 {          
     ssize_t returnValue;   //Return value
 
-    //Lock mutex to remove SDU from the head of the queue
-    lock_guard<mutex> lk(tunMutex);
-    if(queue.size()==0){
+    //Get SDU at the head of the queue
+    char* slot = getNextSduPointer(returnValue);
+    if(slot==NULL){
         if(verbose) cout<<"[MacHighQueue] Tried to get empty SDU from L3."<<endl;
         return -1;
     }
 
-    //Get front values from the vectors
-    returnValue = sizes.front();
-    char* buffer2 = queue.front();
-    for(int i=0;i<sizes.front();i++)
-        buffer[i] = buffer2[i];           //Copying
-    
-    delete [] buffer2;
-
-    //Delete front positions
-    queue.erase(queue.begin());
-    sizes.erase(sizes.begin());
+    //Copy SDU and give slot back to reading thread
+    memcpy(buffer, slot, returnValue);
+    releaseSdu();
 
     if(verbose) cout<<"[MacHighQueue] Got SDU from L3 queue."<<endl;
 
     return returnValue;
 }
+
+uint64_t
+MacHighQueue::getNumberDroppedPackets(){
+    uint64_t numberDropped = 0;     //Sum of drops of all rings
+    for(int i=0;i<numberQueues;i++)
+        numberDropped += rings[i]->getNumberDropped();
+    return numberDropped;
+}
+
+uint32_t
+MacHighQueue::getCapacity(){
+    return numberQueues*rings[0]->getCapacity();
+}
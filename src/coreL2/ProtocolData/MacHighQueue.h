@@ -7,13 +7,19 @@
 #ifndef MAC_HIGH_QUEUE_H
 #define MAC_HIGH_QUEUE_H
 
-#include <vector>
-#include <mutex>
+#include <mutex>                //std::mutex
+#include <condition_variable>   //std::condition_variable
+#include <chrono>               //std::chrono::milliseconds
+#include <stdint.h>             //uint64_t
+#include "SduRingBuffer.h"
 #include "../ReceptionProtocol/ReceptionProtocol.h"
 #include "../../common/libMac5gRange/libMac5gRange.h"
 
 #define MAXIMUM_BUFFER_LENGTH 2048    //Maximum buffer size
 #define DST_OFFSET 16
+#define MAC_HIGH_QUEUE_SLOTS 1024     //Number of preallocated slots of MacHighQueue ring
+#define TUN_WAIT_TIMEOUT 100          //Maximum time(ms) blocked waiting for TUN packets before reevaluating MAC mode
+#define TUN_NOTIFY_PERIOD 32          //Number of packets drained from TUN between consumer notifications under sustained load
 
 using namespace std;
 
@@ -23,11 +29,29 @@ using namespace std;
 class MacHighQueue{
 private:
     ReceptionProtocol* reception;   //Object to receive packets from L3
-    vector<char*> queue;            //Vector of L3 packets
-    vector<ssize_t> sizes;          //Vector containing size of each packet
-    mutex tunMutex;                 //Mutex to control access to queue
+    int numberQueues;               //Number of TUN queues, each one read by its own thread
+    SduRingBuffer** rings;          //Lock-free rings of L3 packets (one per TUN queue) between TUN reading threads and ProtocolData
+    char** discardBuffers;          //Buffers used to drain each TUN queue when its ring is full
+    int currentReadQueue;           //[Consumer] Index of ring from which last SDU was got
+    atomic<int> numberActiveReaders;//Number of TUN reading threads currently executing
+    mutex wakeUpMutex;              //Mutex used only to block/wake consumer thread (never on fast path)
+    condition_variable wakeUpConditionVariable; //Condition variable notified on enqueueing and on MAC mode changes
+    atomic<bool> consumerWaiting;   //Flag indicating consumer is blocked and needs notification
+    uint64_t modeChanges;           //Number of MAC mode changes notified; each waiting thread keeps the number it has seen
     bool verbose;                   //Verbosity flag
 
+    /**
+     * @brief Wakes consumer thread if it is blocked waiting
+     */
+    void notifyConsumer();
+
+    /**
+     * @brief Verifies if packet read from TUN must be enqueued (IPv4 unicast only)
+     * @param buffer Buffer containing L3 packet
+     * @returns True if packet is accepted; false if it must be dropped
+     */
+    bool acceptPacket(char* buffer);
+
 public:
     /**
      * @brief Constructs an empty MacHighQueue with a TUN descriptor
@@ -35,6 +59,14 @@ public:
      * @param _verbose Verbosity flag 
      */
     MacHighQueue(ReceptionProtocol* _reception, bool _verbose);
+
+    /**
+     * @brief Constructs an empty MacHighQueue with one ring for each TUN queue
+     * @param _reception Object to receive packets from L3
+     * @param _numberQueues Number of TUN queues
+     * @param _verbose Verbosity flag 
+     */
+    MacHighQueue(ReceptionProtocol* _reception, int _numberQueues, bool _verbose);
     
     /**
      * @brief Destroys MacHighQueue
@@ -42,23 +74,83 @@ public:
     ~MacHighQueue();
     
     /**
-     * @brief Procedure that executes forever, receiving packets from L3 and storing them in the queue
+     * @brief Procedure that executes forever, receiving packets from one TUN queue and storing them in its ring
      * @param currentMacMode Actual MAC Mode to control enqueueing while system is in another modes, e.g. RECONFIG_MODE or STOP_MODE
      * @param currentMacTunMode Actual MAC Tun Mode to signal to system if it is in an active mode, e.g. TUN_DISABLED
+     * @param queue Index of TUN queue read by this thread
      */
-    void reading(MacModes & currentMacMode, MacTunModes & currentMacTunMode);
+    void reading(MacModes & currentMacMode, MacTunModes & currentMacTunMode, int queue);
     
     /**
      * @brief Gets number of packets that are currently enqueued
      * @returns Number of packets enqueued
      */
     int getNumberPackets();
+
+    /**
+     * @brief Gets number of TUN queues
+     * @returns Number of queues
+     */
+    int getNumberQueues();
+
+    /**
+     * @brief Gets number of bytes of packets currently enqueued from one TUN queue
+     * @param queue Index of TUN queue
+     * @returns Number of bytes
+     */
+    size_t getNumberBytes(int queue);
     
+    /**
+     * @brief Blocks until there are SDUs enqueued, MAC mode changes or timeout expires
+     * @param timeout Maximum waiting time in milliseconds
+     * @param seenModeChanges Number of mode changes already seen by calling thread; updated on return
+     * @returns True if there are SDUs enqueued; false otherwise
+     */
+    bool waitForSdus(int timeout, uint64_t & seenModeChanges);
+
+    /**
+     * @brief Blocks until MAC mode changes or timeout expires, regardless of SDUs enqueued
+     * Changes notified after calling thread last returned are not missed, whichever thread is woken first
+     * @param timeout Maximum waiting time in milliseconds
+     * @param seenModeChanges Number of mode changes already seen by calling thread; updated on return
+     */
+    void waitForModeChange(int timeout, uint64_t & seenModeChanges);
+
+    /**
+     * @brief Wakes threads blocked in waitForSdus() or waitForModeChange() to reevaluate MAC mode
+     */
+    void notifyModeChange();
+
+    /**
+     * @brief Gets next SDU on queue without copying it; SDU must be released with releaseSdu()
+     * TUN queues are visited in round-robin, so order of packets of each queue (i.e. of each flow) is preserved
+     * @param size Variable where size of SDU will be stored
+     * @returns Pointer to SDU; NULL if queue is empty
+     */
+    char* getNextSduPointer(ssize_t & size);
+
+    /**
+     * @brief Releases SDU got with getNextSduPointer()
+     */
+    void releaseSdu();
+
     /**
      * @brief Gets next SDU on queue for treatment
      * @param buffer Buffer were SDU will be stored
      * @returns Size of SDU
      */
     ssize_t getNextSdu(char* buffer);
+
+    /**
+     * @brief Gets number of packets dropped because queue was full
+     * @returns Number of packets dropped
+     */
+    uint64_t getNumberDroppedPackets();
+
+    /**
+     * @brief Gets maximum number of packets that can be enqueued
+     * @returns Queue capacity
+     */
+    uint32_t getCapacity();
 };
 #endif  //MAC_HIGH_QUEUE_H
\ No newline at end of file
@@ -42,8 +42,12 @@ ProtocolData::enqueueDataSdus(
     MacTxModes & currentMacTxMode)      //Current MAC execution Tx mode 
 {
     int macSendingPDU;                      //This auxiliary variable will store MAC Address if queue is full of SDUs
-    char bufferData[MAXIMUM_BUFFER_LENGTH]; //Buffer to store Data Bytes
+    int queueIndex;                         //Index of Multiplexer queue (and condition variable) of SDU destination
+    char* bufferData;                       //Pointer to Data SDU in MacHigh Queue
     ssize_t numberBytesRead = 0;            //Size of MACD SDU read in Bytes
+    int numberSdusBatch;                    //Number of SDUs enqueued in current batch
+    uint16_t sduOffset;                     //First byte of SDU not enqueued yet (SDU segmentation)
+    uint64_t seenModeChanges = 0;           //Number of MAC mode changes this thread has seen
     
     //Data SDUs stream
     while(currentMacMode!=STOP_MODE){
@@ -52,53 +56,52 @@ ProtocolData::enqueueDataSdus(
             //Change system Tx mode to ACTIVE_MODE_TX
             currentMacTxMode = ACTIVE_MODE_TX; 
 
-            //Test if MacHigh Queue is not empty, i.e. there are SDUs to enqueue
-            if(macHigh->getNumberPackets()){
-
-                //Fulfill bufferData with zeros 
-                bzero(bufferData, MAXIMUM_BUFFER_LENGTH);
-
-                //Gets next SDU from MACHigh Queue
-                numberBytesRead = macHigh->getNextSdu(bufferData);
-
-                //If multiplexer queue is empty, notify condition variable to trigger timeout timer
-                if(!macController->currentParameters->isBaseStation()){    //If UE, test if its (unique) queue to BS is empty, then notify condition variables
-                    if(macController->mux->emptyPdu(0))
-                        macController->queueConditionVariables[0].notify_all();
-                }
-                else{
-                    //If BS, find which Condition Variable corresponds to the UE MAC Address
-                    for(int i=0;i<macController->currentParameters->getNumberUEs();i++){
-                        if(macController->currentParameters->getMacAddress(i)==macController->mux->getMacAddress(bufferData)){
-                            if(macController->mux->emptyPdu(macController->currentParameters->getMacAddress(i))){
-                                macController->queueConditionVariables[i].notify_all();
-                            }
-                            else break;
-                        }
-                    }
+            //Block until MacHigh Queue is not empty, i.e. there are SDUs to enqueue, or MAC mode changes
+            if(!macHigh->waitForSdus(DATA_SDUS_WAIT_TIMEOUT, seenModeChanges))
+                continue;
+
+            //Drain MacHigh Queue in batches
+            for(numberSdusBatch=0;numberSdusBatch<DATA_SDUS_BATCH_SIZE;numberSdusBatch++){
+                //Gets next SDU from MACHigh Queue without copying it
+                bufferData = macHigh->getNextSduPointer(numberBytesRead);
+                if(bufferData==NULL)
+                    break;
+
+                //Classify SDU only once: destination MAC Address and index of its queue (same index of its condition variable and mutex)
+                queueIndex = macController->mux->getTransmissionQueueIndex(macController->mux->getMacAddress(bufferData));
+                if(queueIndex==-1){
+                    if(verbose) cout<<"[ProtocolData] Dropped SDU: no TransmissionQueue to its destination."<<endl;
+                    macHigh->releaseSdu();
+                    continue;
                 }
 
-                //Locks mutex to write in Multiplexer queue
-                lock_guard<mutex> lk(macController->queueMutex);
-                
-                //Adds SDU to multiplexer
-                macSendingPDU = macController->mux->addSdu(bufferData, numberBytesRead);
+                //Locks only the mutex of destination queue
+                unique_lock<mutex> lk(macController->queueMutexes[queueIndex]);
 
-                //If the SDU was added successfully, continues the loop
-                if(macSendingPDU==-1)
-                    continue;
+                //Adds SDU to multiplexer; SDU is segmented if it does not fit in the PDU
+                sduOffset = 0;
+                while((macSendingPDU = macController->mux->addSduIndex(bufferData, numberBytesRead, 1, queueIndex, sduOffset))>=0){
+                    //Queue is full: seal PDU for next subframe, without waiting for L1; then add remaining bytes
+                    if(!macController->sealPdu(lk, queueIndex))
+                        break;
+                }
+                lk.unlock();
 
-                //Else, macSendingPDU contains the Transmission Queue destination MAC to perform PDU sending. 
-                //So, perform PDU sending
-                macController->sendPdu(macSendingPDU);
+                //Segments already enqueued are dropped by the receiver, which never gets the last one; only MAC stopping or PDU size
+                //dropping below a segment while the PDU was sealed leaves an SDU this way
+                if(verbose && sduOffset>0 && sduOffset<numberBytesRead)
+                    cout<<"[ProtocolData] SDU truncated: "<<sduOffset<<" of "<<numberBytesRead<<" bytes enqueued."<<endl;
 
-                //Now, it is possible to add SDU to queue
-                macController->mux->addSdu(bufferData,numberBytesRead);
+                //Give SDU slot back to MacHigh Queue
+                macHigh->releaseSdu();
             }
         }
         else{
             //Change MAC Tx Mode to DISABLED_MODE_TX
             currentMacTxMode = DISABLED_MODE_TX;
+
+            //Block until MAC mode changes
+            macHigh->waitForModeChange(DATA_SDUS_WAIT_TIMEOUT, seenModeChanges);
         }
     }
 
@@ -15,6 +15,9 @@
 #include "../Multiplexer/Multiplexer.h"
 #include "../MacController/MacController.h"
 
+#define DATA_SDUS_BATCH_SIZE 32         //Maximum number of SDUs enqueued in Multiplexer per wake up, before reevaluating MAC mode
+#define DATA_SDUS_WAIT_TIMEOUT 100      //Maximum time(ms) blocked waiting for SDUs before reevaluating MAC mode
+
 class MacController;	//Initializing class that will be defined in other .h file
 
 /**
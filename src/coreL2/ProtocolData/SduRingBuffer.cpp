@@ -0,0 +1,130 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+/**
+@Arquive name : SduRingBuffer.cpp
+@Classification : Protocol Data
+@
+@Version : v1.0
+
+Project : H2020 5G-Range
+
+@Description : This module implements a lock-free single-producer/single-consumer
+    ring of preallocated slots, used between TUN reading and SDUs enqueueing.
+*/
+
+#include "SduRingBuffer.h"
+
+SduRingBuffer::SduRingBuffer(
+    uint32_t _numberSlots,      //Minimum number of slots
+    size_t _slotSize)           //Size of each slot in bytes
+{
+    //Round number of slots up to a power of 2 so indexes can be wrapped with a mask
+    numberSlots = 1;
+    while(numberSlots<_numberSlots)
+        numberSlots<<=1;
+    mask = numberSlots-1;
+    slotSize = _slotSize;
+
+    //Allocate all slots at once
+    slots = new char[numberSlots*slotSize];
+    sizes = new ssize_t[numberSlots];
+
+    head = 0;
+    tail = 0;
+    numberEnqueued = 0;
+    numberDropped = 0;
+}
+
+SduRingBuffer::~SduRingBuffer(){
+    delete [] slots;
+    delete [] sizes;
+}
+
+char*
+SduRingBuffer::getWriteSlot(){
+    uint32_t currentTail = tail.load(memory_order_relaxed);
+
+    //Test if ring is full
+    if(currentTail-head.load(memory_order_acquire)==numberSlots)
+        return NULL;
+
+    return slots+(currentTail&mask)*slotSize;
+}
+
+void
+SduRingBuffer::commitWrite(
+    ssize_t size)       //Number of bytes written in the slot
+{
+    uint32_t currentTail = tail.load(memory_order_relaxed);
+    sizes[currentTail&mask] = size;
+
+    //Publish slot to consumer
+    tail.store(currentTail+1, memory_order_release);
+    numberEnqueued.fetch_add(1, memory_order_relaxed);
+}
+
+void
+SduRingBuffer::countDrop(){
+    numberDropped.fetch_add(1, memory_order_relaxed);
+}
+
+char*
+SduRingBuffer::getReadSlot(
+    ssize_t & size)     //Number of bytes in the slot
+{
+    uint32_t currentHead = head.load(memory_order_relaxed);
+
+    //Test if ring is empty
+    if(currentHead==tail.load(memory_order_acquire))
+        return NULL;
+
+    size = sizes[currentHead&mask];
+    return slots+(currentHead&mask)*slotSize;
+}
+
+void
+SduRingBuffer::releaseRead(){
+    //Give slot back to producer
+    head.store(head.load(memory_order_relaxed)+1, memory_order_release);
+}
+
+uint32_t
+SduRingBuffer::getDepth(){
+    //Head is read first so that depth never underflows
+    uint32_t currentHead = head.load(memory_order_acquire);
+    return tail.load(memory_order_acquire)-currentHead;
+}
+
+size_t
+SduRingBuffer::getNumberBytes(){
+    uint32_t currentHead = head.load(memory_order_acquire);
+    uint32_t currentTail = tail.load(memory_order_acquire);    //Sizes of slots before tail were published with it
+    size_t numberBytes = 0;
+
+    for(uint32_t i=currentHead;i!=currentTail;i++)
+        numberBytes += sizes[i&mask];
+    return numberBytes;
+}
+
+uint32_t
+SduRingBuffer::getCapacity(){
+    return numberSlots;
+}
+
+size_t
+SduRingBuffer::getSlotSize(){
+    return slotSize;
+}
+
+uint64_t
+SduRingBuffer::getNumberEnqueued(){
+    return numberEnqueued.load(memory_order_relaxed);
+}
+
+uint64_t
+SduRingBuffer::getNumberDropped(){
+    return numberDropped.load(memory_order_relaxed);
+}
@@ -0,0 +1,112 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+
+#ifndef INCLUDED_SDU_RING_BUFFER_H
+#define INCLUDED_SDU_RING_BUFFER_H
+
+#include <stdint.h>     //uint32_t, uint64_t
+#include <stddef.h>     //size_t, NULL
+#include <sys/types.h>  //ssize_t
+#include <atomic>       //std::atomic
+
+using namespace std;
+
+/**
+ * @brief Bounded single-producer/single-consumer ring of fixed-size slots.
+ * All memory is allocated on construction; enqueueing and dequeueing never lock or allocate.
+ * Only one thread may call the producer methods and only one thread may call the consumer methods.
+ */
+class SduRingBuffer{
+private:
+    char* slots;                            //Contiguous storage for all slots
+    ssize_t* sizes;                         //Number of bytes stored in each slot
+    uint32_t numberSlots;                   //Number of slots (power of 2)
+    uint32_t mask;                          //numberSlots-1, used to wrap indexes
+    size_t slotSize;                        //Size of each slot in bytes
+    alignas(64) atomic<uint32_t> head;      //Next slot to be read; written only by consumer
+    alignas(64) atomic<uint32_t> tail;      //Next slot to be written; written only by producer
+    alignas(64) atomic<uint64_t> numberEnqueued;    //Total number of SDUs enqueued
+    atomic<uint64_t> numberDropped;         //Total number of SDUs dropped because ring was full
+
+public:
+    /**
+     * @brief Constructs a ring and preallocates all its slots
+     * @param _numberSlots Minimum number of slots (rounded up to a power of 2)
+     * @param _slotSize Size of each slot in bytes
+     */
+    SduRingBuffer(uint32_t _numberSlots, size_t _slotSize);
+
+    /**
+     * @brief Destroys ring and frees slots memory
+     */
+    ~SduRingBuffer();
+
+    /**
+     * @brief [Producer] Gets next free slot to be filled
+     * @returns Pointer to slot with getSlotSize() bytes; NULL if ring is full
+     */
+    char* getWriteSlot();
+
+    /**
+     * @brief [Producer] Publishes the slot returned by getWriteSlot() to the consumer
+     * @param size Number of bytes written in the slot
+     */
+    void commitWrite(ssize_t size);
+
+    /**
+     * @brief [Producer] Accounts for one SDU that could not be enqueued
+     */
+    void countDrop();
+
+    /**
+     * @brief [Consumer] Gets oldest slot published by producer without removing it
+     * @param size Variable where number of bytes in the slot will be stored
+     * @returns Pointer to slot; NULL if ring is empty
+     */
+    char* getReadSlot(ssize_t & size);
+
+    /**
+     * @brief [Consumer] Releases slot returned by getReadSlot() back to producer
+     */
+    void releaseRead();
+
+    /**
+     * @brief Gets number of SDUs currently enqueued
+     * @returns Ring depth
+     */
+    uint32_t getDepth();
+
+    /**
+     * @brief Gets number of bytes of SDUs currently enqueued; slots released meanwhile may still be counted
+     * @returns Number of bytes
+     */
+    size_t getNumberBytes();
+
+    /**
+     * @brief Gets number of slots of the ring
+     * @returns Ring capacity
+     */
+    uint32_t getCapacity();
+
+    /**
+     * @brief Gets size of each slot
+     * @returns Slot size in bytes
+     */
+    size_t getSlotSize();
+
+    /**
+     * @brief Gets total number of SDUs enqueued since creation
+     * @returns Number of SDUs enqueued
+     */
+    uint64_t getNumberEnqueued();
+
+    /**
+     * @brief Gets total number of SDUs dropped since creation
+     * @returns Number of SDUs dropped
+     */
+    uint64_t getNumberDropped();
+};
+#endif  //INCLUDED_SDU_RING_BUFFER_H
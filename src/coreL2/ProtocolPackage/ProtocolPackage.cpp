@@ -49,9 +49,10 @@ ProtocolPackage::ProtocolPackage(
     numberSDUs = _numberSDUs;
     sizes = _sizes;
     flagsDataControl = _flagsDataControl;
+    segmentationInfo = NULL;
     buffer = _buffer;
     verbose = _verbose;
-    PDUsize = 2 + 2*numberSDUs; //SA, DA , NUM and 2 for each SDU ; Only header bytes here
+    PDUsize = MAC_HEADER_LENGTH + 2*numberSDUs; //SA, DA , NUM, SN and 2 for each SDU ; Only header bytes here
     for(int i=0;i<numberSDUs;i++){
         PDUsize += sizes[i];
     }
@@ -79,30 +80,23 @@ ProtocolPackage::~ProtocolPackage(){
 
 void 
 ProtocolPackage::insertMacHeader(){
-    int i, j;   //Auxiliary variables
+    int headerSize = MAC_HEADER_LENGTH+2*numberSDUs;    //Number of bytes of MAC header
 
-    //Allocate new buffer
-    char* buffer2 = new char[PDUsize];
+    //Move SDUs forward in the same buffer to open space for the header
+    memmove(buffer+headerSize, buffer, PDUsize-headerSize);
 
     //Fills the 2 first slots
-    buffer2[0] = (sourceAddress<<4)|(destinationAddress&15);
-    buffer2[1] = numberSDUs;
+    buffer[0] = (sourceAddress<<4)|(destinationAddress&15);
+    buffer[1] = numberSDUs;
+    buffer[SEQUENCE_NUMBER_OFFSET] = 0;
+    buffer[SEQUENCE_NUMBER_OFFSET+1] = 0;
 
     //Fills with the SDUs informations
-    for(i=0;i<numberSDUs;i++){
-        buffer2[2+2*i] = (flagsDataControl[i]<<7)|(sizes[i]>>8);
-        buffer2[3+2*i] = sizes[i]&255;
-    }
-
-    //Copy the buffer with the SDUs multiplexed to the new buffer
-    for(i=2+2*i,j=0;i<PDUsize;i++,j++){
-        buffer2[i] = buffer[j];
+    for(int i=0;i<numberSDUs;i++){
+        buffer[MAC_HEADER_LENGTH+2*i] = (flagsDataControl[i]<<7)|(COMPLETE_SDU<<5)|((sizes[i]>>8)&31);
+        buffer[MAC_HEADER_LENGTH+1+2*i] = sizes[i]&255;
     }
 
-    memcpy(buffer, buffer2, PDUsize);
-
-    delete [] buffer2;
-
     if(verbose) cout<<"[ProtocolPackage] MAC Header inserted."<<endl;
 }
 
@@ -115,14 +109,16 @@ ProtocolPackage::removeMacHeader(){
     destinationAddress = (uint8_t) (buffer[0]&15);
     numberSDUs = (uint8_t) buffer[1];
 
-    //Declare new sizes and Data/Control flags arrays and get information for SDUs decoding
+    //Declare new sizes, Data/Control flags and segmentation information arrays and get information for SDUs decoding
     flagsDataControl = new uint8_t[numberSDUs];
+    segmentationInfo = new uint8_t[numberSDUs];
     sizes = new uint16_t[numberSDUs];
     for(int i=0;i<numberSDUs;i++){
-        flagsDataControl[i] = (buffer[2+2*i]&255)>>7;
-        sizes[i] = ((buffer[2+2*i]&127)<<8)|((buffer[3+2*i])&255);
+        flagsDataControl[i] = (buffer[MAC_HEADER_LENGTH+2*i]&255)>>7;
+        segmentationInfo[i] = (buffer[MAC_HEADER_LENGTH+2*i]>>5)&3;
+        sizes[i] = ((buffer[MAC_HEADER_LENGTH+2*i]&31)<<8)|((buffer[MAC_HEADER_LENGTH+1+2*i])&255);
     }
-    i = 2+2*numberSDUs;
+    i = MAC_HEADER_LENGTH+2*numberSDUs;
     PDUsize-=i;
 
     //Create a new buffer that will contain only SDUs, no header
@@ -139,7 +135,7 @@ ProtocolPackage::removeMacHeader(){
 
 TransmissionQueue* 
 ProtocolPackage::getMultiplexedSDUs(){
-    TransmissionQueue* tqueue = new TransmissionQueue(buffer, numberSDUs, sizes, flagsDataControl, verbose);
+    TransmissionQueue* tqueue = new TransmissionQueue(buffer, numberSDUs, sizes, flagsDataControl, segmentationInfo, verbose);
     return tqueue;
 }
 
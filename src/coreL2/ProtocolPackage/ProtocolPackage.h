@@ -25,8 +25,9 @@ private:
     uint8_t sourceAddress;          //Source MAC Address (4 bits)
     uint8_t destinationAddress;     //Destination MAC Address (4 bits)
     uint8_t numberSDUs;             //Number of MAC SDUs (8 bits)
-    uint16_t *sizes;                //Sizes of each MAC SDU (15 bits each)
+    uint16_t *sizes;                //Sizes of each MAC SDU (13 bits each)
     uint8_t *flagsDataControl;      //Data(1)/Control(0) flag of each SDU (1 bit each)
+    uint8_t *segmentationInfo;      //Segmentation information of each SDU (2 bits each)
     size_t PDUsize;                 //PDU length
     unsigned short crc;             //Cyclic Redundancy Check (16 bits)
     bool verbose;                   //Verbosity flag
@@ -78,7 +79,8 @@ public:
     ~ProtocolPackage();
         
     /**
-     * @brief Inserts MAC header based on class variables values
+     * @brief Inserts MAC header based on class variables values, in place; buffer must have room for getPduSize() bytes
+     * SDUs are marked as complete (not segmented)
      */
     void insertMacHeader();
     
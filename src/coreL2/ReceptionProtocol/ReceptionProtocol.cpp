@@ -53,3 +53,27 @@ ReceptionProtocol::receivePackageFromL3(
 {
     return tunInterface->readTunInterface(buffer, maximumSize);
 }
+
+bool
+ReceptionProtocol::waitPackageFromL3(
+    int timeout)        //Maximum waiting time in milliseconds
+{
+    return tunInterface->waitTunInterface(timeout);
+}
+
+ssize_t 
+ReceptionProtocol::receivePackageFromL3(
+    char* buffer,       //Buffer where packet will be stored
+    int maximumSize,    //Maximum size of buffer in Bytes
+    int queue)          //Index of TUN queue
+{
+    return tunInterface->readTunInterface(buffer, maximumSize, queue);
+}
+
+bool
+ReceptionProtocol::waitPackageFromL3(
+    int timeout,        //Maximum waiting time in milliseconds
+    int queue)          //Index of TUN queue
+{
+    return tunInterface->waitTunInterface(timeout, queue);
+}
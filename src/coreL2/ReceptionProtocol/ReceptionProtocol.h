@@ -53,5 +53,29 @@ public:
      */
     ssize_t receivePackageFromL3(char* buffer, int maximumSize);
 
+    /**
+     * @brief Receives packet from one queue of Linux IP Layer interface
+     * @param buffer Buffer where packet will be stored
+     * @param maximumSize Maximum size of buffer in Bytes
+     * @param queue Index of TUN queue
+     * @returns Size of information received in Bytes; 0 for EOF; -1 for errors
+     */
+    ssize_t receivePackageFromL3(char* buffer, int maximumSize, int queue);
+
+    /**
+     * @brief Blocks until there are packets from Linux IP Layer to receive
+     * @param timeout Maximum waiting time in milliseconds
+     * @returns True if there are packets to receive; false if timeout expired
+     */
+    bool waitPackageFromL3(int timeout);
+
+    /**
+     * @brief Blocks until there are packets from one queue of Linux IP Layer interface to receive
+     * @param timeout Maximum waiting time in milliseconds
+     * @param queue Index of TUN queue
+     * @returns True if there are packets to receive; false if timeout expired
+     */
+    bool waitPackageFromL3(int timeout, int queue);
+
 };
 #endif  //INCLUDED_RECEPTION_PROTOCOL_H
\ No newline at end of file
@@ -0,0 +1,128 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+/**
+@Arquive name : RbAllocator.cpp
+@Classification : Scheduler
+@
+@Version : v1.0
+
+Project : H2020 5G-Range
+
+@Description : This module keeps the RBs of a subframe that are idle according 
+    to spectrum sensing and places transport blocks in contiguous idle runs.
+*/
+
+#include "RbAllocator.h"
+
+RbAllocator::RbAllocator(
+    bool _verbose)      //Verbosity flag
+{
+    verbose = _verbose;
+
+    //All RBs of the band are idle; bits beyond last RB are never set
+    for(int i=0;i<RB_BITMAP_WORDS;i++)
+        idleRbs[i] = ~0ULL;
+    if(MAX_NUM_RB%64)
+        idleRbs[RB_BITMAP_WORDS-1] = (1ULL<<(MAX_NUM_RB%64))-1;
+}
+
+void
+RbAllocator::shiftRight(
+    uint64_t* bitmap,       //Bitmap to be shifted
+    int numberBits)         //Number of bits
+{
+    if(numberBits==0) return;
+    for(int i=0;i<RB_BITMAP_WORDS;i++){
+        bitmap[i] >>= numberBits;
+        if(i+1<RB_BITMAP_WORDS)
+            bitmap[i] |= bitmap[i+1]<<(64-numberBits);
+    }
+}
+
+void
+RbAllocator::markBusy(
+    const uint8_t* bitmap)      //17-byte bitmap, bit set for occupied RB
+{
+    uint64_t busyRbs[RB_BITMAP_WORDS] = {0};    //Occupied RBs, one bit per RB
+
+    //Repack bytes (most significant bit first) into words (RB i in bit i)
+    for(int rb=0;rb<MAX_NUM_RB;rb++){
+        int byte = rb/8;
+        int bit = byte<RB_BITMAP_BYTES-1? 7-rb%8:3-rb%8;     //Last byte has only 4 RBs, in its least significant bits
+        if((bitmap[byte]>>bit)&1)
+            busyRbs[rb/64] |= 1ULL<<(rb%64);
+    }
+
+    for(int i=0;i<RB_BITMAP_WORDS;i++)
+        idleRbs[i] &= ~busyRbs[i];
+}
+
+int
+RbAllocator::getNumberIdleRbs(){
+    int numberRbs = 0;
+    for(int i=0;i<RB_BITMAP_WORDS;i++)
+        numberRbs += __builtin_popcountll(idleRbs[i]);
+    return numberRbs;
+}
+
+void
+RbAllocator::markAllocated(
+    int firstRb,        //First RB
+    int numberRbs)      //Number of RBs
+{
+    for(int rb=firstRb;rb<firstRb+numberRbs && rb<MAX_NUM_RB;){
+        int bit = rb%64;
+        int length = 64-bit<firstRb+numberRbs-rb? 64-bit:firstRb+numberRbs-rb;
+        uint64_t mask = length==64? ~0ULL:((1ULL<<length)-1)<<bit;
+        idleRbs[rb/64] &= ~mask;
+        rb += length;
+    }
+}
+
+int
+RbAllocator::allocate(
+    int numberRbs,          //Number of RBs of transport block
+    int preferredFirstRb)   //Preferred first RB
+{
+    uint64_t runStarts[RB_BITMAP_WORDS];    //Bit i set if RBs i .. i+numberRbs-1 are all idle
+    int runLength;                          //Length of runs already represented in runStarts
+    int shift;                              //Auxiliary variable for run doubling
+
+    if(numberRbs<=0 || numberRbs>MAX_NUM_RB)
+        return -1;
+
+    //Each step ANDs the bitmap with itself shifted, doubling the run length represented, up to numberRbs
+    for(int i=0;i<RB_BITMAP_WORDS;i++)
+        runStarts[i] = idleRbs[i];
+    for(runLength=1;runLength<numberRbs;runLength+=shift){
+        uint64_t shifted[RB_BITMAP_WORDS];
+        shift = runLength<numberRbs-runLength? runLength:numberRbs-runLength;
+        if(shift>63) shift = 63;
+        for(int i=0;i<RB_BITMAP_WORDS;i++)
+            shifted[i] = runStarts[i];
+        shiftRight(shifted, shift);
+        for(int i=0;i<RB_BITMAP_WORDS;i++)
+            runStarts[i] &= shifted[i];
+    }
+
+    //Keep preferred position if it is idle
+    int firstRb = -1;
+    if(preferredFirstRb>=0 && preferredFirstRb<MAX_NUM_RB && ((runStarts[preferredFirstRb/64]>>(preferredFirstRb%64))&1))
+        firstRb = preferredFirstRb;
+
+    //Else, take lowest run
+    for(int i=0;i<RB_BITMAP_WORDS && firstRb==-1;i++)
+        if(runStarts[i]!=0)
+            firstRb = 64*i+__builtin_ctzll(runStarts[i]);
+
+    if(firstRb==-1){
+        if(verbose) cout<<"[RbAllocator] No idle run of "<<numberRbs<<" RBs."<<endl;
+        return -1;
+    }
+
+    markAllocated(firstRb, numberRbs);
+    return firstRb;
+}
@@ -0,0 +1,72 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+
+#ifndef INCLUDED_RB_ALLOCATOR_H
+#define INCLUDED_RB_ALLOCATOR_H
+
+#include <iostream>     //cout
+#include <stdint.h>     //uint8_t, uint64_t
+
+#include "../../common/lib5grange/lib5grange.h"
+
+using namespace std;
+
+#define RB_BITMAP_BYTES 17      //Bytes of a 132-bit RB bitmap (spectrum sensing report or fusion LUT)
+#define RB_BITMAP_WORDS ((MAX_NUM_RB+63)/64)    //64-bit words of the availability bitmap
+
+/**
+ * @brief Availability bitmap of the RBs of a subframe, used to place transport blocks only in idle RBs
+ * Bit i of the words is RB i; contiguous idle runs are searched with word-wide shifts and masks, not RB by RB.
+ * 132-bit bitmaps received as 17 bytes have RB 8*i+j in bit 7-j of byte i; in byte 16, only the 4 least significant bits are used.
+ */
+class RbAllocator{
+private:
+    uint64_t idleRbs[RB_BITMAP_WORDS];  //Bit set if RB is idle and not allocated yet
+    bool verbose;                       //Verbosity flag
+
+    /**
+     * @brief Shifts a bitmap towards lower RBs
+     * @param bitmap Bitmap to be shifted in place
+     * @param numberBits Number of bits (less than 64)
+     */
+    static void shiftRight(uint64_t* bitmap, int numberBits);
+
+    /**
+     * @brief Marks a range of RBs as not idle
+     * @param firstRb First RB
+     * @param numberRbs Number of RBs
+     */
+    void markAllocated(int firstRb, int numberRbs);
+
+public:
+    /**
+     * @brief Constructs a RbAllocator with all RBs idle
+     * @param _verbose Verbosity flag
+     */
+    RbAllocator(bool _verbose);
+
+    /**
+     * @brief Removes from availability the RBs flagged in a 132-bit bitmap
+     * @param bitmap Array of 17 bytes where a set bit flags an occupied RB, e.g. spectrum sensing report or fusion LUT
+     */
+    void markBusy(const uint8_t* bitmap);
+
+    /**
+     * @brief Gets number of RBs idle and not allocated yet
+     * @returns Number of RBs
+     */
+    int getNumberIdleRbs();
+
+    /**
+     * @brief Allocates contiguous idle RBs to a transport block
+     * Preferred position is kept if it is all idle; else, the lowest idle run large enough is taken
+     * @param numberRbs Number of RBs of transport block
+     * @param preferredFirstRb Preferred first RB, e.g. first RB of UE reservation
+     * @returns First RB allocated; -1 if there is no idle run large enough
+     */
+    int allocate(int numberRbs, int preferredFirstRb);
+};
+#endif  //INCLUDED_RB_ALLOCATOR_H
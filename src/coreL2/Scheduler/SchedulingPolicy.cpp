@@ -0,0 +1,131 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+/**
+@Arquive name : SchedulingPolicy.cpp
+@Classification : Scheduler
+@
+@Version : v1.0
+
+Project : H2020 5G-Range
+
+@Description : This module implements the policies used by the MAC scheduler
+    to split the RBs of each subframe among backlogged destinations.
+*/
+
+#include "SchedulingPolicy.h"
+
+#include <algorithm>    //std::stable_sort()
+
+SchedulingPolicy::SchedulingPolicy(
+    bool _verbose)      //Verbosity flag
+{
+    verbose = _verbose;
+}
+
+SchedulingPolicy::~SchedulingPolicy() {}
+
+void
+SchedulingPolicy::allocate(
+    vector<SchedulingCandidate> & candidates,   //Backlogged destinations
+    size_t numberRbs)                           //Number of RBs available
+{
+    vector<double> priorities(candidates.size());   //Priority of each candidate
+    vector<int> order(candidates.size());           //Candidates in decreasing order of priority
+    vector<SchedulingCandidate> sortedCandidates;   //Candidates reordered
+
+    //Priorities are calculated once per subframe
+    for(size_t i=0;i<candidates.size();i++){
+        priorities[i] = getPriority(candidates[i]);
+        order[i] = i;
+    }
+    stable_sort(order.begin(), order.end(), [&priorities](int a, int b){ return priorities[a]>priorities[b]; });
+
+    //Serve candidates while there are RBs left for their PDUs
+    for(size_t i=0;i<order.size();i++){
+        SchedulingCandidate candidate = candidates[order[i]];
+        candidate.allocatedRbs = 0;
+        if(candidate.requiredRbs<=numberRbs){
+            candidate.allocatedRbs = candidate.requiredRbs;
+            numberRbs -= candidate.requiredRbs;
+        }
+        sortedCandidates.push_back(candidate);
+    }
+    candidates = sortedCandidates;
+}
+
+SchedulingPolicy*
+SchedulingPolicy::create(
+    SchedulingPolicies policy,  //Policy to be created
+    bool _verbose)              //Verbosity flag
+{
+    switch(policy){
+        case ROUND_ROBIN:
+            return new RoundRobinPolicy(_verbose);
+        case MAXIMUM_CI:
+            return new MaximumCiPolicy(_verbose);
+        case PROPORTIONAL_FAIR:
+        default:
+            return new ProportionalFairPolicy(_verbose);
+    }
+}
+
+void
+SchedulingPolicy::updateAverageThroughput(
+    double & averageThroughput,     //Average throughput to be updated
+    size_t numberBytes)             //Number of bytes transmitted in the subframe
+{
+    averageThroughput += (numberBytes-averageThroughput)/THROUGHPUT_AVERAGING_WINDOW;
+}
+
+RoundRobinPolicy::RoundRobinPolicy(
+    bool _verbose)      //Verbosity flag
+    : SchedulingPolicy(_verbose)
+{
+    nextIndex = 0;
+}
+
+double
+RoundRobinPolicy::getPriority(
+    const SchedulingCandidate & candidate)  //Backlogged destination
+{
+    //Destinations after nextIndex come first, in index order; the others come after them
+    return candidate.index>=nextIndex? -candidate.index:-candidate.index-ROUND_ROBIN_TURN_OFFSET;
+}
+
+void
+RoundRobinPolicy::allocate(
+    vector<SchedulingCandidate> & candidates,   //Backlogged destinations
+    size_t numberRbs)                           //Number of RBs available
+{
+    SchedulingPolicy::allocate(candidates, numberRbs);
+
+    //Next turn starts after last destination served
+    for(size_t i=0;i<candidates.size();i++)
+        if(candidates[i].allocatedRbs>0)
+            nextIndex = candidates[i].index+1;
+}
+
+MaximumCiPolicy::MaximumCiPolicy(
+    bool _verbose)      //Verbosity flag
+    : SchedulingPolicy(_verbose) {}
+
+double
+MaximumCiPolicy::getPriority(
+    const SchedulingCandidate & candidate)  //Backlogged destination
+{
+    return candidate.bytesPerRb;
+}
+
+ProportionalFairPolicy::ProportionalFairPolicy(
+    bool _verbose)      //Verbosity flag
+    : SchedulingPolicy(_verbose) {}
+
+double
+ProportionalFairPolicy::getPriority(
+    const SchedulingCandidate & candidate)  //Backlogged destination
+{
+    return candidate.bytesPerRb/(candidate.averageThroughput>MINIMUM_AVERAGE_THROUGHPUT? candidate.averageThroughput:MINIMUM_AVERAGE_THROUGHPUT);
+}
@@ -0,0 +1,124 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+
+#ifndef INCLUDED_SCHEDULING_POLICY_H
+#define INCLUDED_SCHEDULING_POLICY_H
+
+#include <iostream>     //cout
+#include <vector>       //std::vector
+#include <stddef.h>     //size_t
+
+using namespace std;
+
+#define THROUGHPUT_AVERAGING_WINDOW 100     //Number of subframes of the moving average of throughput of each UE
+#define MINIMUM_AVERAGE_THROUGHPUT 1.0      //Minimum average throughput (bytes/subframe) considered, to avoid division by zero
+#define ROUND_ROBIN_TURN_OFFSET 256         //Round-robin priority offset of destinations whose turn has passed; larger than any queue index
+
+/**
+ * @brief Scheduling policies available
+ */
+enum SchedulingPolicies {ROUND_ROBIN, MAXIMUM_CI, PROPORTIONAL_FAIR};
+
+/**
+ * @brief Information of a backlogged destination used by scheduling policies
+ */
+typedef struct{
+    int index;                  //Index of destination Transmission Queue
+    double bytesPerRb;          //Bytes each RB carries with the MCS derived from last CQI reported (instant rate)
+    double averageThroughput;   //Moving average of bytes transmitted to destination per subframe
+    size_t requiredRbs;         //Number of RBs needed by next PDU of destination
+    size_t allocatedRbs;        //[Output] Number of RBs allocated to destination in this subframe
+} SchedulingCandidate;
+
+/**
+ * @brief Policy that splits the RBs of a subframe among backlogged destinations
+ * Candidates are served in decreasing order of priority. PDUs are not split, so a candidate whose PDU does not fit
+ * in the RBs left gets none and later candidates may still be served.
+ */
+class SchedulingPolicy{
+protected:
+    bool verbose;       //Verbosity flag
+
+    /**
+     * @brief Calculates priority of a candidate in this subframe
+     * @param candidate Backlogged destination
+     * @returns Priority; higher is served first
+     */
+    virtual double getPriority(const SchedulingCandidate & candidate) = 0;
+
+public:
+    /**
+     * @brief Constructs a SchedulingPolicy
+     * @param _verbose Verbosity flag
+     */
+    SchedulingPolicy(bool _verbose);
+
+    /**
+     * @brief Destroys a SchedulingPolicy
+     */
+    virtual ~SchedulingPolicy();
+
+    /**
+     * @brief Allocates RBs of a subframe to candidates, filling their allocatedRbs
+     * @param candidates Backlogged destinations; reordered by priority on return
+     * @param numberRbs Number of RBs available in the subframe
+     */
+    virtual void allocate(vector<SchedulingCandidate> & candidates, size_t numberRbs);
+
+    /**
+     * @brief Creates a scheduling policy object
+     * @param policy Policy to be created
+     * @param _verbose Verbosity flag
+     * @returns New SchedulingPolicy; it must be deleted by caller
+     */
+    static SchedulingPolicy* create(SchedulingPolicies policy, bool _verbose);
+
+    /**
+     * @brief Updates moving average of throughput of a destination after a subframe
+     * @param averageThroughput Average throughput (bytes/subframe) to be updated
+     * @param numberBytes Number of bytes transmitted to destination in the subframe (0 if not served)
+     */
+    static void updateAverageThroughput(double & averageThroughput, size_t numberBytes);
+};
+
+/**
+ * @brief Round-robin policy: destinations are served in turns, regardless of channel quality
+ */
+class RoundRobinPolicy : public SchedulingPolicy{
+private:
+    int nextIndex;      //Index of Transmission Queue that has the highest priority in next subframe
+
+protected:
+    double getPriority(const SchedulingCandidate & candidate);
+
+public:
+    RoundRobinPolicy(bool _verbose);
+    void allocate(vector<SchedulingCandidate> & candidates, size_t numberRbs);
+};
+
+/**
+ * @brief Maximum C/I policy: destinations with best channel quality are served first, maximizing cell throughput
+ */
+class MaximumCiPolicy : public SchedulingPolicy{
+protected:
+    double getPriority(const SchedulingCandidate & candidate);
+
+public:
+    MaximumCiPolicy(bool _verbose);
+};
+
+/**
+ * @brief Proportional-fair policy: destinations are served in order of instant rate over average throughput,
+ * trading cell throughput for bounded fairness
+ */
+class ProportionalFairPolicy : public SchedulingPolicy{
+protected:
+    double getPriority(const SchedulingCandidate & candidate);
+
+public:
+    ProportionalFairPolicy(bool _verbose);
+};
+#endif  //INCLUDED_SCHEDULING_POLICY_H
@@ -0,0 +1,282 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+/**
+@Arquive name : UplinkScheduler.cpp
+@Classification : Scheduler
+@
+@Version : v1.0
+
+Project : H2020 5G-Range
+
+@Description : This module resizes uplink reservations of UEs from their buffer 
+    status reports and serializes BSR and uplink grant MACC SDUs.
+*/
+
+#include "UplinkScheduler.h"
+
+#include <algorithm>    //std::sort()
+
+UplinkScheduler::UplinkScheduler(
+    const vector<allocation_cfg_t> & reservations,  //Uplink reservations configured for each UE
+    bool _verbose)                                  //Verbosity flag
+{
+    verbose = _verbose;
+    numberUEs = reservations.size();
+    pendingBytes = new atomic<size_t>[numberUEs];
+    grants = new allocation_cfg_t[numberUEs];
+    sentGrants = new allocation_cfg_t[numberUEs];
+    pendingGrants = new allocation_cfg_t[numberUEs];
+    grantGuards = new int[numberUEs];
+    reset(reservations);
+}
+
+UplinkScheduler::~UplinkScheduler(){
+    delete [] pendingBytes;
+    delete [] grants;
+    delete [] sentGrants;
+    delete [] pendingGrants;
+    delete [] grantGuards;
+}
+
+void
+UplinkScheduler::reset(
+    const vector<allocation_cfg_t> & reservations)  //Uplink reservations configured for each UE
+{
+    firstRb = MAX_NUM_RB;
+    numberRbs = 0;
+    for(int i=0;i<numberUEs;i++){
+        pendingBytes[i] = 0;
+        grants[i] = reservations[i];
+        sentGrants[i] = reservations[i];
+        pendingGrants[i] = reservations[i];
+        grantGuards[i] = 0;
+        if(reservations[i].first_rb<firstRb) firstRb = reservations[i].first_rb;
+        numberRbs += reservations[i].number_of_rb;
+    }
+
+    //Band never goes beyond last RB
+    if(firstRb+numberRbs>MAX_NUM_RB) numberRbs = MAX_NUM_RB-firstRb;
+    if(verbose) cout<<"[UplinkScheduler] Uplink band with "<<numberRbs<<" RBs from RB "<<firstRb<<"."<<endl;
+}
+
+void
+UplinkScheduler::setPendingBytes(
+    int index,              //Index of UE
+    size_t numberBytes)     //Number of bytes
+{
+    if(index>=0 && index<numberUEs)
+        pendingBytes[index] = numberBytes;
+}
+
+size_t
+UplinkScheduler::getPendingBytes(
+    int index)      //Index of UE
+{
+    return pendingBytes[index];
+}
+
+void
+UplinkScheduler::calculateGrants(
+    const vector<size_t> & requiredRbs)     //Number of RBs each UE needs
+{
+    vector<int> order(numberUEs);           //UEs sorted by number of RBs required
+    vector<size_t> grantedRbs(numberUEs);   //Number of RBs granted to each UE
+
+    //Grants pending for UPLINK_GRANT_GUARD subframes were applied by their UEs: RBs of previous grants are released
+    for(int i=0;i<numberUEs;i++){
+        if(grantGuards[i]>0 && --grantGuards[i]==0){
+            sentGrants[i] = pendingGrants[i];
+            if(verbose) cout<<"[UplinkScheduler] Grant of "<<(int)sentGrants[i].number_of_rb<<" RBs from RB "<<(int)sentGrants[i].first_rb<<" in effect on UE "<<(int)sentGrants[i].target_ue_id<<"."<<endl;
+        }
+    }
+
+    //Every UE keeps a minimum grant, if band allows it
+    size_t minimumRbs = numberUEs*MINIMUM_UPLINK_GRANT_RBS<=numberRbs? MINIMUM_UPLINK_GRANT_RBS:numberRbs/numberUEs;
+    size_t remainingRbs = numberRbs-minimumRbs*numberUEs;
+
+    for(int i=0;i<numberUEs;i++){
+        order[i] = i;
+        grantedRbs[i] = minimumRbs;
+    }
+    sort(order.begin(), order.end(), [&requiredRbs](int a, int b){ return requiredRbs[a]<requiredRbs[b]; });
+
+    //Max-min fair sharing: smallest demands are served first; each UE gets at most an equal share of what is left
+    for(int j=0;j<numberUEs;j++){
+        int i = order[j];
+        size_t demand = requiredRbs[i]>minimumRbs? requiredRbs[i]-minimumRbs:0;
+        size_t share = remainingRbs/(numberUEs-j);
+        size_t extra = demand<share? demand:share;
+        grantedRbs[i] += extra;
+        remainingRbs -= extra;
+    }
+
+    //RBs of grant in effect on each UE, and of grant pending on it, stay its own until its next grant is in effect, so grants are laid
+    //out only in RBs no other UE holds; this way, any subset of changed grants may be sent and applied without UEs transmitting on the same RBs
+    vector<int> owners(numberRbs, -1);      //UE holding each RB of band in grants in effect or pending; -1 for none
+    vector<bool> taken(numberRbs, false);   //RBs of band given to grants calculated in this subframe
+    for(int i=0;i<numberUEs;i++){
+        for(int rb=sentGrants[i].first_rb;rb<sentGrants[i].first_rb+sentGrants[i].number_of_rb;rb++)
+            if(rb>=firstRb && rb<firstRb+numberRbs)
+                owners[rb-firstRb] = i;
+        for(int rb=pendingGrants[i].first_rb;rb<pendingGrants[i].first_rb+pendingGrants[i].number_of_rb;rb++)
+            if(grantGuards[i]>0 && rb>=firstRb && rb<firstRb+numberRbs)
+                owners[rb-firstRb] = i;
+    }
+
+    for(int i=0;i<numberUEs;i++){
+        //Grant pending is kept until it is in effect
+        if(grantGuards[i]>0){
+            grants[i] = pendingGrants[i];
+            continue;
+        }
+
+        int sentFirstRb = sentGrants[i].first_rb-firstRb;  //First RB of grant sent, relative to band
+        int bestStart = -1;                 //Start of run of free RBs chosen
+        int bestLength = 0;                 //Length of run chosen
+        long bestScore = -1;                //Score of run chosen
+
+        //Runs of RBs free to this UE: a run that fits whole grant is preferred, the one holding grant sent first; else longest run
+        for(int rb=0;rb<numberRbs;){
+            if(taken[rb] || (owners[rb]!=-1 && owners[rb]!=i)){
+                rb++;
+                continue;
+            }
+            int start = rb;
+            while(rb<numberRbs && !taken[rb] && (owners[rb]==-1 || owners[rb]==i))
+                rb++;
+            int length = rb-start;
+            bool holdsSent = sentFirstRb>=start && sentFirstRb<rb;
+            long score = length>=(int)grantedRbs[i]? (1L<<20)+holdsSent:(length<<1)+holdsSent;
+            if(score>bestScore){
+                bestScore = score;
+                bestStart = start;
+                bestLength = length;
+            }
+        }
+
+        //No RB free: grant does not change
+        if(bestStart==-1){
+            grants[i] = sentGrants[i];
+            continue;
+        }
+
+        //Grant keeps its first RB if run allows it, so it grows or shrinks in place
+        int number = (int)grantedRbs[i]<bestLength? grantedRbs[i]:bestLength;
+        int first = bestStart;
+        if(sentFirstRb>=bestStart && sentFirstRb<bestStart+bestLength)
+            first = sentFirstRb<bestStart+bestLength-number? sentFirstRb:bestStart+bestLength-number;
+        for(int rb=first;rb<first+number;rb++)
+            taken[rb] = true;
+        grants[i].first_rb = firstRb+first;
+        grants[i].number_of_rb = number;
+    }
+}
+
+bool
+UplinkScheduler::getChangedGrant(
+    int index,                  //Index of UE
+    allocation_cfg_t & grant)   //New grant
+{
+    grant = grants[index];
+    return grantGuards[index]==0 && (grants[index].first_rb!=sentGrants[index].first_rb || grants[index].number_of_rb!=sentGrants[index].number_of_rb);
+}
+
+void
+UplinkScheduler::confirmGrantSent(
+    int index)      //Index of UE
+{
+    pendingGrants[index] = grants[index];
+    grantGuards[index] = UPLINK_GRANT_GUARD;
+    if(verbose) cout<<"[UplinkScheduler] UE "<<(int)grants[index].target_ue_id<<" granted "<<(int)grants[index].number_of_rb<<" RBs from RB "<<(int)grants[index].first_rb<<"."<<endl;
+}
+
+void
+UplinkScheduler::getSentGrants(
+    vector<allocation_cfg_t> & _grants)     //Vector where grants will be stored
+{
+    _grants.assign(sentGrants, sentGrants+numberUEs);
+}
+
+uint8_t
+UplinkScheduler::encodeBufferSize(
+    size_t numberBytes)     //Buffer size in bytes
+{
+    int exponent = 0;       //Power of 2 of each mantissa unit
+
+    if(numberBytes==0)
+        return 0;
+    while(exponent<16 && numberBytes>((size_t)15<<exponent))
+        exponent++;
+    if(exponent==16)
+        return 255;     //Saturates at largest level
+
+    //Mantissa is rounded up, so grant always covers buffer
+    return (exponent<<4)|((numberBytes+((size_t)1<<exponent)-1)>>exponent);
+}
+
+size_t
+UplinkScheduler::decodeBufferSize(
+    uint8_t level)      //Buffer size level
+{
+    return (size_t)(level&15)<<(level>>4);
+}
+
+void
+UplinkScheduler::serializeBufferStatusReport(
+    const vector<size_t> & queueBytes,  //Bytes pending on each logical queue
+    vector<uint8_t> & bytes)            //Serialized BSR
+{
+    size_t numberQueues = queueBytes.size()<MAXIMUM_BSR_QUEUES? queueBytes.size():MAXIMUM_BSR_QUEUES;
+    size_t lastQueueBytes = 0;          //Bytes of last queue reported, including queues not reported
+
+    bytes = {'B', 'S', 'R', (uint8_t) numberQueues};
+    for(size_t i=0;i<queueBytes.size();i++){
+        if(i+1<numberQueues)
+            bytes.push_back(encodeBufferSize(queueBytes[i]));
+        else
+            lastQueueBytes += queueBytes[i];
+    }
+    if(numberQueues>0)
+        bytes.push_back(encodeBufferSize(lastQueueBytes));
+}
+
+bool
+UplinkScheduler::deserializeBufferStatusReport(
+    char* buffer,           //Buffer containing Control SDU
+    size_t numberBytes,     //Size of Control SDU in bytes
+    size_t & totalBytes)    //Sum of bytes pending
+{
+    if(numberBytes<BUFFER_STATUS_REPORT_HEADER_LENGTH || buffer[0]!='B' || buffer[1]!='S' || buffer[2]!='R' || 
+       numberBytes!=(size_t)(BUFFER_STATUS_REPORT_HEADER_LENGTH+(uint8_t)buffer[3]))
+        return false;
+
+    totalBytes = 0;
+    for(size_t i=BUFFER_STATUS_REPORT_HEADER_LENGTH;i<numberBytes;i++)
+        totalBytes += decodeBufferSize(buffer[i]);
+    return true;
+}
+
+void
+UplinkScheduler::serializeUplinkGrant(
+    const allocation_cfg_t & grant,     //Uplink grant
+    vector<uint8_t> & bytes)            //Serialized grant
+{
+    bytes = {'U', 'L', 'G', grant.first_rb, grant.number_of_rb};
+}
+
+bool
+UplinkScheduler::deserializeUplinkGrant(
+    char* buffer,               //Buffer containing Control SDU
+    size_t numberBytes,         //Size of Control SDU in bytes
+    allocation_cfg_t & grant)   //Uplink grant
+{
+    if(numberBytes!=UPLINK_GRANT_LENGTH || buffer[0]!='U' || buffer[1]!='L' || buffer[2]!='G')
+        return false;
+
+    grant.first_rb = buffer[3];
+    grant.number_of_rb = buffer[4];
+    return true;
+}
@@ -0,0 +1,156 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+
+#ifndef INCLUDED_UPLINK_SCHEDULER_H
+#define INCLUDED_UPLINK_SCHEDULER_H
+
+#include <iostream>     //cout
+#include <vector>       //std::vector
+#include <atomic>       //std::atomic
+#include <stdint.h>     //uint8_t
+#include <stddef.h>     //size_t
+
+#include "../../common/lib5grange/lib5grange.h"
+
+using namespace std;
+using namespace lib5grange;
+
+#define BUFFER_STATUS_REPORT_HEADER_LENGTH 4    //Bytes of BSR MACC SDU before buffer sizes: "BSR" tag and number of logical queues
+#define MAXIMUM_BSR_QUEUES 8                    //Maximum number of logical queues reported; keeps BSR shorter than a minimum segment
+#define UPLINK_GRANT_LENGTH 5                   //Bytes of uplink grant MACC SDU: "ULG" tag, first RB and number of RBs
+#define MINIMUM_UPLINK_GRANT_RBS 1              //RBs kept by idle UEs, so they can still send their buffer status reports
+#define BSR_PERIODICITY 100                     //Subframes after which UE repeats an unchanged BSR, in case it was lost
+#define UPLINK_GRANT_GUARD 16                   //Subframes after a grant is enqueued until UE has surely applied it: transmission, decoding and HARQ retransmissions
+
+/**
+ * @brief [BS] Resizes uplink reservations of UEs every subframe according to their buffer status reports (BSR)
+ * Uplink band is the sum of the reservations configured for all UEs, starting at lowest configured RB.
+ * Each UE keeps MINIMUM_UPLINK_GRANT_RBS; remaining RBs are shared max-min fairly among RBs required by pending bytes.
+ * UE applies a grant only after decoding it, so a grant sent stays pending for UPLINK_GRANT_GUARD subframes: until then, UE holds
+ * RBs of both its previous grant and the pending one, and L1 is still told the previous one.
+ */
+class UplinkScheduler{
+private:
+    int numberUEs;                          //Number of UEs attached
+    atomic<size_t>* pendingBytes;           //Bytes pending on each UE, from its last BSR
+    allocation_cfg_t* grants;               //Uplink grant of each UE calculated on last subframe
+    allocation_cfg_t* sentGrants;           //Uplink grant in effect on each UE (and announced to L1)
+    allocation_cfg_t* pendingGrants;        //Uplink grant enqueued to each UE and maybe not applied by it yet
+    int* grantGuards;                       //Subframes until pending grant of each UE is in effect; 0 if there is none
+    int firstRb;                            //First RB of uplink band
+    int numberRbs;                          //Number of RBs of uplink band
+    bool verbose;                           //Verbosity flag
+
+    /**
+     * @brief Quantizes a buffer size into a single byte: 4-bit mantissa and 4-bit exponent, rounded up
+     * @param numberBytes Buffer size in bytes
+     * @returns Buffer size level
+     */
+    static uint8_t encodeBufferSize(size_t numberBytes);
+
+    /**
+     * @brief Gets upper bound of buffer size of a level
+     * @param level Buffer size level
+     * @returns Buffer size in bytes
+     */
+    static size_t decodeBufferSize(uint8_t level);
+
+public:
+    /**
+     * @brief Constructs UplinkScheduler with UEs holding their configured reservations
+     * @param reservations Uplink reservations configured for each UE
+     * @param _verbose Verbosity flag
+     */
+    UplinkScheduler(const vector<allocation_cfg_t> & reservations, bool _verbose);
+
+    /**
+     * @brief Destroys UplinkScheduler
+     */
+    ~UplinkScheduler();
+
+    /**
+     * @brief Restores configured reservations as grants of all UEs and defines uplink band from them, e.g. after RECONFIG
+     * @param reservations Uplink reservations configured for each UE
+     */
+    void reset(const vector<allocation_cfg_t> & reservations);
+
+    /**
+     * @brief Stores bytes pending on a UE, reported by its BSR
+     * @param index Index of UE
+     * @param numberBytes Number of bytes
+     */
+    void setPendingBytes(int index, size_t numberBytes);
+
+    /**
+     * @brief Gets bytes pending on a UE, reported by its last BSR
+     * @param index Index of UE
+     * @returns Number of bytes
+     */
+    size_t getPendingBytes(int index);
+
+    /**
+     * @brief Calculates uplink grants of all UEs for this subframe, each in a contiguous run of the uplink band; called once per subframe
+     * Pending grants whose guard expired are put in effect first. A grant only takes RBs not held by other UEs, in grants in effect
+     * or pending, so changed grants may be sent in any subset; a UE whose share does not fit yet gets the longest run free and grows
+     * as other UEs release RBs. A UE with a pending grant keeps it
+     * @param requiredRbs Number of RBs each UE needs to send its pending bytes
+     */
+    void calculateGrants(const vector<size_t> & requiredRbs);
+
+    /**
+     * @brief Verifies if grant of a UE changed since last one sent to it
+     * @param index Index of UE
+     * @param grant Variable where new grant will be stored
+     * @returns True if grant must be sent; false if it did not change or previous grant sent is still pending
+     */
+    bool getChangedGrant(int index, allocation_cfg_t & grant);
+
+    /**
+     * @brief Records that current grant of a UE was enqueued to it; it is pending until UPLINK_GRANT_GUARD subframes elapse
+     * @param index Index of UE
+     */
+    void confirmGrantSent(int index);
+
+    /**
+     * @brief Gets grants in effect on all UEs, to be announced to L1 in BSSubframeTx.Start
+     * @param _grants Vector where grants will be stored
+     */
+    void getSentGrants(vector<allocation_cfg_t> & _grants);
+
+    /**
+     * @brief Serializes a BSR MACC SDU: "BSR" tag, number of logical queues and one buffer size level per queue
+     * Queues beyond MAXIMUM_BSR_QUEUES are added to the last one reported
+     * @param queueBytes Bytes pending on each logical queue
+     * @param bytes Vector where serialized BSR will be stored
+     */
+    static void serializeBufferStatusReport(const vector<size_t> & queueBytes, vector<uint8_t> & bytes);
+
+    /**
+     * @brief Deserializes a BSR MACC SDU
+     * @param buffer Buffer containing Control SDU
+     * @param numberBytes Size of Control SDU in bytes
+     * @param totalBytes Variable where sum of bytes pending on all logical queues will be stored
+     * @returns True if Control SDU is a BSR
+     */
+    static bool deserializeBufferStatusReport(char* buffer, size_t numberBytes, size_t & totalBytes);
+
+    /**
+     * @brief Serializes an uplink grant MACC SDU
+     * @param grant Uplink grant
+     * @param bytes Vector where serialized grant will be stored
+     */
+    static void serializeUplinkGrant(const allocation_cfg_t & grant, vector<uint8_t> & bytes);
+
+    /**
+     * @brief Deserializes an uplink grant MACC SDU
+     * @param buffer Buffer containing Control SDU
+     * @param numberBytes Size of Control SDU in bytes
+     * @param grant Variable where first RB and number of RBs of grant will be stored
+     * @returns True if Control SDU is an uplink grant
+     */
+    static bool deserializeUplinkGrant(char* buffer, size_t numberBytes, allocation_cfg_t & grant);
+};
+#endif  //INCLUDED_UPLINK_SCHEDULER_H
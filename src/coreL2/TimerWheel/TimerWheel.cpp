@@ -0,0 +1,184 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+/**
+@Arquive name : TimerWheel.cpp
+@Classification : Timer Wheel
+@
+@Version : v1.0
+
+Project : H2020 5G-Range
+
+@Description : This module implements a hierarchical timer wheel where all MAC
+    timeouts are armed and cancelled in constant time.
+*/
+
+#include "TimerWheel.h"
+
+TimerWheel::TimerWheel(
+    bool _verbose)      //Verbosity flag
+{
+    verbose = _verbose;
+    currentTick = 0;
+    freeEntries = -1;
+    for(int i=0;i<TIMER_WHEEL_LEVELS*TIMER_WHEEL_SLOTS;i++)
+        buckets[i] = -1;
+}
+
+TimerWheel::~TimerWheel() {}
+
+void
+TimerWheel::link(
+    int index)      //Index of entry
+{
+    TimerEntry & entry = entries[index];
+    uint64_t delta = entry.expiry>currentTick? entry.expiry-currentTick:0;
+    int level;      //Lowest level whose turn covers expiry
+
+    //Timeouts beyond the last level are held at its last slot and cascaded again
+    if(delta>=((uint64_t)1<<(TIMER_WHEEL_LEVEL_BITS*TIMER_WHEEL_LEVELS))){
+        delta = ((uint64_t)1<<(TIMER_WHEEL_LEVEL_BITS*TIMER_WHEEL_LEVELS))-1;
+        entry.expiry = currentTick+delta;
+    }
+    for(level=0;level<TIMER_WHEEL_LEVELS-1 && delta>=((uint64_t)1<<(TIMER_WHEEL_LEVEL_BITS*(level+1)));level++);
+
+    //Expired timers (delta 0) go to the slot of current tick, which is processed right after cascading
+    uint64_t tick = delta==0? currentTick:entry.expiry;
+    entry.bucket = level*TIMER_WHEEL_SLOTS+((tick>>(TIMER_WHEEL_LEVEL_BITS*level))&(TIMER_WHEEL_SLOTS-1));
+
+    //Insert at head of bucket list
+    entry.previous = -1;
+    entry.next = buckets[entry.bucket];
+    if(entry.next!=-1)
+        entries[entry.next].previous = index;
+    buckets[entry.bucket] = index;
+}
+
+void
+TimerWheel::unlink(
+    int index)      //Index of entry
+{
+    TimerEntry & entry = entries[index];
+
+    if(entry.previous!=-1)
+        entries[entry.previous].next = entry.next;
+    else
+        buckets[entry.bucket] = entry.next;
+    if(entry.next!=-1)
+        entries[entry.next].previous = entry.previous;
+}
+
+void
+TimerWheel::release(
+    int index)      //Index of entry
+{
+    TimerEntry & entry = entries[index];
+
+    entry.bucket = -1;
+    entry.generation++;
+    entry.callback = nullptr;
+    entry.next = freeEntries;
+    freeEntries = index;
+}
+
+int
+TimerWheel::getEntry(
+    TimerHandle handle)     //Timer handle
+{
+    int index = handle&0xFFFFFFFF;
+
+    if(handle==INVALID_TIMER || (size_t)index>=entries.size())
+        return -1;
+    if(entries[index].bucket==-1 || entries[index].generation!=(handle>>32))
+        return -1;
+    return index;
+}
+
+TimerHandle
+TimerWheel::arm(
+    uint64_t numberTicks,           //Number of ticks until expiry
+    function<void()> callback)      //Procedure called on expiry
+{
+    lock_guard<mutex> lk(wheelMutex);
+    int index;      //Index of entry of new timer
+
+    //Take an entry from free list; pool grows only when all entries are armed
+    if(freeEntries==-1){
+        entries.emplace_back();
+        index = entries.size()-1;
+        entries[index].generation = 1;      //Handles are never INVALID_TIMER
+    }
+    else{
+        index = freeEntries;
+        freeEntries = entries[index].next;
+    }
+
+    entries[index].expiry = currentTick+(numberTicks<1? 1:numberTicks);
+    entries[index].callback = callback;
+    link(index);
+
+    return ((TimerHandle)entries[index].generation<<32)|index;
+}
+
+bool
+TimerWheel::cancel(
+    TimerHandle & handle)   //Handle of timer
+{
+    lock_guard<mutex> lk(wheelMutex);
+    int index = getEntry(handle);
+
+    handle = INVALID_TIMER;
+    if(index==-1)
+        return false;
+
+    unlink(index);
+    release(index);
+    return true;
+}
+
+void
+TimerWheel::advance(){
+    vector<function<void()>> expiredCallbacks;     //Procedures of timers expired on this tick
+
+    {
+        lock_guard<mutex> lk(wheelMutex);
+        currentTick++;
+
+        //When a level completes a turn, next slot of the level above is cascaded down
+        for(int level=1;level<TIMER_WHEEL_LEVELS;level++){
+            if((currentTick&(((uint64_t)1<<(TIMER_WHEEL_LEVEL_BITS*level))-1))!=0)
+                break;
+            int bucket = level*TIMER_WHEEL_SLOTS+((currentTick>>(TIMER_WHEEL_LEVEL_BITS*level))&(TIMER_WHEEL_SLOTS-1));
+            int index = buckets[bucket];
+            buckets[bucket] = -1;
+            while(index!=-1){
+                int next = entries[index].next;
+                link(index);
+                index = next;
+            }
+        }
+
+        //All timers of current slot of level 0 expire now
+        int bucket = currentTick&(TIMER_WHEEL_SLOTS-1);
+        int index = buckets[bucket];
+        buckets[bucket] = -1;
+        while(index!=-1){
+            int next = entries[index].next;
+            expiredCallbacks.push_back(entries[index].callback);
+            release(index);
+            index = next;
+        }
+    }
+
+    //Procedures are called without wheel locked, so they can arm and cancel timers
+    for(size_t i=0;i<expiredCallbacks.size();i++)
+        expiredCallbacks[i]();
+}
+
+uint64_t
+TimerWheel::getCurrentTick(){
+    lock_guard<mutex> lk(wheelMutex);
+    return currentTick;
+}
@@ -0,0 +1,115 @@
+/* ***************************************/
+/* Copyright Notice                      */
+/* Copyright(c)2020 5G Range Consortium  */
+/* All rights Reserved                   */
+/*****************************************/
+
+#ifndef INCLUDED_TIMER_WHEEL_H
+#define INCLUDED_TIMER_WHEEL_H
+
+#include <iostream>     //cout
+#include <vector>       //std::vector
+#include <functional>   //std::function
+#include <mutex>        //std::mutex
+#include <stdint.h>     //uint64_t
+
+using namespace std;
+
+#define TIMER_WHEEL_LEVEL_BITS 6                            //Bits of tick counter resolved by each level
+#define TIMER_WHEEL_SLOTS (1<<TIMER_WHEEL_LEVEL_BITS)       //Number of slots of each level
+#define TIMER_WHEEL_LEVELS 4                                //Number of levels: timeouts up to 2^24 ticks
+#define INVALID_TIMER 0                                     //Handle of no timer
+
+typedef uint64_t TimerHandle;   //Identifies an armed timer: generation of its entry (upper 32 bits) and entry index
+
+/**
+ * @brief Hierarchical timer wheel shared by all MAC timeouts, advanced one tick at a time by a single thread
+ * Level 0 has one slot per tick; each upper level has one slot per full turn of the level below. Timers are
+ * kept in intrusive lists of pooled entries, so arm and cancel are O(1) regardless of how many timers are armed;
+ * a timer is moved to a lower level only when its upper slot is reached (cascade).
+ */
+class TimerWheel{
+private:
+    /**
+     * @brief Timer stored in the wheel; entries are pooled and linked by index
+     */
+    typedef struct{
+        uint64_t expiry;            //Tick when timer expires
+        function<void()> callback;  //Procedure called on expiry
+        int bucket;                 //Level*TIMER_WHEEL_SLOTS+slot where timer is linked; -1 if entry is free
+        int previous;               //Previous entry in bucket list; -1 if first
+        int next;                   //Next entry in bucket list (or in free list); -1 if last
+        uint32_t generation;        //Incremented each time entry is released, so stale handles are ignored
+    }TimerEntry;
+
+    vector<TimerEntry> entries;     //Pool of timer entries
+    int freeEntries;                //First entry of free list; -1 if pool must grow
+    int buckets[TIMER_WHEEL_LEVELS*TIMER_WHEEL_SLOTS];  //First entry of each slot of each level; -1 if empty
+    uint64_t currentTick;           //Ticks elapsed since creation
+    mutex wheelMutex;               //Mutex to control access to wheel
+    bool verbose;                   //Verbosity flag
+
+    /**
+     * @brief Links entry in the slot of its expiry, in the lowest level that covers it
+     * @param index Index of entry
+     */
+    void link(int index);
+
+    /**
+     * @brief Unlinks entry from its slot
+     * @param index Index of entry
+     */
+    void unlink(int index);
+
+    /**
+     * @brief Gives entry back to free list and invalidates its handles
+     * @param index Index of entry
+     */
+    void release(int index);
+
+    /**
+     * @brief Gets entry referred by a handle
+     * @param handle Timer handle
+     * @returns Index of entry; -1 if timer is not armed anymore
+     */
+    int getEntry(TimerHandle handle);
+
+public:
+    /**
+     * @brief Constructs an empty TimerWheel at tick zero
+     * @param _verbose Verbosity flag
+     */
+    TimerWheel(bool _verbose);
+
+    /**
+     * @brief Destroys TimerWheel; timers still armed never expire
+     */
+    ~TimerWheel();
+
+    /**
+     * @brief Arms a timer
+     * @param numberTicks Number of ticks until expiry (at least 1)
+     * @param callback Procedure called on expiry, by the thread advancing the wheel and without wheel locked
+     * @returns Handle of timer
+     */
+    TimerHandle arm(uint64_t numberTicks, function<void()> callback);
+
+    /**
+     * @brief Cancels a timer, if it has not expired yet
+     * @param handle Handle of timer; it is set to INVALID_TIMER
+     * @returns True if timer was armed
+     */
+    bool cancel(TimerHandle & handle);
+
+    /**
+     * @brief Advances wheel one tick and calls procedures of timers expired
+     */
+    void advance();
+
+    /**
+     * @brief Gets number of ticks elapsed since creation
+     * @returns Current tick
+     */
+    uint64_t getCurrentTick();
+};
+#endif  //INCLUDED_TIMER_WHEEL_H
@@ -38,7 +38,7 @@ TransmissionProtocol::~TransmissionProtocol() {}
 
 void 
 TransmissionProtocol::sendPackageToL1(
-    MacPDU macPdu,          //MAC PDU structure
+    MacPDU & macPdu,        //MAC PDU structure
     uint8_t macAddress)     //Destination MAC Address
 {
     if(verbose) cout<<"[TransmissionProtocol] Sending packet to L1."<<endl;
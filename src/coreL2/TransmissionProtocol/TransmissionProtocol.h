@@ -38,10 +38,10 @@ public:
     ~TransmissionProtocol();
 
     /**
-     * @param macPdu MAC PDU structure containing all information PHY needs
+     * @param macPdu MAC PDU structure containing all information PHY needs; it is consumed (CRC is appended to its data)
      * @param macAddress Destination MAC Address
      */
-    void sendPackageToL1(MacPDU macPdu, uint8_t macAddress);
+    void sendPackageToL1(MacPDU & macPdu, uint8_t macAddress);
     
     /**
      * @param controlBuffer Buffer with Control message